@@ -1,4 +1,5 @@
 #include "asyncio/asyncio.h"
+#include "asyncio/bufferPool.h"
 #include "asyncio/coroutine.h"
 #include "asyncio/device.h"
 #include "asyncio/socket.h"
@@ -8,6 +9,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#ifndef OS_WINDOWS
+#include <sys/mman.h>
+#endif
 
 static ConcurrentQueue opPool;
 static ConcurrentQueue opTimerPool;
@@ -18,7 +22,8 @@ asyncBase *iocpNewAsyncBase();
 #endif
 #ifdef OS_LINUX
 asyncBase *selectNewAsyncBase(void);
-asyncBase *epollNewAsyncBase(void);
+asyncBase *epollNewAsyncBase(int edgeTriggered);
+asyncBase *iouringNewAsyncBase(void);
 #endif
 #if defined(OS_DARWIN) || defined (OS_FREEBSD)
 asyncBase *kqueueNewAsyncBase(void);
@@ -31,8 +36,35 @@ struct Context {
   size_t TransactionSize;
   size_t BytesTransferred;
   ssize_t Result;
+  // Vectored operations: Buffer points to aioIoVec array
+  size_t IoVecCount;
+  // Send file operations
+  iodevTy File;
+  uint64_t FileOffset;
 };
 
+// Readiness based backends start operation after first event from OS,
+// completion based ones (IOCP, io_uring) submit it immediately
+static inline AsyncFlags readinessFlags(asyncBase *base)
+{
+#ifdef OS_WINDOWS
+  __UNUSED(base);
+  return afNone;
+#else
+  return base->method == amIOUring ? afNone : afRunning;
+#endif
+}
+
+static inline int zeroCopySupported(asyncBase *base)
+{
+#ifdef OS_LINUX
+  return base->method == amEPoll || base->method == amEPollET;
+#else
+  __UNUSED(base);
+  return 0;
+#endif
+}
+
 static inline void fillContext(struct Context *context,
                                aioExecuteProc *startProc,
                                aioFinishProc *finishProc,
@@ -70,6 +102,135 @@ static void readMsgFinish(asyncOpRoot *opptr)
   ((aioReadMsgCb*)opptr->callback)(opGetStatus(opptr), (aioObject*)opptr->object, op->host, op->bytesTransferred, opptr->arg);
 }
 
+static void mappedBufferFromOp(asyncOp *op, aioMappedBuffer *buffer)
+{
+  // Mapping and copied data owned by caller after operation finished
+  // Without segments recorded by backend mapped part precedes copied part
+  if (!op->segmentsCount) {
+    if (op->mappedSize)
+      mappedSegmentAppend(op, op->mapping, op->mappedSize);
+    if (op->bytesTransferred)
+      mappedSegmentAppend(op, op->buffer, op->bytesTransferred);
+  }
+
+  buffer->segments = op->segments;
+  buffer->segmentsCount = op->segmentsCount;
+  buffer->size = op->mappedSize + op->bytesTransferred;
+  buffer->tail = op->buffer;
+  buffer->tailSize = op->bytesTransferred;
+  buffer->mapping = op->mapping;
+  buffer->mappingSize = op->mappingSize;
+  op->buffer = 0;
+  op->mapping = 0;
+  op->mappingSize = 0;
+  op->mappedSize = 0;
+  op->segments = 0;
+  op->segmentsCount = 0;
+}
+
+static void mappedNoCallback(AsyncOpStatus status, aioObject *object, aioMappedBuffer *buffer, void *arg)
+{
+  __UNUSED(status);
+  __UNUSED(object);
+  __UNUSED(arg);
+  aioReleaseMapped(buffer);
+}
+
+static void readMappedFinish(asyncOpRoot *opptr)
+{
+  aioMappedBuffer buffer;
+  mappedBufferFromOp((asyncOp*)opptr, &buffer);
+  ((aioReadMappedCb*)opptr->callback)(opGetStatus(opptr), (aioObject*)opptr->object, &buffer, opptr->arg);
+}
+
+static void providedNoCallback(AsyncOpStatus status, aioObject *object, void *buffer, size_t size, void *arg)
+{
+  __UNUSED(status);
+  __UNUSED(size);
+  __UNUSED(arg);
+  aioReleaseProvided(object, buffer);
+}
+
+static void *providedBufferFromOp(asyncOp *op)
+{
+  // Buffer owned by caller after successful read, returned to pool otherwise
+  void *buffer = op->buffer;
+  op->buffer = 0;
+  if (buffer && opGetStatus(&op->root) != aosSuccess) {
+    providedBufferFree(op->root.object->base, buffer);
+    buffer = 0;
+  }
+
+  return buffer;
+}
+
+static void readProvidedFinish(asyncOpRoot *opptr)
+{
+  asyncOp *op = (asyncOp*)opptr;
+  void *buffer = providedBufferFromOp(op);
+  ((aioReadProvidedCb*)opptr->callback)(opGetStatus(opptr), (aioObject*)opptr->object, buffer, buffer ? op->bytesTransferred : 0, opptr->arg);
+}
+
+static size_t msgBatchResult(asyncOp *op)
+{
+  // Backend without batch support processed first message by single datagram operation
+  if (op->root.opCode == actReadMsg) {
+    op->msgs[0].address = op->host;
+    op->msgs[0].transferred = op->bytesTransferred;
+    return opGetStatus(&op->root) == aosSuccess ? 1 : 0;
+  } else if (op->root.opCode == actWriteMsg) {
+    return op->msgsDone + (opGetStatus(&op->root) == aosSuccess ? 1 : 0);
+  }
+
+  return op->bytesTransferred;
+}
+
+static asyncOp *msgBatchNextOp(asyncOp *op, aioFinishProc *finishProc);
+
+static void msgBatchNoCallback(AsyncOpStatus status, aioObject *object, aioMsg *msgs, size_t count, void *arg)
+{
+  __UNUSED(status);
+  __UNUSED(object);
+  __UNUSED(msgs);
+  __UNUSED(count);
+  __UNUSED(arg);
+}
+
+static void msgBatchFinish(asyncOpRoot *opptr)
+{
+  asyncOp *op = (asyncOp*)opptr;
+  asyncOp *next = msgBatchNextOp(op, msgBatchFinish);
+  if (next) {
+    // Callback called after last message sent
+    combinerPushOperation(&next->root, aaStart);
+    return;
+  }
+
+  ((aioMsgBatchCb*)opptr->callback)(opGetStatus(opptr), (aioObject*)opptr->object, op->msgs, msgBatchResult(op), opptr->arg);
+}
+
+static void vectorScatter(asyncOp *op)
+{
+  // Backend without vectored read received data into internal buffer
+  size_t i;
+  size_t offset = 0;
+  if (op->root.opCode != actRead)
+    return;
+  for (i = 0; i < op->iovCount && offset < op->bytesTransferred; i++) {
+    size_t size = op->bytesTransferred - offset;
+    if (size > op->iov[i].iov_len)
+      size = op->iov[i].iov_len;
+    memcpy(op->iov[i].iov_base, (uint8_t*)op->buffer + offset, size);
+    offset += size;
+  }
+}
+
+static void vectorFinish(asyncOpRoot *opptr)
+{
+  vectorScatter((asyncOp*)opptr);
+  rwFinish(opptr);
+}
+
 static void eventFinish(asyncOpRoot *root)
 {
   if (root->callback)
@@ -80,12 +241,17 @@ static void releaseOp(asyncOpRoot *opptr)
 {
   asyncOp *op = (asyncOp*)opptr;
   if (op->internalBuffer) {
-    free(op->internalBuffer);
+    bufferPoolFree(op->internalBuffer, op->internalBufferSize);
     op->internalBuffer = 0;
     op->internalBufferSize = 0;
   }
 }
 
+static void *opReserveBuffer(asyncOp *op, size_t size)
+{
+  return bufferPoolReserve(&op->internalBuffer, &op->internalBufferSize, size);
+}
+
 static asyncOpRoot *newAsyncOp(aioObjectRoot *object,
                                AsyncFlags flags,
                                uint64_t usTimeout,
@@ -101,17 +267,9 @@ static asyncOpRoot *newAsyncOp(aioObjectRoot *object,
   op->state = 0;
   op->transactionSize = context->TransactionSize;
   op->bytesTransferred = 0;
-  if (context->TransactionSize && (opCode & OPCODE_WRITE) && !(flags & afNoCopy)) {
-    if (op->internalBuffer == 0) {
-      op->internalBuffer = malloc(context->TransactionSize);
-      op->internalBufferSize = context->TransactionSize;
-    } else if (op->internalBufferSize < context->TransactionSize) {
-      op->internalBufferSize = context->TransactionSize;
-      op->internalBuffer = realloc(op->internalBuffer, context->TransactionSize);
-    }
-
-    memcpy(op->internalBuffer, context->Buffer, context->TransactionSize);
-    op->buffer = op->internalBuffer;
+  if (context->TransactionSize && (opCode & OPCODE_WRITE) && !(flags & (afNoCopy | afZeroCopy))) {
+    op->buffer = opReserveBuffer(op, context->TransactionSize);
+    memcpy(op->buffer, context->Buffer, context->TransactionSize);
   } else {
     op->buffer = context->Buffer;
   }
@@ -119,6 +277,57 @@ static asyncOpRoot *newAsyncOp(aioObjectRoot *object,
   return &op->root;
 }
 
+static asyncOpRoot *newVectorAsyncOp(aioObjectRoot *object,
+                                     AsyncFlags flags,
+                                     uint64_t usTimeout,
+                                     void *callback,
+                                     void *arg,
+                                     int opCode,
+                                     void *contextPtr)
+{
+  struct Context *context = (struct Context*)contextPtr;
+  struct asyncImpl *impl = &object->base->methodImpl;
+  const aioIoVec *iov = (const aioIoVec*)context->Buffer;
+  size_t iovCount = context->IoVecCount;
+  int isWrite = (opCode & OPCODE_WRITE) != 0;
+  aioExecuteProc *vectorProc = isWrite ? impl->writev : impl->readv;
+  struct Context opContext;
+  asyncOp *op;
+  size_t totalSize = 0;
+  size_t i;
+  for (i = 0; i < iovCount; i++)
+    totalSize += iov[i].iov_len;
+
+  if (isWrite && (!(flags & afNoCopy) || !vectorProc)) {
+    // Gather data into internal buffer, it is the only copy of user data
+    uint8_t *ptr;
+    fillContext(&opContext, impl->write, context->FinishProc, 0, totalSize);
+    op = (asyncOp*)newAsyncOp(object, flags | afNoCopy, usTimeout, callback, arg, actWrite, &opContext);
+    op->buffer = ptr = (uint8_t*)opReserveBuffer(op, totalSize);
+    for (i = 0; i < iovCount; i++) {
+      memcpy(ptr, iov[i].iov_base, iov[i].iov_len);
+      ptr += iov[i].iov_len;
+    }
+  } else if (vectorProc) {
+    // User buffers pinned, operation advances own copy of vector
+    fillContext(&opContext, vectorProc, context->FinishProc, 0, totalSize);
+    op = (asyncOp*)newAsyncOp(object, flags, usTimeout, callback, arg, opCode, &opContext);
+    op->iov = (aioIoVec*)opReserveBuffer(op, sizeof(aioIoVec) * iovCount);
+    op->iovCount = iovCount;
+    memcpy(op->iov, iov, sizeof(aioIoVec) * iovCount);
+  } else {
+    // Read into internal buffer, data scattered to user vector at finish
+    fillContext(&opContext, impl->read, context->FinishProc, 0, totalSize);
+    op = (asyncOp*)newAsyncOp(object, flags, usTimeout, callback, arg, actRead, &opContext);
+    op->iov = (aioIoVec*)opReserveBuffer(op, sizeof(aioIoVec) * iovCount + totalSize);
+    op->iovCount = iovCount;
+    memcpy(op->iov, iov, sizeof(aioIoVec) * iovCount);
+    op->buffer = op->iov + iovCount;
+  }
+
+  return &op->root;
+}
+
 static void coroutineEventCb(aioObject *event, void *arg)
 {
   __UNUSED(event);
@@ -164,7 +373,18 @@ asyncBase *createAsyncBase(AsyncMethod method)
       base = selectNewAsyncBase();
       break;
     case amEPoll :
-      base = epollNewAsyncBase();
+      base = epollNewAsyncBase(0);
+      break;
+    case amEPollET :
+      base = epollNewAsyncBase(1);
+      break;
+    case amIOUring :
+      // Fall back to epoll if kernel has no required io_uring features
+      base = iouringNewAsyncBase();
+      if (!base) {
+        method = amEPoll;
+        base = epollNewAsyncBase(0);
+      }
       break;
 #elif defined(OS_DARWIN) || defined(OS_FREEBSD)
    case amKQueue :
@@ -174,24 +394,39 @@ asyncBase *createAsyncBase(AsyncMethod method)
     case amOSDefault :
     default:
 #if defined(OS_WINDOWS)
+      method = amIOCP;
       base = iocpNewAsyncBase();
 #elif defined(OS_LINUX)
-      base = epollNewAsyncBase();
+      method = amEPoll;
+      base = epollNewAsyncBase(0);
 #elif defined(OS_DARWIN) || defined(OS_FREEBSD)
+      method = amKQueue;
       base = kqueueNewAsyncBase();
 #else
+      method = amSelect;
       base = selectNewAsyncBase();
 #endif
       break;
   }
 
+  base->method = method;
+
 #ifndef NDEBUG
   base->opsCount = 0;
 #endif
-  pageMapInit(&base->timerMap);
+  timeoutQueueInit(base);
   memset(&base->globalQueue, 0, sizeof(base->globalQueue));
-  base->timerMapLock = 0;
-  base->lastCheckPoint = time(0);
+  memset(&base->providedBuffers, 0, sizeof(base->providedBuffers));
+  base->providedBufferSize = PROVIDED_BUFFER_DEFAULT_SIZE;
+  memset((void*)base->threadQueues, 0, sizeof(base->threadQueues));
+  memset((void*)base->threadQueueOwners, 0, sizeof(base->threadQueueOwners));
+  memset(base->stats, 0, sizeof(base->stats));
+  memset(&base->sharedStats, 0, sizeof(base->sharedStats));
+  base->tracing = 0;
+  base->traceHook = 0;
+  base->traceHookArg = 0;
+  base->latencyHistogramsEnabled = 0;
+  memset((void*)base->latencyHistograms, 0, sizeof(base->latencyHistograms));
   base->messageLoopThreadCounter = 0;
   return base;
 }
@@ -215,6 +450,103 @@ void setSocketBuffer(aioObject *socket, size_t bufferSize)
   }
 }
 
+static inline uint64_t statsSum(asyncBase *base, size_t offset)
+{
+  uint64_t sum = *(uint64_t*)((uint8_t*)&base->sharedStats.slot + offset);
+  for (unsigned i = 0; i < MAX_LOOP_THREADS; i++)
+    sum += *(volatile uint64_t*)((uint8_t*)&base->stats[i].slot + offset);
+  return sum;
+}
+
+static inline uint64_t statsDifference(uint64_t a, uint64_t b)
+{
+  // Counters read at different moments, gauge can't go below zero
+  return a > b ? a - b : 0;
+}
+
+#define STATS_SUM(base, field) statsSum((base), offsetof(asyncStatsSlot, field))
+
+void asyncBaseGetStats(asyncBase *base, struct asyncStats *stats)
+{
+  uint64_t opsTaken = STATS_SUM(base, opsTaken);
+  uint64_t opsReleased = STATS_SUM(base, opsReleased);
+  uint64_t objectsCreated = STATS_SUM(base, objectsCreated);
+  uint64_t objectsReleased = STATS_SUM(base, objectsReleased);
+  stats->opsCompletedSync = STATS_SUM(base, opsCompletedSync);
+  stats->opsCompletedAsync = STATS_SUM(base, opsCompletedAsync);
+  stats->opsStarted = opsTaken + stats->opsCompletedSync;
+  stats->combinerEntries = STATS_SUM(base, combinerEntries);
+  stats->combinerRetries = STATS_SUM(base, combinerRetries);
+  stats->globalQueueDepth = statsDifference(STATS_SUM(base, queueEnqueued), STATS_SUM(base, queueExecuted));
+  stats->waitCalls = STATS_SUM(base, waitCalls);
+  stats->waitEvents = STATS_SUM(base, waitEvents);
+  stats->waitTimeNs = STATS_SUM(base, waitTimeNs);
+  stats->timeoutsFired = STATS_SUM(base, timeoutsFired);
+  stats->opPoolSize = statsDifference(STATS_SUM(base, opsAllocated), statsDifference(opsTaken, opsReleased));
+  stats->objectPoolSize = statsDifference(STATS_SUM(base, objectsAllocated), statsDifference(objectsCreated, objectsReleased));
+}
+
+void asyncBaseSetTraceHook(asyncBase *base, aioTraceCb callback, void *arg)
+{
+  base->traceHookArg = arg;
+  base->traceHook = callback;
+  base->tracing = base->traceHook || base->latencyHistogramsEnabled;
+}
+
+void asyncBaseEnableLatencyHistograms(asyncBase *base, int enabled)
+{
+  base->latencyHistogramsEnabled = enabled != 0;
+  base->tracing = base->traceHook || base->latencyHistogramsEnabled;
+}
+
+static uint64_t latencyPercentile(volatile uint64_t *buckets, uint64_t count, uint64_t permille)
+{
+  // Histogram can be updated by loop threads, samples added after counting only move result up
+  uint64_t target = (count*permille + 999) / 1000;
+  uint64_t sum = 0;
+  for (unsigned i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+    sum += buckets[i];
+    if (sum >= target)
+      return latencyBucketValue(i);
+  }
+
+  return latencyBucketValue(LATENCY_HISTOGRAM_BUCKETS-1);
+}
+
+int asyncBaseGetLatency(asyncBase *base, aioTraceKind kind, int opCode, aioLatencyStats *stats)
+{
+  latencyHistogram *histogram = base->latencyHistograms[kind][traceOpCodeSlot(opCode)];
+  uint64_t count = 0;
+  memset(stats, 0, sizeof(aioLatencyStats));
+  if (!histogram)
+    return 0;
+
+  // Both histograms get one sample per operation, counting one of them is enough
+  for (unsigned i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+    count += *(volatile uint64_t*)&histogram->queueDelay[i];
+  if (!count)
+    return 0;
+
+  stats->count = count;
+  stats->queueDelayP50 = latencyPercentile(histogram->queueDelay, count, 500);
+  stats->queueDelayP99 = latencyPercentile(histogram->queueDelay, count, 990);
+  stats->queueDelayP999 = latencyPercentile(histogram->queueDelay, count, 999);
+  stats->ioTimeP50 = latencyPercentile(histogram->ioTime, count, 500);
+  stats->ioTimeP99 = latencyPercentile(histogram->ioTime, count, 990);
+  stats->ioTimeP999 = latencyPercentile(histogram->ioTime, count, 999);
+  return 1;
+}
+
+void aioSetProvidedBufferSize(asyncBase *base, size_t size)
+{
+  base->providedBufferSize = size;
+}
+
+void aioSetWriteCoalescing(aioObject *object, int enabled)
+{
+  object->coalesceWrites = enabled;
+}
+
 aioUserEvent *newUserEvent(asyncBase *base, int isSemaphore, aioEventCb callback, void *arg)
 {
   // TODO: use malloc allocator for aioUserEvent
@@ -224,6 +556,7 @@ aioUserEvent *newUserEvent(asyncBase *base, int isSemaphore, aioEventCb callback
   event->root.finishMethod = eventFinish;
   event->root.callback = (void*)callback;
   event->root.releaseMethod = 0;
+  event->root.createdTime = 0;
   event->root.arg = arg;
   event->root.tag = ((opGetGeneration(&event->root)+1) << TAG_STATUS_SIZE) | aosPending;
   event->base = base;
@@ -238,12 +571,18 @@ aioUserEvent *newUserEvent(asyncBase *base, int isSemaphore, aioEventCb callback
 
 aioObject *newSocketIo(asyncBase *base, socketTy hSocket)
 {
-  return base->methodImpl.newAioObject(base, ioObjectSocket, &hSocket);
+  aioObject *object = base->methodImpl.newAioObject(base, ioObjectSocket, &hSocket);
+  object->coalesceWrites = 0;
+  STATS_ADD(base, objectsCreated, 1);
+  return object;
 }
 
 aioObject *newDeviceIo(asyncBase *base, iodevTy hDevice)
 {
-  return base->methodImpl.newAioObject(base, ioObjectDevice, &hDevice);
+  aioObject *object = base->methodImpl.newAioObject(base, ioObjectDevice, &hDevice);
+  object->coalesceWrites = 0;
+  STATS_ADD(base, objectsCreated, 1);
+  return object;
 }
 
 void deleteAioObject(aioObject *object)
@@ -293,11 +632,7 @@ asyncOpRoot *implRead(aioObject *object,
 {
   *bytesTransferred = 0;
   struct ioBuffer *sb = &object->buffer;
-#ifdef OS_WINDOWS
-  AsyncFlags extraFlags = afNone;
-#else
-  AsyncFlags extraFlags = afRunning;
-#endif
+  AsyncFlags extraFlags = readinessFlags(object->root.base);
 
   if (copyFromBuffer(buffer, bytesTransferred, sb, size))
     return 0;
@@ -354,12 +689,18 @@ asyncOpRoot *implWrite(aioObject *object,
                        void *arg,
                        size_t *bytesTransferred)
 {
-#ifdef OS_WINDOWS
-  AsyncFlags extraFlags = afNone;
-#else
-  AsyncFlags extraFlags = afRunning;
-#endif
+  AsyncFlags extraFlags = readinessFlags(object->root.base);
   size_t bytes = 0;
+  if (flags & afZeroCopy) {
+    flags |= afNoCopy;
+    if (object->root.type == ioObjectSocket && zeroCopySupported(object->root.base)) {
+      // No synchronous send, operation finished after kernel releases user buffer
+      struct Context context;
+      fillContext(&context, object->root.base->methodImpl.write, rwFinish, (void*)((uintptr_t)buffer), size);
+      return newAsyncOp(&object->root, flags, usTimeout, (void*)callback, arg, actWrite, &context);
+    }
+  }
+
   int result = object->root.type == ioObjectSocket ?
     socketSyncWrite(object->hSocket, buffer, size, flags & afWaitAll, &bytes) :
     deviceSyncWrite(object->hDevice, buffer, size, flags & afWaitAll, &bytes);
@@ -375,6 +716,100 @@ asyncOpRoot *implWrite(aioObject *object,
   }
 }
 
+static asyncOpRoot *newSendFileOp(aioObjectRoot *object,
+                                  AsyncFlags flags,
+                                  uint64_t usTimeout,
+                                  void *callback,
+                                  void *arg,
+                                  int opCode,
+                                  void *contextPtr)
+{
+  __UNUSED(opCode);
+  struct Context *context = (struct Context*)contextPtr;
+  struct asyncImpl *impl = &object->base->methodImpl;
+  struct Context opContext;
+  asyncOp *op;
+  if (impl->sendFile && object->type == ioObjectSocket) {
+    fillContext(&opContext, impl->sendFile, context->FinishProc, 0, context->TransactionSize);
+    op = (asyncOp*)newAsyncOp(object, flags | afNoCopy, usTimeout, callback, arg, actSendFile, &opContext);
+    op->file = context->File;
+    op->fileOffset = context->FileOffset;
+  } else {
+    // File data read to internal buffer and sent by ordinary write, short file sent as is
+    size_t bytes = 0;
+    fillContext(&opContext, impl->write, context->FinishProc, 0, context->TransactionSize);
+    op = (asyncOp*)newAsyncOp(object, flags | afNoCopy, usTimeout, callback, arg, actWrite, &opContext);
+    op->buffer = opReserveBuffer(op, context->TransactionSize);
+    if (!deviceSyncReadAt(context->File, op->buffer, context->TransactionSize, context->FileOffset, &bytes))
+      op->transactionSize = bytes;
+  }
+
+  return &op->root;
+}
+
+asyncOpRoot *implSendFile(aioObject *object,
+                          iodevTy file,
+                          uint64_t offset,
+                          size_t size,
+                          AsyncFlags flags,
+                          uint64_t usTimeout,
+                          aioCb callback,
+                          void *arg,
+                          size_t *bytesTransferred)
+{
+  struct Context context;
+  AsyncFlags extraFlags = afNone;
+  size_t bytes = 0;
+  fillContext(&context, 0, rwFinish, 0, size);
+  context.File = file;
+  context.FileOffset = offset;
+  if (object->root.base->methodImpl.sendFile && object->root.type == ioObjectSocket) {
+    ssize_t result;
+    while ((result = socketSendFile(object->hSocket, file, offset + bytes, size - bytes)) > 0) {
+      bytes += (size_t)result;
+      if (bytes == size || !(flags & afWaitAll)) {
+        *bytesTransferred = bytes;
+        return 0;
+      }
+    }
+
+    extraFlags = readinessFlags(object->root.base);
+  }
+
+  asyncOp *op = (asyncOp*)newSendFileOp(&object->root, flags | extraFlags, usTimeout, (void*)callback, arg, actSendFile, &context);
+  op->bytesTransferred = bytes;
+  return &op->root;
+}
+
+asyncOpRoot *implWritev(aioObject *object,
+                        const aioIoVec *iov,
+                        size_t iovCount,
+                        AsyncFlags flags,
+                        uint64_t usTimeout,
+                        aioCb callback,
+                        void *arg,
+                        size_t *bytesTransferred)
+{
+  AsyncFlags extraFlags = readinessFlags(object->root.base);
+  size_t bytes = 0;
+  int result = object->root.type == ioObjectSocket ?
+    socketSyncWritev(object->hSocket, iov, iovCount, flags & afWaitAll, &bytes) :
+    deviceSyncWritev(object->hDevice, iov, iovCount, flags & afWaitAll, &bytes);
+  if (result) {
+    *bytesTransferred = bytes;
+    return 0;
+  } else {
+    struct Context context;
+    fillContext(&context, 0, vectorFinish, (void*)((uintptr_t)iov), 0);
+    context.IoVecCount = iovCount;
+    asyncOp *op = (asyncOp*)newVectorAsyncOp(&object->root, flags | extraFlags, usTimeout, (void*)callback, arg, actWritev, &context);
+    op->bytesTransferred = bytes;
+    if (op->root.opCode == actWritev)
+      ioVecAdvance(op, bytes);
+    return &op->root;
+  }
+}
+
 static asyncOpRoot *implReadProxy(aioObjectRoot *object, AsyncFlags flags, uint64_t usTimeout, void *callback, void *arg, void *contextPtr)
 {
   struct Context *context = (struct Context*)contextPtr;
@@ -387,6 +822,18 @@ static asyncOpRoot *implWriteProxy(aioObjectRoot *object, AsyncFlags flags, uint
   return implWrite((aioObject*)object, context->Buffer, context->TransactionSize, flags, usTimeout, (aioCb*)callback, arg, &context->BytesTransferred);
 }
 
+static asyncOpRoot *implWritevProxy(aioObjectRoot *object, AsyncFlags flags, uint64_t usTimeout, void *callback, void *arg, void *contextPtr)
+{
+  struct Context *context = (struct Context*)contextPtr;
+  return implWritev((aioObject*)object, (const aioIoVec*)context->Buffer, context->IoVecCount, flags, usTimeout, (aioCb*)callback, arg, &context->BytesTransferred);
+}
+
+static asyncOpRoot *implSendFileProxy(aioObjectRoot *object, AsyncFlags flags, uint64_t usTimeout, void *callback, void *arg, void *contextPtr)
+{
+  struct Context *context = (struct Context*)contextPtr;
+  return implSendFile((aioObject*)object, context->File, context->FileOffset, context->TransactionSize, flags, usTimeout, (aioCb*)callback, arg, &context->BytesTransferred);
+}
+
 void aioConnect(aioObject *object,
                 const HostAddress *address,
                 uint64_t usTimeout,
@@ -406,11 +853,7 @@ void aioAccept(aioObject *object,
                aioAcceptCb callback,
                void *arg)
 {
-#ifdef OS_WINDOWS
-  AsyncFlags flags = afNone;
-#else
-  AsyncFlags flags = afRunning;
-#endif
+  AsyncFlags flags = readinessFlags(object->root.base);
   struct Context context;
   fillContext(&context, object->root.base->methodImpl.accept, acceptFinish, 0, 0);
   asyncOpRoot *op = newAsyncOp(&object->root, flags, usTimeout, (void*)callback, arg, actAccept, &context);
@@ -457,6 +900,54 @@ ssize_t aioWrite(aioObject *object,
   return context.Result;
 }
 
+ssize_t aioReadv(aioObject *object,
+                 const aioIoVec *iov,
+                 size_t iovCount,
+                 AsyncFlags flags,
+                 uint64_t usTimeout,
+                 aioCb callback,
+                 void *arg)
+{
+  struct Context context;
+  fillContext(&context, 0, vectorFinish, (void*)((uintptr_t)iov), 0);
+  context.IoVecCount = iovCount;
+  asyncOpRoot *op = newVectorAsyncOp(&object->root, flags, usTimeout, (void*)callback, arg, actReadv, &context);
+  combinerPushOperation(op, aaStart);
+  return -(ssize_t)aosPending;
+}
+
+ssize_t aioWritev(aioObject *object,
+                  const aioIoVec *iov,
+                  size_t iovCount,
+                  AsyncFlags flags,
+                  uint64_t usTimeout,
+                  aioCb callback,
+                  void *arg)
+{
+  struct Context context;
+  fillContext(&context, 0, vectorFinish, (void*)((uintptr_t)iov), 0);
+  context.IoVecCount = iovCount;
+  runAioOperation(&object->root, newVectorAsyncOp, implWritevProxy, makeResult, initOp, flags, usTimeout, (void*)callback, arg, actWritev, &context);
+  return context.Result;
+}
+
+ssize_t aioSendFile(aioObject *object,
+                    iodevTy file,
+                    uint64_t offset,
+                    size_t size,
+                    AsyncFlags flags,
+                    uint64_t usTimeout,
+                    aioCb callback,
+                    void *arg)
+{
+  struct Context context;
+  fillContext(&context, 0, rwFinish, 0, size);
+  context.File = file;
+  context.FileOffset = offset;
+  runAioOperation(&object->root, newSendFileOp, implSendFileProxy, makeResult, initOp, flags, usTimeout, (void*)callback, arg, actSendFile, &context);
+  return context.Result;
+}
+
 ssize_t aioReadMsg(aioObject *object,
                    void *buffer,
                    size_t size,
@@ -483,6 +974,7 @@ ssize_t aioReadMsg(aioObject *object,
     host.port = source.sin_port;
     currentFinishedSync++;
     if (++currentFinishedSync < MAX_SYNCHRONOUS_FINISHED_OPERATION && (callback == 0 || flags & afActiveOnce)) {
+      STATS_ADD(object->root.base, opsCompletedSync, 1);
       return result;
     } else {
       asyncOp *op = (asyncOp*)newAsyncOp(&object->root, flags, usTimeout, (void*)callback, arg, actReadMsg, &context);
@@ -526,6 +1018,7 @@ ssize_t aioWriteMsg(aioObject *object,
   if (result >= 0) {
     currentFinishedSync++;
     if (++currentFinishedSync < MAX_SYNCHRONOUS_FINISHED_OPERATION && (callback == 0 || flags & afActiveOnce)) {
+      STATS_ADD(object->root.base, opsCompletedSync, 1);
       return result;
     } else {
       asyncOp *op = (asyncOp*)newAsyncOp(&object->root, flags, usTimeout, (void*)callback, arg, actWriteMsg, &context);
@@ -542,6 +1035,270 @@ ssize_t aioWriteMsg(aioObject *object,
   return -(ssize_t)aosPending;
 }
 
+static asyncOp *newMsgBatchOpFrom(aioObject *object,
+                                  aioMsg *msgs,
+                                  size_t count,
+                                  size_t done,
+                                  int isWrite,
+                                  AsyncFlags flags,
+                                  uint64_t usTimeout,
+                                  void *callback,
+                                  void *arg,
+                                  aioFinishProc *finishProc)
+{
+  struct asyncImpl *impl = &object->root.base->methodImpl;
+  aioExecuteProc *batchProc = isWrite ? impl->writeMsgBatch : impl->readMsgBatch;
+  struct Context context;
+  asyncOp *op;
+  if (batchProc) {
+    fillContext(&context, batchProc, finishProc, 0, 0);
+    op = (asyncOp*)newAsyncOp(&object->root, flags, usTimeout, callback, arg, isWrite ? actWriteMsgBatch : actReadMsgBatch, &context);
+    op->transactionSize = count;
+  } else {
+    // Finish procedure sends next message, it is called only for operation with callback
+    if (isWrite && count > 1 && !callback && !(flags & afCoroutine))
+      callback = (void*)msgBatchNoCallback;
+    fillContext(&context, isWrite ? impl->writeMsg : impl->readMsg, finishProc, msgs[done].buffer, msgs[done].size);
+    op = (asyncOp*)newAsyncOp(&object->root, flags | afNoCopy, usTimeout, callback, arg, isWrite ? actWriteMsg : actReadMsg, &context);
+    op->host = msgs[done].address;
+  }
+
+  op->msgs = msgs;
+  op->msgsCount = count;
+  op->msgsDone = done;
+  return op;
+}
+
+static asyncOp *newMsgBatchOp(aioObject *object,
+                              aioMsg *msgs,
+                              size_t count,
+                              int isWrite,
+                              AsyncFlags flags,
+                              uint64_t usTimeout,
+                              void *callback,
+                              void *arg,
+                              aioFinishProc *finishProc)
+{
+  return newMsgBatchOpFrom(object, msgs, count, 0, isWrite, flags, usTimeout, callback, arg, finishProc);
+}
+
+static asyncOp *msgBatchNextOp(asyncOp *op, aioFinishProc *finishProc)
+{
+  // Backend without batch support sends messages one by one, next one started after previous was sent
+  if (op->root.opCode != actWriteMsg || opGetStatus(&op->root) != aosSuccess || op->msgsDone+1 >= op->msgsCount)
+    return 0;
+  return newMsgBatchOpFrom((aioObject*)op->root.object,
+                           op->msgs,
+                           op->msgsCount,
+                           op->msgsDone+1,
+                           1,
+                           op->root.flags,
+                           op->root.timeout,
+                           op->root.callback,
+                           op->root.arg,
+                           finishProc);
+}
+
+static asyncOp *newReadMappedOp(aioObject *object,
+                                size_t size,
+                                AsyncFlags flags,
+                                uint64_t usTimeout,
+                                void *callback,
+                                void *arg,
+                                aioFinishProc *finishProc)
+{
+  struct asyncImpl *impl = &object->root.base->methodImpl;
+  struct Context context;
+  asyncOp *op;
+  if (impl->readMapped && object->root.type == ioObjectSocket) {
+    fillContext(&context, impl->readMapped, finishProc, 0, size);
+    op = (asyncOp*)newAsyncOp(&object->root, flags, usTimeout, callback, arg, actReadMapped, &context);
+  } else {
+    // Plain read to buffer passed to caller as mapped buffer tail
+    fillContext(&context, impl->read, finishProc, malloc(size), size);
+    op = (asyncOp*)newAsyncOp(&object->root, flags, usTimeout, callback, arg, actRead, &context);
+  }
+
+  op->mapping = 0;
+  op->mappingSize = 0;
+  op->mappedSize = 0;
+  op->segments = 0;
+  op->segmentsCount = 0;
+  return op;
+}
+
+void aioReadMapped(aioObject *object,
+                   size_t size,
+                   AsyncFlags flags,
+                   uint64_t usTimeout,
+                   aioReadMappedCb callback,
+                   void *arg)
+{
+  // Finish procedure releases received data, it is called only for operation with callback
+  if (!callback && !(flags & afCoroutine))
+    callback = mappedNoCallback;
+  asyncOp *op = newReadMappedOp(object, size, flags, usTimeout, (void*)callback, arg, readMappedFinish);
+  combinerPushOperation(&op->root, aaStart);
+}
+
+void aioReleaseMapped(aioMappedBuffer *buffer)
+{
+#ifndef OS_WINDOWS
+  if (buffer->mapping)
+    munmap(buffer->mapping, buffer->mappingSize);
+#endif
+  free(buffer->tail);
+  free(buffer->segments);
+  buffer->segments = 0;
+  buffer->tail = buffer->mapping = 0;
+  buffer->segmentsCount = buffer->size = buffer->tailSize = buffer->mappingSize = 0;
+}
+
+static asyncOp *newReadProvidedOp(aioObject *object,
+                                  AsyncFlags flags,
+                                  uint64_t usTimeout,
+                                  void *callback,
+                                  void *arg,
+                                  aioFinishProc *finishProc)
+{
+  struct asyncImpl *impl = &object->root.base->methodImpl;
+  struct Context context;
+  asyncOp *op;
+  if (impl->readProvided) {
+    fillContext(&context, impl->readProvided, finishProc, 0, object->root.base->providedBufferSize);
+    op = (asyncOp*)newAsyncOp(&object->root, flags, usTimeout, callback, arg, actReadProvided, &context);
+  } else {
+    // Plain read to pool buffer taken in advance
+    size_t size;
+    void *buffer = providedBufferAlloc(object->root.base, &size);
+    fillContext(&context, impl->read, finishProc, buffer, size);
+    op = (asyncOp*)newAsyncOp(&object->root, flags & ~afWaitAll, usTimeout, callback, arg, actRead, &context);
+  }
+
+  return op;
+}
+
+void aioReadProvided(aioObject *object,
+                     AsyncFlags flags,
+                     uint64_t usTimeout,
+                     aioReadProvidedCb callback,
+                     void *arg)
+{
+  // Finish procedure returns buffer to pool, it is called only for operation with callback
+  if (!callback && !(flags & afCoroutine))
+    callback = providedNoCallback;
+  asyncOp *op = newReadProvidedOp(object, flags, usTimeout, (void*)callback, arg, readProvidedFinish);
+  combinerPushOperation(&op->root, aaStart);
+}
+
+void aioReleaseProvided(aioObject *object, void *buffer)
+{
+  if (buffer)
+    providedBufferFree(object->root.base, buffer);
+}
+
+static void pushSpliceOp(aioObject *object,
+                         iodevTy pipe,
+                         size_t size,
+                         int opCode,
+                         AsyncFlags flags,
+                         uint64_t usTimeout,
+                         aioCb callback,
+                         void *arg)
+{
+  aioExecuteProc *spliceProc = object->root.base->methodImpl.splice;
+  struct Context context;
+  fillContext(&context, spliceProc, rwFinish, 0, size);
+  asyncOp *op = (asyncOp*)newAsyncOp(&object->root, flags | afNoCopy, usTimeout, (void*)callback, arg, opCode, &context);
+  op->file = pipe;
+  if (spliceProc && object->root.type == ioObjectSocket) {
+    combinerPushOperation(&op->root, aaStart);
+  } else {
+    opForceStatus(&op->root, aosUnknownError);
+    addToGlobalQueue(&op->root);
+  }
+}
+
+void aioSpliceFrom(aioObject *object,
+                   iodevTy pipe,
+                   size_t size,
+                   AsyncFlags flags,
+                   uint64_t usTimeout,
+                   aioCb callback,
+                   void *arg)
+{
+  pushSpliceOp(object, pipe, size, actSpliceFrom, flags, usTimeout, callback, arg);
+}
+
+void aioSpliceTo(aioObject *object,
+                 iodevTy pipe,
+                 size_t size,
+                 AsyncFlags flags,
+                 uint64_t usTimeout,
+                 aioCb callback,
+                 void *arg)
+{
+  pushSpliceOp(object, pipe, size, actSpliceTo, flags, usTimeout, callback, arg);
+}
+
+ssize_t aioReadMsgBatch(aioObject *object,
+                        aioMsg *msgs,
+                        size_t count,
+                        AsyncFlags flags,
+                        uint64_t usTimeout,
+                        aioMsgBatchCb callback,
+                        void *arg)
+{
+  ssize_t result = object->root.base->methodImpl.readMsgBatch ? socketReadMsgBatch(object->hSocket, msgs, count) : -1;
+  if (result > 0) {
+    // Data received synchronously
+    if (++currentFinishedSync < MAX_SYNCHRONOUS_FINISHED_OPERATION && (callback == 0 || flags & afActiveOnce)) {
+      STATS_ADD(object->root.base, opsCompletedSync, 1);
+      return result;
+    } else {
+      asyncOp *op = newMsgBatchOp(object, msgs, count, 0, flags, usTimeout, (void*)callback, arg, msgBatchFinish);
+      op->bytesTransferred = (size_t)result;
+      opForceStatus(&op->root, aosSuccess);
+      addToGlobalQueue(&op->root);
+    }
+  } else {
+    asyncOp *op = newMsgBatchOp(object, msgs, count, 0, flags, usTimeout, (void*)callback, arg, msgBatchFinish);
+    combinerPushOperation(&op->root, aaStart);
+  }
+
+  return -(ssize_t)aosPending;
+}
+
+ssize_t aioWriteMsgBatch(aioObject *object,
+                         aioMsg *msgs,
+                         size_t count,
+                         AsyncFlags flags,
+                         uint64_t usTimeout,
+                         aioMsgBatchCb callback,
+                         void *arg)
+{
+  // Datagram socket can be accessed by multiple threads without lock
+  ssize_t result = object->root.base->methodImpl.writeMsgBatch ? socketWriteMsgBatch(object->hSocket, msgs, count) : -1;
+  if (result == (ssize_t)count) {
+    if (++currentFinishedSync < MAX_SYNCHRONOUS_FINISHED_OPERATION && (callback == 0 || flags & afActiveOnce)) {
+      STATS_ADD(object->root.base, opsCompletedSync, 1);
+      return result;
+    } else {
+      asyncOp *op = newMsgBatchOp(object, msgs, count, 1, flags, usTimeout, (void*)callback, arg, msgBatchFinish);
+      op->bytesTransferred = (size_t)result;
+      opForceStatus(&op->root, aosSuccess);
+      addToGlobalQueue(&op->root);
+    }
+  } else {
+    // Send remaining messages asynchronously
+    asyncOp *op = newMsgBatchOp(object, msgs, count, 1, flags, usTimeout, (void*)callback, arg, msgBatchFinish);
+    op->bytesTransferred = result > 0 ? (size_t)result : 0;
+    combinerPushOperation(&op->root, aaStart);
+  }
+
+  return -(ssize_t)aosPending;
+}
+
 
 int ioConnect(aioObject *object, const HostAddress *address, uint64_t usTimeout)
 {
@@ -559,11 +1316,7 @@ int ioConnect(aioObject *object, const HostAddress *address, uint64_t usTimeout)
 
 socketTy ioAccept(aioObject *object, uint64_t usTimeout)
 {
-#ifdef OS_WINDOWS
-  AsyncFlags flags = afNone;
-#else
-  AsyncFlags flags = afRunning;
-#endif
+  AsyncFlags flags = readinessFlags(object->root.base);
   struct Context context;
   fillContext(&context, object->root.base->methodImpl.accept, acceptFinish, 0, 0);
   asyncOp *op = (asyncOp*)newAsyncOp(&object->root, flags | afCoroutine, usTimeout, 0, 0, actAccept, &context);
@@ -594,6 +1347,37 @@ ssize_t ioWrite(aioObject *object, const void *buffer, size_t size, AsyncFlags f
   return op ? coroutineRwFinish((asyncOp*)op, object) : (ssize_t)context.BytesTransferred;
 }
 
+ssize_t ioReadv(aioObject *object, const aioIoVec *iov, size_t iovCount, AsyncFlags flags, uint64_t usTimeout)
+{
+  struct Context context;
+  fillContext(&context, 0, 0, (void*)((uintptr_t)iov), 0);
+  context.IoVecCount = iovCount;
+  asyncOp *op = (asyncOp*)newVectorAsyncOp(&object->root, flags | afCoroutine, usTimeout, 0, 0, actReadv, &context);
+  combinerPushOperation(&op->root, aaStart);
+  coroutineYield();
+  vectorScatter(op);
+  return coroutineRwFinish(op, object);
+}
+
+ssize_t ioWritev(aioObject *object, const aioIoVec *iov, size_t iovCount, AsyncFlags flags, uint64_t usTimeout)
+{
+  struct Context context;
+  fillContext(&context, 0, 0, (void*)((uintptr_t)iov), 0);
+  context.IoVecCount = iovCount;
+  asyncOpRoot *op = runIoOperation(&object->root, newVectorAsyncOp, implWritevProxy, initOp, flags, usTimeout, actWritev, &context);
+  return op ? coroutineRwFinish((asyncOp*)op, object) : (ssize_t)context.BytesTransferred;
+}
+
+ssize_t ioSendFile(aioObject *object, iodevTy file, uint64_t offset, size_t size, AsyncFlags flags, uint64_t usTimeout)
+{
+  struct Context context;
+  fillContext(&context, 0, 0, 0, size);
+  context.File = file;
+  context.FileOffset = offset;
+  asyncOpRoot *op = runIoOperation(&object->root, newSendFileOp, implSendFileProxy, initOp, flags, usTimeout, actSendFile, &context);
+  return op ? coroutineRwFinish((asyncOp*)op, object) : (ssize_t)context.BytesTransferred;
+}
+
 ssize_t ioReadMsg(aioObject *object, void *buffer, size_t size, AsyncFlags flags, uint64_t usTimeout)
 {
   // Datagram socket can be accessed by multiple threads without lock
@@ -617,6 +1401,7 @@ ssize_t ioReadMsg(aioObject *object, void *buffer, size_t size, AsyncFlags flags
       coroutineYield();
       return coroutineRwFinish(op, object);
     } else {
+      STATS_ADD(object->root.base, opsCompletedSync, 1);
       return result;
     }
   }
@@ -652,6 +1437,7 @@ ssize_t ioWriteMsg(aioObject *object, const HostAddress *address, const void *bu
       coroutineYield();
       return coroutineRwFinish(op, object);
     } else {
+      STATS_ADD(object->root.base, opsCompletedSync, 1);
       return result;
     }
   }
@@ -682,3 +1468,88 @@ void ioWaitUserEvent(aioUserEvent *event)
   event->root.callback = 0;
   event->root.arg = 0;
 }
+
+static ssize_t coroutineMsgBatchFinish(asyncOp *op)
+{
+  AsyncOpStatus status = opGetStatus(&op->root);
+  size_t result = msgBatchResult(op);
+  releaseAsyncOp(&op->root);
+  return status == aosSuccess ? (ssize_t)result : -(int)status;
+}
+
+ssize_t ioReadMapped(aioObject *object, size_t size, AsyncFlags flags, uint64_t usTimeout, aioMappedBuffer *buffer)
+{
+  asyncOp *op = newReadMappedOp(object, size, flags | afCoroutine, usTimeout, 0, 0, 0);
+  combinerPushOperation(&op->root, aaStart);
+  coroutineYield();
+  AsyncOpStatus status = opGetStatus(&op->root);
+  mappedBufferFromOp(op, buffer);
+  releaseAsyncOp(&op->root);
+  return status == aosSuccess ? (ssize_t)buffer->size : -(int)status;
+}
+
+ssize_t ioReadProvided(aioObject *object, AsyncFlags flags, uint64_t usTimeout, void **buffer)
+{
+  asyncOp *op = newReadProvidedOp(object, flags | afCoroutine, usTimeout, 0, 0, 0);
+  combinerPushOperation(&op->root, aaStart);
+  coroutineYield();
+  AsyncOpStatus status = opGetStatus(&op->root);
+  size_t bytesTransferred = op->bytesTransferred;
+  *buffer = providedBufferFromOp(op);
+  releaseAsyncOp(&op->root);
+  return status == aosSuccess ? (ssize_t)bytesTransferred : -(int)status;
+}
+
+ssize_t ioReadMsgBatch(aioObject *object, aioMsg *msgs, size_t count, AsyncFlags flags, uint64_t usTimeout)
+{
+  ssize_t result = object->root.base->methodImpl.readMsgBatch ? socketReadMsgBatch(object->hSocket, msgs, count) : -1;
+  if (result > 0) {
+    // Data received synchronously
+    if (++currentFinishedSync >= MAX_SYNCHRONOUS_FINISHED_OPERATION) {
+      asyncOp *op = newMsgBatchOp(object, msgs, count, 0, flags | afCoroutine, usTimeout, 0, 0, 0);
+      op->bytesTransferred = (size_t)result;
+      opForceStatus(&op->root, aosSuccess);
+      addToGlobalQueue(&op->root);
+      coroutineYield();
+      return coroutineMsgBatchFinish(op);
+    } else {
+      STATS_ADD(object->root.base, opsCompletedSync, 1);
+      return result;
+    }
+  }
+
+  asyncOp *op = newMsgBatchOp(object, msgs, count, 0, flags | afCoroutine, usTimeout, 0, 0, 0);
+  combinerPushOperation(&op->root, aaStart);
+  coroutineYield();
+  return coroutineMsgBatchFinish(op);
+}
+
+ssize_t ioWriteMsgBatch(aioObject *object, aioMsg *msgs, size_t count, AsyncFlags flags, uint64_t usTimeout)
+{
+  ssize_t result = object->root.base->methodImpl.writeMsgBatch ? socketWriteMsgBatch(object->hSocket, msgs, count) : -1;
+  if (result == (ssize_t)count) {
+    if (++currentFinishedSync >= MAX_SYNCHRONOUS_FINISHED_OPERATION) {
+      asyncOp *op = newMsgBatchOp(object, msgs, count, 1, flags | afCoroutine, usTimeout, 0, 0, 0);
+      op->bytesTransferred = (size_t)result;
+      opForceStatus(&op->root, aosSuccess);
+      addToGlobalQueue(&op->root);
+      coroutineYield();
+      return coroutineMsgBatchFinish(op);
+    } else {
+      STATS_ADD(object->root.base, opsCompletedSync, 1);
+      return result;
+    }
+  }
+
+  asyncOp *op = newMsgBatchOp(object, msgs, count, 1, flags | afCoroutine, usTimeout, 0, 0, 0);
+  op->bytesTransferred = result > 0 ? (size_t)result : 0;
+  for (;;) {
+    combinerPushOperation(&op->root, aaStart);
+    coroutineYield();
+    asyncOp *next = msgBatchNextOp(op, 0);
+    if (!next)
+      return coroutineMsgBatchFinish(op);
+    releaseAsyncOp(&op->root);
+    op = next;
+  }
+}
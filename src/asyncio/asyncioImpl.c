@@ -1,18 +1,56 @@
 #include "asyncioImpl.h"
+#include "asyncio/bufferPool.h"
 #include "asyncio/coroutine.h"
+#include "asyncio/socket.h"
 #include "atomic.h"
 #include <assert.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#ifndef WIN32
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
 #include <signal.h>
+#include <unistd.h>
 #endif
 
-#define PAGE_MAP_SIZE (1u << 16)
-
 __tls unsigned currentFinishedSync;
 __tls unsigned messageLoopThreadId;
+__tls asyncBase *threadQueueBase;
+__tls asyncStatsSlot *threadStats;
+static __tls unsigned threadQueueIndex;
+// Approximate number of operations in own run queue (stealing threads pop without updating it)
+static __tls unsigned threadQueueBacklog;
+
+// Per-thread magazines for object pools, set associative cache indexed by hash of pool address
+// (pools are often neighbour fields of one structure, plain address bits collide)
+#define OP_MAGAZINE_SIZE 32
+#define OP_MAGAZINE_SETS_LOG2 2
+#define OP_MAGAZINE_WAYS 4
+
+typedef struct opMagazine {
+  ConcurrentQueue *pool;
+  unsigned count;
+  void *items[OP_MAGAZINE_SIZE];
+} opMagazine;
+
+typedef struct opMagazineSet {
+  opMagazine ways[OP_MAGAZINE_WAYS];
+  unsigned victim;
+} opMagazineSet;
+
+static __tls opMagazineSet opMagazines[1 << OP_MAGAZINE_SETS_LOG2];
+// Thread exit destructor registered on first magazine use
+static __tls int opMagazinesRegistered;
+#ifdef WIN32
+static DWORD opMagazinesFlsIndex = FLS_OUT_OF_INDEXES;
+static INIT_ONCE opMagazinesKeyOnce = INIT_ONCE_STATIC_INIT;
+#else
+static pthread_key_t opMagazinesKey;
+static pthread_once_t opMagazinesKeyOnce = PTHREAD_ONCE_INIT;
+#endif
 
 ConcurrentQueue asyncOpLinkListPool;
 
@@ -47,23 +85,6 @@ void eqPushBack(List *list, asyncOpRoot *op)
   }
 }
 
-static inline uint64_t getPt(uint64_t endTime)
-{
-  return (endTime / 1000000) + (endTime % 1000000 != 0);
-}
-
-static inline void pageMapKeys(uint64_t tm, uint32_t *lo, uint32_t *hi)
-{
-  uint32_t ltm = (uint32_t)tm;
-  *hi = ltm >> 16;
-  *lo = ltm & 0xFFFF;
-}
-
-static inline void *pageMapAlloc()
-{
-  return calloc(PAGE_MAP_SIZE, sizeof(void*));
-}
-
 void *alignedMalloc(size_t size, size_t alignment)
 {
 #ifdef OS_COMMONUNIX
@@ -86,51 +107,18 @@ void __tagged_pointer_decode(void *ptr, void **outPtr, uintptr_t *outData)
   *outData = p & TAGGED_POINTER_DATA_MASK;
 }
 
-void pageMapInit(pageMap *map)
-{
-  map->map = (asyncOpListLink***)pageMapAlloc();
-  map->lock = 0;
-}
-
-asyncOpListLink *pageMapExtractAll(pageMap *map, uint64_t tm)
-{
-  uint32_t lo;
-  uint32_t hi;
-  pageMapKeys(tm, &lo, &hi);
-  asyncOpListLink **p1 = map->map[hi];
-  return p1 ? __pointer_atomic_exchange((void* volatile*)&p1[lo], 0) : 0;
-}
-
-void pageMapAdd(pageMap *map, asyncOpListLink *link)
-{
-  uint32_t lo;
-  uint32_t hi;
-  pageMapKeys(getPt(link->op->endTime), &lo, &hi);
-  asyncOpListLink **p1 = map->map[hi];
-  if (!p1) {
-    p1 = (asyncOpListLink**)pageMapAlloc();
-    if (!__pointer_atomic_compare_and_swap((void* volatile*)&map->map[hi], 0, p1)) {
-      free(p1);
-      p1 = map->map[hi];
-    }
-  }
-
-  asyncOpListLink *current;
-  do {
-    current = link->next = p1[lo];
-  } while (!__pointer_atomic_compare_and_swap((void* volatile*)&p1[lo], current, link));
-}
-
 uintptr_t objectIncrementReference(aioObjectRoot *object, uintptr_t count)
 {
-  uintptr_t result = __uintptr_atomic_fetch_and_add(&object->refs, count);
+  // New reference is always derived from existing one, no ordering needed
+  uintptr_t result = __uintptr_atomic_fetch_and_add_explicit(&object->refs, count, __ATOMIC_RELAXED);
   assert(result != 0 && "Removed object access detected");
   return result;
 }
 
 uintptr_t objectDecrementReference(aioObjectRoot *object, uintptr_t count)
 {
-  uintptr_t result = __uintptr_atomic_fetch_and_add(&object->refs, (uintptr_t)0-count);
+  // Release own accesses, last owner acquires all of them before delete
+  uintptr_t result = __uintptr_atomic_fetch_and_add_explicit(&object->refs, (uintptr_t)0-count, __ATOMIC_ACQ_REL);
   assert((intptr_t)result > 0 && "Double object release detected");
   if (result == count)
     combinerPushCounter(object, COMBINER_TAG_DELETE);
@@ -149,7 +137,8 @@ uintptr_t eventDecrementReference(aioUserEvent *event, uintptr_t tag)
     if (event->destructorCb)
       event->destructorCb(event, event->destructorCbArg);
 
-    concurrentQueuePush(event->root.objectPool, event);
+    STATS_ADD(event->base, opsReleased, 1);
+    objectPoolPush(event->root.objectPool, event);
   }
 
   return result;
@@ -177,37 +166,190 @@ void eventDeactivate(aioUserEvent *event)
     __uintptr_atomic_fetch_and_add(&event->tag, (uintptr_t)0-TAG_EVENT_OP);
 }
 
+uint64_t getMonotonicTimeNs(void)
+{
+#ifdef WIN32
+  LARGE_INTEGER counter;
+  LARGE_INTEGER frequency;
+  QueryPerformanceCounter(&counter);
+  QueryPerformanceFrequency(&frequency);
+  return (uint64_t)(counter.QuadPart / frequency.QuadPart * 1000000000 + counter.QuadPart % frequency.QuadPart * 1000000000 / frequency.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec*1000000000 + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+uint64_t getMonotonicTimeMs(void)
+{
+#ifdef WIN32
+  return GetTickCount64();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec*1000 + (uint64_t)ts.tv_nsec/1000000;
+#endif
+}
+
+static inline void linkPush(asyncOpListLink **list, asyncOpListLink *link)
+{
+  link->next = *list;
+  *list = link;
+}
+
+static void timerWheelInsert(timerWheel *wheel, asyncOpListLink *link)
+{
+  uint64_t endTime = link->endTime > wheel->current ? link->endTime : wheel->current;
+  uint64_t delta = endTime - wheel->current;
+  if (delta < TIMER_WHEEL_ROOT_SIZE) {
+    unsigned index = (unsigned)(endTime & (TIMER_WHEEL_ROOT_SIZE-1));
+    wheel->rootMask[index / 64] |= ((uint64_t)1) << (index % 64);
+    linkPush(&wheel->root[index], link);
+    return;
+  }
+
+  unsigned level = 0;
+  unsigned shift = TIMER_WHEEL_ROOT_BITS;
+  while (level < TIMER_WHEEL_LEVELS-1 && delta >= ((uint64_t)1 << (shift + TIMER_WHEEL_LEVEL_BITS))) {
+    level++;
+    shift += TIMER_WHEEL_LEVEL_BITS;
+  }
+
+  // Timeouts beyond wheel range placed to last slot and will be reinserted later
+  if (delta >= ((uint64_t)1 << (shift + TIMER_WHEEL_LEVEL_BITS)))
+    endTime = wheel->current + ((uint64_t)1 << (shift + TIMER_WHEEL_LEVEL_BITS)) - 1;
+  linkPush(&wheel->levels[level][(endTime >> shift) & (TIMER_WHEEL_LEVEL_SIZE-1)], link);
+}
+
+static unsigned timerWheelCascade(timerWheel *wheel, unsigned level)
+{
+  unsigned shift = TIMER_WHEEL_ROOT_BITS + level*TIMER_WHEEL_LEVEL_BITS;
+  unsigned index = (unsigned)((wheel->current >> shift) & (TIMER_WHEEL_LEVEL_SIZE-1));
+  asyncOpListLink *link = wheel->levels[level][index];
+  wheel->levels[level][index] = 0;
+  while (link) {
+    asyncOpListLink *next = link->next;
+    timerWheelInsert(wheel, link);
+    link = next;
+  }
+
+  return index;
+}
+
+static inline int timerWheelRootEmpty(timerWheel *wheel)
+{
+  unsigned i;
+  for (i = 0; i < TIMER_WHEEL_ROOT_SIZE/64; i++) {
+    if (wheel->rootMask[i])
+      return 0;
+  }
+
+  return 1;
+}
+
+void timeoutQueueInit(asyncBase *base)
+{
+  memset(&base->timerWheel, 0, sizeof(timerWheel));
+  base->timerWheel.current = getMonotonicTimeMs();
+  base->timerWheelLock = 0;
+}
+
 void addToTimeoutQueue(asyncBase *base, asyncOpRoot *op)
 {
   asyncOpListLink *timerLink = 0;
-  if (!concurrentQueuePop(&asyncOpLinkListPool, (void**)&timerLink))
+  if (!objectPoolPop(&asyncOpLinkListPool, (void**)&timerLink))
     timerLink = malloc(sizeof(asyncOpListLink));
   timerLink->op = op;
   timerLink->tag = opGetGeneration(op);
-  pageMapAdd(&base->timerMap, timerLink);
+  // round up to milliseconds, timeout can't fire earlier than requested
+  timerLink->endTime = getMonotonicTimeMs() + (op->timeout + 999) / 1000;
   op->timerId = timerLink;
+
+  __spinlock_acquire(&base->timerWheelLock);
+  timerWheelInsert(&base->timerWheel, timerLink);
+  base->timerWheel.count++;
+  __spinlock_release(&base->timerWheelLock);
 }
 
-void processTimeoutQueue(asyncBase *base, time_t currentTime)
+void processTimeoutQueue(asyncBase *base, uint64_t currentTime)
 {
-  // TODO: handle system date change
-  if (base->lastCheckPoint >= currentTime || !__spinlock_try_acquire(&base->timerMapLock))
+  timerWheel *wheel = &base->timerWheel;
+  asyncOpListLink *expired = 0;
+  if (wheel->current > currentTime || !__spinlock_try_acquire(&base->timerWheelLock))
     return;
 
-  // check timeout queue
-  time_t begin = base->lastCheckPoint;
-  for (; begin < currentTime; begin++) {
-    asyncOpListLink *link = pageMapExtractAll(&base->timerMap, (uint64_t)begin);
+  while (wheel->current <= currentTime) {
+    if (wheel->count == 0) {
+      wheel->current = currentTime + 1;
+      break;
+    }
+
+    unsigned index = (unsigned)(wheel->current & (TIMER_WHEEL_ROOT_SIZE-1));
+    if (index == 0) {
+      unsigned level = 0;
+      while (level < TIMER_WHEEL_LEVELS && timerWheelCascade(wheel, level) == 0)
+        level++;
+    }
+
+    if (timerWheelRootEmpty(wheel)) {
+      // Nothing to do until next root level turn
+      uint64_t nextTurn = (wheel->current | (TIMER_WHEEL_ROOT_SIZE-1)) + 1;
+      wheel->current = nextTurn <= currentTime ? nextTurn : currentTime + 1;
+      continue;
+    }
+
+    asyncOpListLink *link = wheel->root[index];
+    wheel->root[index] = 0;
+    wheel->rootMask[index / 64] &= ~(((uint64_t)1) << (index % 64));
     while (link) {
       asyncOpListLink *next = link->next;
-      opCancel(link->op, link->tag, aosTimeout);
-      concurrentQueuePush(&asyncOpLinkListPool, link);
+      linkPush(&expired, link);
+      wheel->count--;
       link = next;
     }
+
+    wheel->current++;
   }
 
-  base->lastCheckPoint = currentTime;
-  __spinlock_release(&base->timerMapLock);
+  __spinlock_release(&base->timerWheelLock);
+
+  // Cancel operations without lock: cancellation can restart operation and access timer wheel
+  while (expired) {
+    asyncOpListLink *next = expired->next;
+    opCancel(expired->op, expired->tag, aosTimeout);
+    objectPoolPush(&asyncOpLinkListPool, expired);
+    expired = next;
+  }
+}
+
+unsigned timeoutQueueWaitTime(asyncBase *base, uint64_t currentTime, unsigned maxWaitTime)
+{
+  timerWheel *wheel = &base->timerWheel;
+  unsigned waitTime = maxWaitTime;
+  if (wheel->count == 0 || !__spinlock_try_acquire(&base->timerWheelLock))
+    return waitTime;
+
+  if (wheel->current <= currentTime) {
+    waitTime = 0;
+  } else {
+    // Search nearest root slot in current turn, otherwise wake up at next turn for cascading
+    uint64_t distance = (wheel->current | (TIMER_WHEEL_ROOT_SIZE-1)) + 1 - wheel->current;
+    unsigned index = (unsigned)(wheel->current & (TIMER_WHEEL_ROOT_SIZE-1));
+    for (; index < TIMER_WHEEL_ROOT_SIZE; index++) {
+      if (wheel->rootMask[index / 64] & (((uint64_t)1) << (index % 64))) {
+        distance = index - (wheel->current & (TIMER_WHEEL_ROOT_SIZE-1));
+        break;
+      }
+    }
+
+    uint64_t deadline = wheel->current + distance;
+    if (deadline - currentTime < waitTime)
+      waitTime = (unsigned)(deadline - currentTime);
+  }
+
+  __spinlock_release(&base->timerWheelLock);
+  return waitTime;
 }
 
 void initObjectRoot(aioObjectRoot *object, asyncBase *base, IoObjectTy type, aioObjectDestructor destructor)
@@ -217,6 +359,7 @@ void initObjectRoot(aioObjectRoot *object, asyncBase *base, IoObjectTy type, aio
   object->writeQueue.head = object->writeQueue.tail = 0;
   object->base = base;
   object->type = type;
+  object->traceKind = (aioTraceKind)type;
   object->refs = 1;
   object->destructor = destructor;
   object->destructorCb = 0;
@@ -230,6 +373,11 @@ void objectSetDestructorCb(aioObjectRoot *object, aioObjectDestructorCb callback
   object->destructorCbArg = arg;
 }
 
+void objectSetTraceKind(aioObjectRoot *object, aioTraceKind kind)
+{
+  object->traceKind = kind;
+}
+
 void eventSetDestructorCb(aioUserEvent *event, userEventDestructorCb callback, void *arg)
 {
   event->destructorCb = callback;
@@ -258,11 +406,95 @@ AsyncOpStatus opGetStatus(asyncOpRoot *op)
   return op->tag & TAG_STATUS_MASK;
 }
 
+static inline unsigned highestBit(uint64_t value)
+{
+#ifndef _MSC_VER
+  return 63 - (unsigned)__builtin_clzll(value);
+#else
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return (unsigned)index;
+#endif
+}
+
+static inline unsigned latencyBucketIndex(uint64_t value)
+{
+  if (value < 2*LATENCY_HISTOGRAM_HALF)
+    return (unsigned)value;
+  unsigned shift = highestBit(value) - (LATENCY_HISTOGRAM_SUB_BITS-1);
+  return (shift+1)*LATENCY_HISTOGRAM_HALF + (unsigned)(value >> shift) - LATENCY_HISTOGRAM_HALF;
+}
+
+uint64_t latencyBucketValue(unsigned index)
+{
+  // Highest value falling into bucket
+  if (index < 2*LATENCY_HISTOGRAM_HALF)
+    return index;
+  unsigned shift = index/LATENCY_HISTOGRAM_HALF - 1;
+  uint64_t subBucket = index%LATENCY_HISTOGRAM_HALF + LATENCY_HISTOGRAM_HALF;
+  return ((subBucket+1) << shift) - 1;
+}
+
+unsigned traceOpCodeSlot(int opCode)
+{
+  return (((unsigned)opCode >> 24) & 3)*16 + ((unsigned)opCode & 15);
+}
+
+static void latencyHistogramRecord(asyncBase *base, asyncOpRoot *op, uint64_t dispatchedTime)
+{
+  latencyHistogram *volatile *slot = &base->latencyHistograms[op->object->traceKind][traceOpCodeSlot(op->opCode)];
+  latencyHistogram *histogram = *slot;
+  if (!histogram) {
+    latencyHistogram *newHistogram = (latencyHistogram*)calloc(1, sizeof(latencyHistogram));
+    if (__pointer_atomic_compare_and_swap((void *volatile*)slot, 0, newHistogram)) {
+      histogram = newHistogram;
+    } else {
+      free(newHistogram);
+      histogram = *slot;
+    }
+  }
+
+  // Operation can finish without passing object queue
+  uint64_t startedTime = op->startedTime ? op->startedTime : op->createdTime;
+  uint64_t completedTime = op->completedTime ? op->completedTime : dispatchedTime;
+  __uint64_atomic_fetch_and_add(&histogram->queueDelay[latencyBucketIndex((startedTime - op->createdTime) + (dispatchedTime - completedTime))], 1);
+  __uint64_atomic_fetch_and_add(&histogram->ioTime[latencyBucketIndex(completedTime - startedTime)], 1);
+}
+
+static void opTrace(asyncOpRoot *op, aioTracePoint point)
+{
+  asyncBase *base = op->object->base;
+  uint64_t time = getMonotonicTimeNs();
+  switch (point) {
+    case atpCreated :
+      op->createdTime = time;
+      break;
+    case atpStarted :
+      op->startedTime = time;
+      break;
+    case atpCompleted :
+      op->completedTime = time;
+      break;
+    case atpDispatched :
+      if (base->latencyHistogramsEnabled)
+        latencyHistogramRecord(base, op, time);
+      break;
+  }
+
+  aioTraceCb *hook = base->traceHook;
+  if (hook)
+    hook(op, point, time, base->traceHookArg);
+}
+
 int opSetStatus(asyncOpRoot *op, uintptr_t generation, AsyncOpStatus status)
 {
-  return __uintptr_atomic_compare_and_swap(&op->tag,
-                                          (generation<<TAG_STATUS_SIZE) | aosPending,
-                                          (generation<<TAG_STATUS_SIZE) | (uintptr_t)status);
+  int result = __uintptr_atomic_compare_and_swap_explicit(&op->tag,
+                                                          (generation<<TAG_STATUS_SIZE) | aosPending,
+                                                          (generation<<TAG_STATUS_SIZE) | (uintptr_t)status,
+                                                          __ATOMIC_ACQ_REL);
+  if (result && op->createdTime)
+    opTrace(op, atpCompleted);
+  return result;
 }
 
 void opForceStatus(asyncOpRoot *op, AsyncOpStatus status)
@@ -275,6 +507,180 @@ uintptr_t opEncodeTag(asyncOpRoot *op, uintptr_t tag)
   return ((op->tag >> TAG_STATUS_SIZE) & ~((uintptr_t)TAGGED_POINTER_DATA_MASK)) | (tag & (uintptr_t)TAGGED_POINTER_DATA_MASK);
 }
 
+static inline void flushMagazine(opMagazine *magazine)
+{
+  while (magazine->count)
+    concurrentQueuePush(magazine->pool, magazine->items[--magazine->count]);
+}
+
+static void flushMagazines();
+
+#ifdef WIN32
+static VOID WINAPI magazinesThreadExit(PVOID data)
+{
+  if (data) {
+    opMagazinesRegistered = 0;
+    flushMagazines();
+  }
+}
+
+static BOOL CALLBACK magazinesKeyCreate(PINIT_ONCE once, PVOID param, PVOID *context)
+{
+  __UNUSED(once);
+  __UNUSED(param);
+  __UNUSED(context);
+  opMagazinesFlsIndex = FlsAlloc(magazinesThreadExit);
+  return TRUE;
+}
+#else
+static void magazinesThreadExit(void *data)
+{
+  // Later destructors can release objects again, they register magazines once more
+  __UNUSED(data);
+  opMagazinesRegistered = 0;
+  flushMagazines();
+}
+
+static void magazinesKeyCreate()
+{
+  pthread_key_create(&opMagazinesKey, magazinesThreadExit);
+}
+#endif
+
+static void registerMagazines()
+{
+  // Any thread can use magazines (aioWrite called by worker thread), exiting thread returns cached objects to pools
+  opMagazinesRegistered = 1;
+#ifdef WIN32
+  InitOnceExecuteOnce(&opMagazinesKeyOnce, magazinesKeyCreate, 0, 0);
+  FlsSetValue(opMagazinesFlsIndex, (PVOID)1);
+#else
+  pthread_once(&opMagazinesKeyOnce, magazinesKeyCreate);
+  pthread_setspecific(opMagazinesKey, (void*)1);
+#endif
+}
+
+static inline opMagazine *getMagazine(ConcurrentQueue *pool)
+{
+  unsigned i;
+  uint64_t hash = (uint64_t)(uintptr_t)pool * 0x9E3779B97F4A7C15ULL;
+  opMagazineSet *set = &opMagazines[hash >> (64 - OP_MAGAZINE_SETS_LOG2)];
+  for (i = 0; i < OP_MAGAZINE_WAYS; i++) {
+    if (set->ways[i].pool == pool)
+      return &set->ways[i];
+  }
+
+  for (i = 0; i < OP_MAGAZINE_WAYS; i++) {
+    if (!set->ways[i].pool)
+      break;
+  }
+
+  if (i == OP_MAGAZINE_WAYS) {
+    // All ways owned by other pools, return cached objects of victim to its pool
+    i = set->victim++ % OP_MAGAZINE_WAYS;
+    flushMagazine(&set->ways[i]);
+  }
+
+  if (!opMagazinesRegistered)
+    registerMagazines();
+  set->ways[i].pool = pool;
+  return &set->ways[i];
+}
+
+static void flushMagazines()
+{
+  unsigned i, j;
+  for (i = 0; i < (1 << OP_MAGAZINE_SETS_LOG2); i++) {
+    for (j = 0; j < OP_MAGAZINE_WAYS; j++) {
+      opMagazine *magazine = &opMagazines[i].ways[j];
+      if (magazine->pool) {
+        flushMagazine(magazine);
+        magazine->pool = 0;
+      }
+    }
+  }
+}
+
+int objectPoolPop(ConcurrentQueue *pool, void **data)
+{
+  opMagazine *magazine = getMagazine(pool);
+  if (!magazine->count) {
+    // Refill half of magazine, other half left for objects released by this thread
+    while (magazine->count < OP_MAGAZINE_SIZE/2 && concurrentQueuePop(pool, &magazine->items[magazine->count]))
+      magazine->count++;
+    if (!magazine->count)
+      return 0;
+  }
+
+  *data = magazine->items[--magazine->count];
+  return 1;
+}
+
+void objectPoolPush(ConcurrentQueue *pool, void *data)
+{
+  opMagazine *magazine = getMagazine(pool);
+  if (magazine->count == OP_MAGAZINE_SIZE) {
+    // Spill half of magazine to shared queue
+    while (magazine->count > OP_MAGAZINE_SIZE/2)
+      concurrentQueuePush(pool, magazine->items[--magazine->count]);
+  }
+
+  magazine->items[magazine->count++] = data;
+}
+
+// Provided buffer prefixed with its capacity, buffers allocated before aioSetProvidedBufferSize are freed
+typedef struct providedBufferHeader {
+  size_t capacity;
+  size_t reserved;
+} providedBufferHeader;
+
+void *providedBufferAlloc(asyncBase *base, size_t *size)
+{
+  // Pool grows up to peak number of buffers held at once, they are never returned to system
+  size_t capacity = base->providedBufferSize;
+  providedBufferHeader *header;
+  if (objectPoolPop(&base->providedBuffers, (void**)&header)) {
+    if (header->capacity == capacity) {
+      *size = capacity;
+      return header + 1;
+    }
+
+    free(header);
+  }
+
+  header = (providedBufferHeader*)malloc(sizeof(providedBufferHeader) + capacity);
+  header->capacity = capacity;
+  *size = capacity;
+  return header + 1;
+}
+
+void providedBufferFree(asyncBase *base, void *buffer)
+{
+  providedBufferHeader *header = (providedBufferHeader*)buffer - 1;
+  if (header->capacity == base->providedBufferSize)
+    objectPoolPush(&base->providedBuffers, header);
+  else
+    free(header);
+}
+
+void mappedSegmentAppend(asyncOp *op, void *data, size_t size)
+{
+  if (op->segmentsCount) {
+    aioIoVec *last = &op->segments[op->segmentsCount - 1];
+    if ((uint8_t*)last->iov_base + last->iov_len == (uint8_t*)data) {
+      last->iov_len += size;
+      return;
+    }
+  }
+
+  // Capacity doubles when count reaches power of 2
+  if ((op->segmentsCount & (op->segmentsCount - 1)) == 0)
+    op->segments = (aioIoVec*)realloc(op->segments, sizeof(aioIoVec) * (op->segmentsCount ? op->segmentsCount * 2 : 1));
+  op->segments[op->segmentsCount].iov_base = data;
+  op->segments[op->segmentsCount].iov_len = size;
+  op->segmentsCount++;
+}
+
 int asyncOpAlloc(asyncBase *base,
                  size_t size,
                  int isRealTime,
@@ -285,7 +691,9 @@ int asyncOpAlloc(asyncBase *base,
   int hasAllocatedNew = 0;
   asyncOpRoot *op = 0;
   ConcurrentQueue *buffer = !isRealTime ? objectPool : objectTimerPool;
-  if (!concurrentQueuePop(buffer, (void**)&op)) {
+  STATS_ADD(base, opsTaken, 1);
+  if (!objectPoolPop(buffer, (void**)&op)) {
+    STATS_ADD(base, opsAllocated, 1);
     op = (asyncOpRoot*)alignedMalloc(size, 1u << COMBINER_TAG_SIZE);
     if (isRealTime)
       base->methodImpl.initializeTimer(base, op);
@@ -303,7 +711,8 @@ int asyncOpAlloc(asyncBase *base,
 void releaseAsyncOp(asyncOpRoot *op)
 {
   aioObjectRoot *object = op->object;
-  concurrentQueuePush(op->objectPool, op);
+  STATS_ADD(object->base, opsReleased, 1);
+  objectPoolPush(op->objectPool, op);
   objectDecrementReference(object, 1);
 }
 
@@ -335,11 +744,18 @@ void initAsyncOpRoot(asyncOpRoot *op,
   op->arg = arg;
   op->timeout = timeout;
   op->running = (flags & afRunning) ? arRunning : arWaiting;
+  op->createdTime = 0;
+  op->startedTime = 0;
+  op->completedTime = 0;
+  if (object->base->tracing)
+    opTrace(op, atpCreated);
   objectIncrementReference(object, 1);
 }
 
 static void opRun(asyncOpRoot *op, List *list)
 {
+  if (op->createdTime)
+    opTrace(op, atpStarted);
   eqPushBack(list, op);
   if (op->timeout) {
     asyncBase *base = op->object->base;
@@ -347,8 +763,7 @@ static void opRun(asyncOpRoot *op, List *list)
       // start timer for this operation
       base->methodImpl.startTimer(op);
     } else {
-      // add operation to timeout grid
-      op->endTime = ((uint64_t)time(0)) * 1000000ULL + op->timeout;
+      // add operation to timing wheel
       addToTimeoutQueue(base, op);
     }
   }
@@ -406,6 +821,8 @@ void processAction(asyncOpRoot *opptr, AsyncOpActionTy actionType, uint32_t *nee
 
 void opRelease(asyncOpRoot *op, AsyncOpStatus status, List *executeList)
 {
+  if (status == aosTimeout)
+    STATS_ADD(op->object->base, timeoutsFired, 1);
   if (op->timerId && status != aosTimeout) {
     if (op->flags & afRealtime)
       op->object->base->methodImpl.stopTimer(op);
@@ -418,9 +835,110 @@ void opRelease(asyncOpRoot *op, AsyncOpStatus status, List *executeList)
   addToGlobalQueue(op);
 }
 
+#ifndef OS_WINDOWS
+static int coalesceWriteList(List *list)
+{
+  // Returns non-zero if gathered data was not sent completely (no space in send buffer)
+  asyncOpRoot *op = list->head;
+  aioObject *object = (aioObject*)op->object;
+  struct asyncImpl *impl = &object->root.base->methodImpl;
+  aioIoVec iov[WRITE_COALESCE_MAX];
+  size_t iovCount = 0;
+  size_t opsCount = 0;
+  size_t totalSize = 0;
+  ssize_t result;
+  while (op && iovCount < WRITE_COALESCE_MAX) {
+    asyncOp *writeOp = (asyncOp*)op;
+    if (op->opCode == actWrite && op->executeMethod == impl->write && !(op->flags & afZeroCopy)) {
+      iov[iovCount].iov_base = (uint8_t*)writeOp->buffer + writeOp->bytesTransferred;
+      iov[iovCount].iov_len = writeOp->transactionSize - writeOp->bytesTransferred;
+      totalSize += iov[iovCount].iov_len;
+      iovCount++;
+    } else if (op->opCode == actWritev && op->executeMethod == impl->writev) {
+      size_t i;
+      for (i = 0; i < writeOp->iovCount && iovCount < WRITE_COALESCE_MAX; i++) {
+        iov[iovCount] = writeOp->iov[i];
+        totalSize += iov[iovCount].iov_len;
+        iovCount++;
+      }
+    } else {
+      break;
+    }
+
+    opsCount++;
+    op = op->executeQueue.next;
+  }
+
+  if (opsCount < 2)
+    return 0;
+
+  if (object->root.type == ioObjectSocket) {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovCount;
+#ifdef OS_LINUX
+    result = sendmsg(object->hSocket, &msg, MSG_NOSIGNAL);
+#else
+    result = sendmsg(object->hSocket, &msg, 0);
+#endif
+  } else {
+    result = writev(object->hDevice, iov, (int)iovCount);
+  }
+
+  if (result < 0) {
+    // Other errors reported by operation own write procedure
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+  }
+
+  // Distribute transferred bytes over operations in queue order
+  size_t remaining = (size_t)result;
+  op = list->head;
+  while (op && opsCount--) {
+    asyncOp *writeOp = (asyncOp*)op;
+    asyncOpRoot *next = op->executeQueue.next;
+    size_t size = writeOp->transactionSize - writeOp->bytesTransferred;
+    if (size > remaining)
+      size = remaining;
+    writeOp->bytesTransferred += size;
+    if (op->opCode == actWritev)
+      ioVecAdvance(writeOp, size);
+    remaining -= size;
+
+    if (writeOp->bytesTransferred != writeOp->transactionSize && (size == 0 || (op->flags & afWaitAll)))
+      break;
+
+    if (opSetStatus(op, opGetGeneration(op), aosSuccess)) {
+      opRelease(op, aosSuccess, list);
+    } else {
+      eqRemove(list, op);
+      op->executeQueue.prev = op->executeQueue.next = 0;
+    }
+    op = next;
+  }
+
+  return (size_t)result != totalSize;
+}
+#endif
+
 void executeOperationList(List *list)
 {
   asyncOpRoot *op = list->head;
+#ifndef OS_WINDOWS
+  if (op && op->executeQueue.next && list == &op->object->writeQueue &&
+      (op->object->type == ioObjectSocket || op->object->type == ioObjectDevice) &&
+      ((aioObject*)op->object)->coalesceWrites &&
+      op->object->base->methodImpl.writev == writevProc) {
+    if (coalesceWriteList(list)) {
+      // Same as aosPending of single write: new operations queued behind it must not restart sending
+      if (list->head)
+        list->head->running = arRunning;
+      return;
+    }
+    op = list->head;
+  }
+#endif
+
   while (op) {
     asyncOpRoot *next = op->executeQueue.next;
     AsyncOpStatus status = op->executeMethod(op);
@@ -478,42 +996,163 @@ void resumeParent(asyncOpRoot *op, AsyncOpStatus status)
   }
 }
 
+void loopThreadAttach(asyncBase *base)
+{
+  unsigned i;
+  messageLoopThreadId = __uint_atomic_fetch_and_add(&base->messageLoopThreadCounter, 1);
+  threadQueueBase = 0;
+  for (i = 0; i < MAX_LOOP_THREADS; i++) {
+    if (base->threadQueueOwners[i] == 0 && __uint_atomic_compare_and_swap(&base->threadQueueOwners[i], 0, 1)) {
+      if (!base->threadQueues[i])
+        base->threadQueues[i] = calloc(1, sizeof(ConcurrentQueue));
+      threadQueueBase = base;
+      threadQueueIndex = i;
+      threadStats = &base->stats[i].slot;
+      break;
+    }
+  }
+}
+
+unsigned loopThreadDetach(asyncBase *base)
+{
+  if (threadQueueBase == base) {
+    // Pass remaining operations to other threads
+    asyncOpRoot *op;
+    threadQueueBase = 0;
+    while (concurrentQueuePop(base->threadQueues[threadQueueIndex], (void**)&op))
+      base->methodImpl.enqueue(base, op);
+    base->threadQueueOwners[threadQueueIndex] = 0;
+  }
+
+  // Thread can exit after leaving loop, return its cached objects to shared pools
+  flushMagazines();
+  bufferPoolFlushThreadCache();
+  return __uint_atomic_fetch_and_add(&base->messageLoopThreadCounter, 0u-1) - 1;
+}
+
+void asyncStatsAddShared(asyncBase *base, size_t offset, uint64_t value)
+{
+  __uint64_atomic_fetch_and_add((uint64_t*)((uint8_t*)&base->sharedStats.slot + offset), value);
+}
+
+void loopWaitStats(asyncBase *base, uint64_t waitBeginNs, int events)
+{
+  STATS_ADD(base, waitCalls, 1);
+  STATS_ADD(base, waitEvents, events > 0 ? (uint64_t)events : 0);
+  STATS_ADD(base, waitTimeNs, getMonotonicTimeNs() - waitBeginNs);
+}
+
 void addToGlobalQueue(asyncOpRoot *op)
 {
-  op->object->base->methodImpl.enqueue(op->object->base, op);
+  asyncBase *base = op->object->base;
+  STATS_ADD(base, queueEnqueued, 1);
+  // Loop thread drains own queue before waiting for events, no wakeup required
+  // unless backlog grows while it is busy, then one sleeping thread woken for stealing
+  if (threadQueueBase == base) {
+    concurrentQueuePush(base->threadQueues[threadQueueIndex], op);
+    if (++threadQueueBacklog == RUN_QUEUE_STEAL_THRESHOLD && base->methodImpl.wakeup)
+      base->methodImpl.wakeup(base);
+  } else {
+    base->methodImpl.enqueue(base, op);
+  }
 }
 
-int executeGlobalQueue(asyncBase *base)
+static void executeOperation(asyncOpRoot *op)
 {
-  asyncOpRoot *op;
-  while (concurrentQueuePop(&base->globalQueue, (void**)&op)) {
-    if (!op)
-      return 0;
+  switch (op->opCode) {
+    case actUserEvent : {
+      aioUserEvent *event = (aioUserEvent*)op;
+      STATS_ADD(event->base, queueExecuted, 1);
+      eventDeactivate(event);
+      op->finishMethod(op);
+      break;
+    }
 
-    switch (op->opCode) {
-      case actUserEvent : {
-        aioUserEvent *event = (aioUserEvent*)op;
-        eventDeactivate(event);
-        op->finishMethod(op);
-        break;
+    default : {
+      assert(opGetStatus(op) != aosPending && "finishing pending operation!");
+      STATS_ADD(op->object->base, queueExecuted, 1);
+      STATS_ADD(op->object->base, opsCompletedAsync, 1);
+      if (op->createdTime)
+        opTrace(op, atpDispatched);
+      currentFinishedSync = 0;
+      if (op->flags & afCoroutine) {
+        assert(coroutineIsMain() && "Execute global queue from non-main coroutine");
+        coroutineCall((coroutineTy*)op->finishMethod);
+      } else {
+        if (op->callback)
+          op->finishMethod(op);
+        releaseAsyncOp(op);
       }
+    }
+  }
+}
+
+static unsigned executeQueue(ConcurrentQueue *queue, unsigned limit)
+{
+  unsigned count = 0;
+  void *ops[RUN_QUEUE_BATCH_SIZE];
+  while (count < limit) {
+    size_t i, n = concurrentQueuePopBatch(queue, ops, limit - count);
+    if (!n)
+      break;
+    for (i = 0; i < n; i++)
+      executeOperation((asyncOpRoot*)ops[i]);
+    count += (unsigned)n;
+  }
+
+  return count;
+}
+
+static unsigned stealOperations(asyncBase *base)
+{
+  unsigned i;
+  unsigned start = threadQueueBase == base ? threadQueueIndex + 1 : 0;
+  for (i = 0; i < MAX_LOOP_THREADS; i++) {
+    ConcurrentQueue *queue = base->threadQueues[(start + i) % MAX_LOOP_THREADS];
+    if (queue) {
+      unsigned count = executeQueue(queue, RUN_QUEUE_BATCH_SIZE / 2);
+      if (count)
+        return count;
+    }
+  }
+
+  return 0;
+}
 
-      default : {
-        assert(opGetStatus(op) != aosPending && "finishing pending operation!");
-        currentFinishedSync = 0;
-        if (op->flags & afCoroutine) {
-          assert(coroutineIsMain() && "Execute global queue from non-main coroutine");
-          coroutineCall((coroutineTy*)op->finishMethod);
-        } else {
-          if (op->callback)
-            op->finishMethod(op);
-          releaseAsyncOp(op);
+int executeGlobalQueue(asyncBase *base)
+{
+  ConcurrentQueue *localQueue = threadQueueBase == base ? base->threadQueues[threadQueueIndex] : 0;
+  for (;;) {
+    unsigned count = 0;
+    if (localQueue) {
+      count = executeQueue(localQueue, RUN_QUEUE_BATCH_SIZE);
+      threadQueueBacklog = count < RUN_QUEUE_BATCH_SIZE || threadQueueBacklog < count ? 0 : threadQueueBacklog - count;
+    }
+
+    // Global queue checked after each local batch, it contains operations from other threads and quit marker
+    void *ops[GLOBAL_QUEUE_POP_BATCH_SIZE];
+    unsigned globalCount = 0;
+    while (globalCount < RUN_QUEUE_BATCH_SIZE) {
+      size_t i, j, n = concurrentQueuePopBatch(&base->globalQueue, ops, GLOBAL_QUEUE_POP_BATCH_SIZE);
+      if (!n)
+        break;
+      for (i = 0; i < n; i++) {
+        if (!ops[i]) {
+          // Operations popped after quit marker returned to queue
+          for (j = i + 1; j < n; j++)
+            concurrentQueuePush(&base->globalQueue, ops[j]);
+          return 0;
         }
+
+        executeOperation((asyncOpRoot*)ops[i]);
       }
+
+      globalCount += (unsigned)n;
     }
-  }
 
-  return 1;
+    if (count + globalCount == 0 && stealOperations(base) == 0)
+      return 1;
+  }
 }
 
 int copyFromBuffer(void *dst, size_t *offset, struct ioBuffer *src, size_t size)
@@ -534,6 +1173,212 @@ int copyFromBuffer(void *dst, size_t *offset, struct ioBuffer *src, size_t size)
   }
 }
 
+AsyncOpStatus readMsgBatchProc(asyncOpRoot *opptr)
+{
+  // transactionSize is number of messages, bytesTransferred is number of received messages
+  asyncOp *op = (asyncOp*)opptr;
+  ssize_t result = socketReadMsgBatch(((aioObject*)opptr->object)->hSocket, op->msgs, op->transactionSize);
+  if (result > 0) {
+    op->bytesTransferred = (size_t)result;
+    return aosSuccess;
+  }
+
+  if (errno == EAGAIN || errno == EWOULDBLOCK)
+    return aosPending;
+  return errno == ENOMEM ? aosBufferTooSmall : aosUnknownError;
+}
+
+AsyncOpStatus writeMsgBatchProc(asyncOpRoot *opptr)
+{
+  // Operation finished when all messages sent
+  asyncOp *op = (asyncOp*)opptr;
+  socketTy hSocket = ((aioObject*)opptr->object)->hSocket;
+  while (op->bytesTransferred < op->transactionSize) {
+    ssize_t result = socketWriteMsgBatch(hSocket, op->msgs + op->bytesTransferred, op->transactionSize - op->bytesTransferred);
+    if (result < 0)
+      return errno == EAGAIN || errno == EWOULDBLOCK ? aosPending : aosUnknownError;
+    op->bytesTransferred += (size_t)result;
+  }
+
+  return aosSuccess;
+}
+
+void ioVecAdvance(asyncOp *op, size_t bytes)
+{
+  while (op->iovCount && bytes >= op->iov->iov_len) {
+    bytes -= op->iov->iov_len;
+    op->iov++;
+    op->iovCount--;
+  }
+
+  if (bytes) {
+    op->iov->iov_base = (uint8_t*)op->iov->iov_base + bytes;
+    op->iov->iov_len -= bytes;
+  }
+}
+
+int ioVecCopyFromBuffer(asyncOp *op, struct ioBuffer *src)
+{
+  // Returns non-zero if operation finished by buffered data
+  size_t copied = 0;
+  while (op->iovCount && src->offset < src->dataSize) {
+    size_t size = src->dataSize - src->offset;
+    if (size > op->iov->iov_len)
+      size = op->iov->iov_len;
+    memcpy(op->iov->iov_base, (uint8_t*)src->ptr + src->offset, size);
+    src->offset += size;
+    copied += size;
+    op->bytesTransferred += size;
+    ioVecAdvance(op, size);
+  }
+
+  if (src->offset == src->dataSize) {
+    src->offset = 0;
+    src->dataSize = 0;
+  }
+
+  return op->bytesTransferred == op->transactionSize || (copied && !(op->root.flags & afWaitAll));
+}
+
+#ifndef OS_WINDOWS
+AsyncOpStatus readvProc(asyncOpRoot *opptr)
+{
+  asyncOp *op = (asyncOp*)opptr;
+  aioObject *object = (aioObject*)opptr->object;
+  if (ioVecCopyFromBuffer(op, &object->buffer))
+    return aosSuccess;
+
+  for (;;) {
+    ssize_t result = readv(object->hSocket, op->iov, (int)(op->iovCount < IO_VECTOR_MAX ? op->iovCount : IO_VECTOR_MAX));
+    if (result > 0) {
+      op->bytesTransferred += (size_t)result;
+      ioVecAdvance(op, (size_t)result);
+      if (op->bytesTransferred == op->transactionSize || !(opptr->flags & afWaitAll))
+        return aosSuccess;
+    } else if (result == 0) {
+      return op->bytesTransferred < op->transactionSize ? aosDisconnected : aosSuccess;
+    } else {
+      return errno == EAGAIN || errno == EWOULDBLOCK ? aosPending : aosUnknownError;
+    }
+  }
+}
+
+AsyncOpStatus writevProc(asyncOpRoot *opptr)
+{
+  asyncOp *op = (asyncOp*)opptr;
+  aioObject *object = (aioObject*)opptr->object;
+  for (;;) {
+    size_t count = op->iovCount < IO_VECTOR_MAX ? op->iovCount : IO_VECTOR_MAX;
+    ssize_t result;
+    if (object->root.type == ioObjectSocket) {
+      struct msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = op->iov;
+      msg.msg_iovlen = count;
+#ifdef OS_LINUX
+      result = sendmsg(object->hSocket, &msg, MSG_NOSIGNAL);
+#else
+      result = sendmsg(object->hSocket, &msg, 0);
+#endif
+    } else {
+      result = writev(object->hDevice, op->iov, (int)count);
+    }
+
+    if (result > 0) {
+      op->bytesTransferred += (size_t)result;
+      ioVecAdvance(op, (size_t)result);
+      if (op->bytesTransferred == op->transactionSize || !(opptr->flags & afWaitAll))
+        return aosSuccess;
+    } else if (result == 0) {
+      return op->bytesTransferred < op->transactionSize ? aosDisconnected : aosSuccess;
+    } else {
+      return errno == EAGAIN || errno == EWOULDBLOCK ? aosPending : aosUnknownError;
+    }
+  }
+}
+
+AsyncOpStatus sendFileProc(asyncOpRoot *opptr)
+{
+  asyncOp *op = (asyncOp*)opptr;
+  aioObject *object = (aioObject*)opptr->object;
+  for (;;) {
+    ssize_t result = socketSendFile(object->hSocket,
+                                    op->file,
+                                    op->fileOffset + op->bytesTransferred,
+                                    op->transactionSize - op->bytesTransferred);
+    if (result > 0) {
+      op->bytesTransferred += (size_t)result;
+      if (op->bytesTransferred == op->transactionSize || !(opptr->flags & afWaitAll))
+        return aosSuccess;
+    } else if (result == 0) {
+      // End of file or connection closed
+      return op->bytesTransferred < op->transactionSize ? aosDisconnected : aosSuccess;
+    } else {
+      return errno == EAGAIN || errno == EWOULDBLOCK ? aosPending : aosUnknownError;
+    }
+  }
+}
+
+AsyncOpStatus spliceProc(asyncOpRoot *opptr)
+{
+  asyncOp *op = (asyncOp*)opptr;
+  aioObject *object = (aioObject*)opptr->object;
+  int toSocket = opptr->opCode == actSpliceTo;
+  if (!toSocket && object->buffer.offset < object->buffer.dataSize) {
+    // Data already received to object buffer moved to pipe first
+    size_t size = object->buffer.dataSize - object->buffer.offset;
+    ssize_t result = write(op->file, (uint8_t*)object->buffer.ptr + object->buffer.offset, size < op->transactionSize ? size : op->transactionSize);
+    if (result > 0) {
+      op->bytesTransferred = (size_t)result;
+      object->buffer.offset += (size_t)result;
+      if (object->buffer.offset == object->buffer.dataSize)
+        object->buffer.offset = object->buffer.dataSize = 0;
+      return aosSuccess;
+    }
+
+    return errno == EAGAIN || errno == EWOULDBLOCK ? aosPending : aosUnknownError;
+  }
+
+  for (;;) {
+    ssize_t result = socketSplice(object->hSocket, op->file, op->transactionSize - op->bytesTransferred, toSocket);
+    if (result > 0) {
+      op->bytesTransferred += (size_t)result;
+      if (op->bytesTransferred == op->transactionSize || !(opptr->flags & afWaitAll))
+        return aosSuccess;
+    } else if (result == 0) {
+      return op->bytesTransferred < op->transactionSize ? aosDisconnected : aosSuccess;
+    } else {
+      return errno == EAGAIN || errno == EWOULDBLOCK ? aosPending : aosUnknownError;
+    }
+  }
+}
+
+AsyncOpStatus readProvidedProc(asyncOpRoot *opptr)
+{
+  // Buffer taken from pool only for the time of read, pending operation holds no memory
+  asyncOp *op = (asyncOp*)opptr;
+  aioObject *object = (aioObject*)opptr->object;
+  asyncBase *base = opptr->object->base;
+  size_t size;
+  void *buffer = providedBufferAlloc(base, &size);
+  if (copyFromBuffer(buffer, &op->bytesTransferred, &object->buffer, size) || op->bytesTransferred) {
+    op->buffer = buffer;
+    return aosSuccess;
+  }
+
+  ssize_t result = read(object->hSocket, buffer, size);
+  if (result > 0) {
+    op->buffer = buffer;
+    op->bytesTransferred = (size_t)result;
+    return aosSuccess;
+  }
+
+  providedBufferFree(base, buffer);
+  if (result == 0)
+    return aosDisconnected;
+  return errno == EAGAIN || errno == EWOULDBLOCK ? aosPending : aosUnknownError;
+}
+#endif
 
 static inline int combinerTaskHandlerCommon(aioObjectRoot *object, uint32_t tag)
 {
@@ -572,13 +1417,14 @@ void combiner(aioObjectRoot *object, AsyncOpTaggedPtr stackTop, AsyncOpTaggedPtr
 
   for (;;) {
     AsyncOpTaggedPtr currentHead;
-    while ( (currentHead.data = object->Head.data) == stackTop.data ) {
-      if (__uintptr_atomic_compare_and_swap(&object->Head.data, stackTop.data, 0))
+    // Exit publishes object state to next combiner owner, taking the list acquires pushed operations
+    while ( (currentHead.data = __uintptr_atomic_load(&object->Head.data, __ATOMIC_RELAXED)) == stackTop.data ) {
+      if (__uintptr_atomic_compare_and_swap_explicit(&object->Head.data, stackTop.data, 0, __ATOMIC_RELEASE))
         return;
     }
 
-    while (!__uintptr_atomic_compare_and_swap(&object->Head.data, currentHead.data, stackTop.data))
-      currentHead = object->Head;
+    while (!__uintptr_atomic_compare_and_swap_explicit(&object->Head.data, currentHead.data, stackTop.data, __ATOMIC_ACQUIRE))
+      currentHead.data = __uintptr_atomic_load(&object->Head.data, __ATOMIC_RELAXED);
 
     // Run dequeued tasks
     while (currentHead.data && currentHead.data != stackTop.data) {
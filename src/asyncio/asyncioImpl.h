@@ -14,15 +14,66 @@ typedef enum IoActionTy {
   actAccept = OPCODE_READ,
   actRead,
   actReadMsg,
+  actReadMsgBatch,
+  actReadv,
+  actReadMapped,
+  actSpliceFrom,
+  actReadProvided,
   actConnect = OPCODE_WRITE,
   actWrite,
   actWriteMsg,
+  actWriteMsgBatch,
+  actWritev,
+  actSendFile,
+  actSpliceTo,
   actUserEvent = OPCODE_OTHER,
 } IoActionTy;
 
+// Hierarchical timing wheel for non-realtime operation timeouts, 1ms resolution
+// Root level covers 256ms, each next level multiplies range by 64 (up to ~49 days)
+#define TIMER_WHEEL_ROOT_BITS 8
+#define TIMER_WHEEL_ROOT_SIZE (1u << TIMER_WHEEL_ROOT_BITS)
+#define TIMER_WHEEL_LEVEL_BITS 6
+#define TIMER_WHEEL_LEVEL_SIZE (1u << TIMER_WHEEL_LEVEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
+// Maximum number of vector elements passed to one readv/writev call
+#define IO_VECTOR_MAX 1024
+
+// Latency histograms: log-linear buckets with 2^LATENCY_HISTOGRAM_SUB_BITS values per power of two (error < 1/16),
+// one histogram pair per object kind and operation code (low 4 bits of code for each of read/write/other classes)
+#define LATENCY_HISTOGRAM_SUB_BITS 5
+#define LATENCY_HISTOGRAM_HALF (1u << (LATENCY_HISTOGRAM_SUB_BITS-1))
+#define LATENCY_HISTOGRAM_BUCKETS ((64 - LATENCY_HISTOGRAM_SUB_BITS + 2) * LATENCY_HISTOGRAM_HALF)
+#define TRACE_OPCODE_SLOTS 48
+
+// Default size of buffers in per-base pool used by provided buffer reads (aioReadProvided)
+#define PROVIDED_BUFFER_DEFAULT_SIZE 16384
+// Maximum number of vector elements gathered from queued write operations
+#define WRITE_COALESCE_MAX 64
+
+// Maximum number of loop threads with own run queue
+#define MAX_LOOP_THREADS 64
+// Operations taken from one queue before checking next one
+#define RUN_QUEUE_BATCH_SIZE 64
+// Operations taken from shared global queue by one atomic operation, rest left for other threads
+#define GLOBAL_QUEUE_POP_BATCH_SIZE 16
+// Number of operations queued to loop thread own run queue without draining it before sleeping thread woken for stealing
+#define RUN_QUEUE_STEAL_THRESHOLD 32
+
+typedef struct timerWheel {
+  asyncOpListLink *root[TIMER_WHEEL_ROOT_SIZE];
+  asyncOpListLink *levels[TIMER_WHEEL_LEVELS][TIMER_WHEEL_LEVEL_SIZE];
+  uint64_t rootMask[TIMER_WHEEL_ROOT_SIZE/64];
+  // Next millisecond to process
+  uint64_t current;
+  size_t count;
+} timerWheel;
+
 typedef void combinerTaskHandlerTy(aioObjectRoot*, asyncOpRoot*, AsyncOpActionTy);
 typedef void enqueueOperationTy(asyncBase*, asyncOpRoot*);
 typedef void postEmptyOperationTy(asyncBase*);
+typedef void wakeupTy(asyncBase*);
 typedef void nextFinishedOperationTy(asyncBase*);
 typedef aioObject *newAioObjectTy(asyncBase*, IoObjectTy, void*);
 typedef void deleteObjectTy(aioObject*);
@@ -51,16 +102,65 @@ struct asyncImpl {
   aioExecuteProc *write;
   aioExecuteProc *readMsg;
   aioExecuteProc *writeMsg;
+  // Optional, backend without batch support executes single datagram operations
+  aioExecuteProc *readMsgBatch;
+  aioExecuteProc *writeMsgBatch;
+  // Optional, without vectored I/O support data gathered to (scattered from) internal buffer
+  aioExecuteProc *readv;
+  aioExecuteProc *writev;
+  // Optional, without receive zero-copy support data copied to buffer allocated by operation
+  aioExecuteProc *readMapped;
+  // Optional, without sendfile support file data read to internal buffer and written
+  aioExecuteProc *sendFile;
+  // Optional, without splice support socket data can't be moved to (from) pipe
+  aioExecuteProc *splice;
+  // Optional, without readiness notification pool buffer taken when operation started and held until it finished
+  aioExecuteProc *readProvided;
+  // Optional, wakes one thread blocked in wait for events so it can steal from run queue of busy thread
+  wakeupTy *wakeup;
 };
 
+typedef struct latencyHistogram {
+  uint64_t queueDelay[LATENCY_HISTOGRAM_BUCKETS];
+  uint64_t ioTime[LATENCY_HISTOGRAM_BUCKETS];
+} latencyHistogram;
+
+// Cache line alignment, structure containing aligned field must be allocated with alignedMalloc
+#define CACHE_LINE_SIZE 64
+#ifdef _MSC_VER
+#define __cacheline_aligned __declspec(align(CACHE_LINE_SIZE))
+#else
+#define __cacheline_aligned __attribute__((aligned(CACHE_LINE_SIZE)))
+#endif
+
+// Stats slot aligned and padded to cache line, slots of different threads never share line
+typedef struct __cacheline_aligned asyncStatsLine {
+  asyncStatsSlot slot;
+} asyncStatsLine;
+
 struct asyncBase {
   enum AsyncMethod method;
   struct asyncImpl methodImpl;
   struct ConcurrentQueue globalQueue;
-  struct pageMap timerMap;
-  time_t lastCheckPoint;
+  // Per loop thread run queues, allocated on first use and never freed (can be accessed by stealing threads)
+  struct ConcurrentQueue *volatile threadQueues[MAX_LOOP_THREADS];
+  volatile unsigned threadQueueOwners[MAX_LOOP_THREADS];
+  timerWheel timerWheel;
   volatile unsigned messageLoopThreadCounter;
-  volatile unsigned timerMapLock;
+  volatile unsigned timerWheelLock;
+  // Runtime counters: slot per loop thread queue index and shared slot for other threads
+  asyncStatsLine stats[MAX_LOOP_THREADS];
+  asyncStatsLine sharedStats;
+  // Operation tracing, checked once per operation in initAsyncOpRoot
+  volatile unsigned tracing;
+  aioTraceCb *traceHook;
+  void *traceHookArg;
+  unsigned latencyHistogramsEnabled;
+  // Allocated on first sample of object kind and operation code
+  latencyHistogram *volatile latencyHistograms[atkMax][TRACE_OPCODE_SLOTS];
+  // Receive buffers shared by all objects of base for provided buffer reads
+  struct ConcurrentQueue providedBuffers;
+  size_t providedBufferSize;
 
 #ifndef NDEBUG
   int opsCount;
@@ -82,6 +182,8 @@ struct aioObject {
   };
 
   struct ioBuffer buffer;
+  // Gather queued write operations into one writev (aioSetWriteCoalescing)
+  int coalesceWrites;
 };
 
 struct asyncOp {
@@ -92,6 +194,27 @@ struct asyncOp {
   size_t bytesTransferred;
   socketTy acceptSocket;
   HostAddress host;
+  aioMsg *msgs;
+  // Message batch sent by single datagram operations (backend without batch support):
+  // batch size and number of messages sent by previous operations
+  size_t msgsCount;
+  size_t msgsDone;
+  // Vectored operations: private copy of not transferred part of user vector
+  aioIoVec *iov;
+  size_t iovCount;
+  // Zero-copy send: value of object notification counter releasing user buffer
+  uint32_t zeroCopyId;
+  // Mapped read: reserved socket mapping and size of data mapped into it,
+  // data not suitable for mapping received to buffer (bytesTransferred),
+  // order of mapped and copied parts in stream (mappedSegmentAppend)
+  void *mapping;
+  size_t mappingSize;
+  size_t mappedSize;
+  aioIoVec *segments;
+  size_t segmentsCount;
+  // Send file: source file and offset of first byte
+  iodevTy file;
+  uint64_t fileOffset;
 
   void *internalBuffer;
   size_t internalBufferSize;
@@ -107,11 +230,40 @@ struct aioUserEvent {
   void *destructorCbArg;
 };
 
-void pageMapInit(pageMap *map);
+void loopThreadAttach(asyncBase *base);
+unsigned loopThreadDetach(asyncBase *base);
+
+uint64_t getMonotonicTimeMs(void);
+uint64_t getMonotonicTimeNs(void);
+uint64_t latencyBucketValue(unsigned index);
+unsigned traceOpCodeSlot(int opCode);
+// Accounts one wait for events of loop thread (asyncStats wait* counters)
+void loopWaitStats(asyncBase *base, uint64_t waitBeginNs, int events);
+void timeoutQueueInit(asyncBase *base);
 void addToTimeoutQueue(asyncBase *base, asyncOpRoot *op);
-void processTimeoutQueue(asyncBase *base, time_t currentTime);
+void processTimeoutQueue(asyncBase *base, uint64_t currentTime);
+unsigned timeoutQueueWaitTime(asyncBase *base, uint64_t currentTime, unsigned maxWaitTime);
 
 int copyFromBuffer(void *dst, size_t *offset, struct ioBuffer *src, size_t size);
+
+// Batched datagram operations for readiness based backends
+AsyncOpStatus readMsgBatchProc(asyncOpRoot *opptr);
+AsyncOpStatus writeMsgBatchProc(asyncOpRoot *opptr);
+
+void ioVecAdvance(asyncOp *op, size_t bytes);
+int ioVecCopyFromBuffer(asyncOp *op, struct ioBuffer *src);
+// Vectored I/O for readiness based backends
+AsyncOpStatus readvProc(asyncOpRoot *opptr);
+AsyncOpStatus writevProc(asyncOpRoot *opptr);
+AsyncOpStatus sendFileProc(asyncOpRoot *opptr);
+AsyncOpStatus spliceProc(asyncOpRoot *opptr);
+AsyncOpStatus readProvidedProc(asyncOpRoot *opptr);
+
+// Returns buffer of current provided buffer size, size stored to 'size'
+void *providedBufferAlloc(asyncBase *base, size_t *size);
+void providedBufferFree(asyncBase *base, void *buffer);
+// Appends received data to mapped read result, merges it with previous segment if adjacent
+void mappedSegmentAppend(asyncOp *op, void *data, size_t size);
 #ifdef __cplusplus
 }
 
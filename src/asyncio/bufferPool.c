@@ -0,0 +1,116 @@
+#include "asyncio/bufferPool.h"
+#include "asyncio/asyncioTypes.h"
+#include "asyncio/ringBuffer.h"
+#include "atomic.h"
+#include <assert.h>
+#include <stdlib.h>
+
+#define BUFFER_POOL_CLASSES (BUFFER_POOL_MAX_SIZE_LOG2 - BUFFER_POOL_MIN_SIZE_LOG2 + 1)
+// Thread cache holds up to 8 buffers of class but not more than 256Kb
+#define BUFFER_POOL_THREAD_CACHE_SIZE 8
+#define BUFFER_POOL_THREAD_CACHE_BYTES ((size_t)256 << 10)
+
+typedef struct bufferThreadCache {
+  void *buffers[BUFFER_POOL_CLASSES][BUFFER_POOL_THREAD_CACHE_SIZE];
+  unsigned count[BUFFER_POOL_CLASSES];
+} bufferThreadCache;
+
+static ConcurrentQueue sharedPool[BUFFER_POOL_CLASSES];
+static volatile unsigned sharedPoolSize[BUFFER_POOL_CLASSES];
+static __tls bufferThreadCache threadCache;
+
+static inline unsigned sizeClass(size_t size)
+{
+  unsigned index = 0;
+  size_t classSize = BUFFER_POOL_MIN_SIZE;
+  while (classSize < size) {
+    classSize <<= 1;
+    index++;
+  }
+
+  return index;
+}
+
+static inline unsigned threadCacheLimit(unsigned index)
+{
+  size_t limit = BUFFER_POOL_THREAD_CACHE_BYTES >> (index + BUFFER_POOL_MIN_SIZE_LOG2);
+  return limit == 0 ? 1 : limit < BUFFER_POOL_THREAD_CACHE_SIZE ? (unsigned)limit : BUFFER_POOL_THREAD_CACHE_SIZE;
+}
+
+static inline unsigned sharedPoolLimit(unsigned index)
+{
+  return (unsigned)(BUFFER_POOL_SHARED_LIMIT >> (index + BUFFER_POOL_MIN_SIZE_LOG2));
+}
+
+static void sharedPoolFree(unsigned index, void *buffer)
+{
+  if (__uint_atomic_fetch_and_add(&sharedPoolSize[index], 1) < sharedPoolLimit(index)) {
+    concurrentQueuePush(&sharedPool[index], buffer);
+  } else {
+    __uint_atomic_fetch_and_add(&sharedPoolSize[index], (unsigned)-1);
+    free(buffer);
+  }
+}
+
+void *bufferPoolAlloc(size_t size, size_t *capacity)
+{
+  void *buffer;
+  if (size > BUFFER_POOL_MAX_SIZE) {
+    *capacity = size;
+    return malloc(size);
+  }
+
+  unsigned index = sizeClass(size);
+  *capacity = BUFFER_POOL_MIN_SIZE << index;
+  if (threadCache.count[index])
+    return threadCache.buffers[index][--threadCache.count[index]];
+
+  if (concurrentQueuePop(&sharedPool[index], &buffer)) {
+    __uint_atomic_fetch_and_add(&sharedPoolSize[index], (unsigned)-1);
+    return buffer;
+  }
+
+  return malloc(*capacity);
+}
+
+void bufferPoolFree(void *buffer, size_t capacity)
+{
+  if (!buffer)
+    return;
+  if (capacity > BUFFER_POOL_MAX_SIZE) {
+    free(buffer);
+    return;
+  }
+
+  // Capacity must be returned by bufferPoolAlloc, block of other size can't be reused as class buffer
+  unsigned index = sizeClass(capacity);
+  assert(capacity == (BUFFER_POOL_MIN_SIZE << index) && "Buffer not allocated by bufferPoolAlloc");
+  if (capacity != (BUFFER_POOL_MIN_SIZE << index)) {
+    free(buffer);
+    return;
+  }
+
+  if (threadCache.count[index] < threadCacheLimit(index))
+    threadCache.buffers[index][threadCache.count[index]++] = buffer;
+  else
+    sharedPoolFree(index, buffer);
+}
+
+void bufferPoolFlushThreadCache()
+{
+  unsigned i;
+  for (i = 0; i < BUFFER_POOL_CLASSES; i++) {
+    while (threadCache.count[i])
+      sharedPoolFree(i, threadCache.buffers[i][--threadCache.count[i]]);
+  }
+}
+
+void *bufferPoolReserve(void **buffer, size_t *capacity, size_t size)
+{
+  if (*buffer == 0 || *capacity < size) {
+    bufferPoolFree(*buffer, *capacity);
+    *buffer = bufferPoolAlloc(size, capacity);
+  }
+
+  return *buffer;
+}
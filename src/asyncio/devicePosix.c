@@ -1,12 +1,17 @@
 #include "asyncio/device.h"
 #include <fcntl.h>
+#include <limits.h>
 #include <string.h>
 #include <termios.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
 
 iodevTy serialPortOpen(const char *name)
 {
@@ -205,3 +210,37 @@ int deviceSyncWrite(iodevTy hDevice, const void *buffer, size_t size, int waitAl
     return transferred == size;
   }
 }
+
+int deviceSyncReadAt(iodevTy hDevice, void *buffer, size_t size, uint64_t offset, size_t *bytesTransferred)
+{
+  size_t transferred = 0;
+  ssize_t result;
+  while (transferred != size && (result = pread(hDevice, (uint8_t*)buffer + transferred, size - transferred, (off_t)(offset + transferred))) > 0)
+    transferred += (size_t)result;
+  *bytesTransferred = transferred;
+  return transferred == size;
+}
+
+int deviceSyncWritev(iodevTy hDevice, const aioIoVec *iov, size_t iovCount, int waitAll, size_t *bytesTransferred)
+{
+  size_t transferred = 0;
+  size_t index = 0;
+  size_t offset = 0;
+  while (index < iovCount) {
+    ssize_t result = offset ?
+      write(hDevice, (uint8_t*)iov[index].iov_base + offset, iov[index].iov_len - offset) :
+      writev(hDevice, iov + index, (int)(iovCount - index < IOV_MAX ? iovCount - index : IOV_MAX));
+    if (result <= 0)
+      break;
+
+    transferred += (size_t)result;
+    offset += (size_t)result;
+    while (index < iovCount && offset >= iov[index].iov_len)
+      offset -= iov[index++].iov_len;
+    if (!waitAll)
+      break;
+  }
+
+  *bytesTransferred = transferred;
+  return waitAll ? index == iovCount : transferred != 0;
+}
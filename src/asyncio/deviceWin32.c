@@ -1,4 +1,5 @@
 #include "asyncio/device.h"
+#include "macro.h"
 #include <stdlib.h>
 
 iodevTy serialPortOpen(const char *name)
@@ -158,3 +159,23 @@ int deviceSyncWrite(iodevTy hDevice, const void *buffer, size_t size, int waitAl
   *bytesTransferred = 0;
   return 0;
 }
+
+int deviceSyncWritev(iodevTy hDevice, const aioIoVec *iov, size_t iovCount, int waitAll, size_t *bytesTransferred)
+{
+  __UNUSED(hDevice);
+  __UNUSED(iov);
+  __UNUSED(iovCount);
+  __UNUSED(waitAll);
+  *bytesTransferred = 0;
+  return 0;
+}
+
+int deviceSyncReadAt(iodevTy hDevice, void *buffer, size_t size, uint64_t offset, size_t *bytesTransferred)
+{
+  __UNUSED(hDevice);
+  __UNUSED(buffer);
+  __UNUSED(size);
+  __UNUSED(offset);
+  *bytesTransferred = 0;
+  return 0;
+}
@@ -15,35 +15,104 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/epoll.h>
+#include <sys/mman.h>
 #include <sys/timerfd.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef TCP_ZEROCOPY_RECEIVE
+#define TCP_ZEROCOPY_RECEIVE 35
+#endif
+
+// Leading part of struct tcp_zerocopy_receive (linux/tcp.h), accepted by all kernels with TCP_ZEROCOPY_RECEIVE
+typedef struct zeroCopyReceive {
+  uint64_t address;
+  uint32_t length;
+  uint32_t recvSkipHint;
+} zeroCopyReceive;
+
+// Maximum length mapped by one TCP_ZEROCOPY_RECEIVE call
+#define ZEROCOPY_RECEIVE_MAX (1u << 30)
 
 static ConcurrentQueue objectPool;
 
 #define MAX_EVENTS 256
+#define MAX_CHANGES 256
 
 __NO_PADDING_BEGIN
+typedef struct aioTimer aioTimer;
+
 typedef struct epollBase {
   asyncBase B;
   int epollFd;
+  // Objects registered once with EPOLLET, readiness cached in EPollObject::IoEvents
+  int edgeTriggered;
   int eventFd;
   aioObject *eventObject;
+  // Number of threads blocked in epoll_wait, eventfd written only if it's not zero
+  volatile unsigned sleepingThreads;
+  // Set by first enqueue after wakeup, coalesces eventfd writes until eventfd read
+  volatile unsigned wakeupPending;
+  // All realtime timers multiplexed onto one timerfd driven by min-heap
+  int timerFd;
+  aioObject *timerObject;
+  aioTimer **timerHeap;
+  size_t timerHeapSize;
+  size_t timerHeapCapacity;
+  uint64_t timerArmedTime;
+  unsigned timerLock;
 } epollBase;
 
 typedef struct EPollObject {
   aioObject Object;
-  uint32_t IoEvents;
+  volatile uint32_t IoEvents;
+  // Level-triggered mode: interest mask wanted by combiner and mask armed in kernel
+  // Non-zero mask stays armed across events, zero mask armed with EPOLLONESHOT (EPOLLHUP/EPOLLERR reported once)
+  uint32_t DesiredEvents;
+  uint32_t RegisteredEvents;
+  volatile unsigned ChangeQueued;
+  volatile unsigned ChangeLock;
+  // MSG_ZEROCOPY: SO_ZEROCOPY state (0 - not set, 1 - enabled, -1 - unsupported),
+  // number of zero-copy send calls and number of buffers released by kernel
+  int ZeroCopyState;
+  uint32_t ZeroCopySent;
+  uint32_t ZeroCopyCompleted;
 } EPollObject;
 
-typedef struct aioTimer {
-  aioObjectRoot root;
-  int fd;
+// Per loop thread list of objects with pending epoll_ctl, flushed before epoll_wait
+typedef struct epollChangeList {
+  epollBase *base;
+  size_t size;
+  EPollObject *objects[MAX_CHANGES];
+} epollChangeList;
+
+struct aioTimer {
+  asyncBase *base;
   asyncOpRoot *op;
-} aioTimer;
+  aioTimer *next;
+  uint64_t endTime;
+  size_t heapIndex;
+  uintptr_t tag;
+  uintptr_t seq;
+};
+
+#define TIMER_NOT_QUEUED ((size_t)-1)
 __NO_PADDING_END
 
 void combinerTaskHandler(aioObjectRoot *object, asyncOpRoot *op, AsyncOpActionTy opMethod);
+void epollEdgeCombinerTaskHandler(aioObjectRoot *object, asyncOpRoot *op, AsyncOpActionTy opMethod);
 void epollEnqueue(asyncBase *base, asyncOpRoot *op);
 void epollPostEmptyOperation(asyncBase *base);
+void epollWakeup(asyncBase *base);
 void epollNextFinishedOperation(asyncBase *base);
 aioObject *epollNewAioObject(asyncBase *base, IoObjectTy type, void *data);
 asyncOpRoot *epollNewAsyncOp(asyncBase *base, int isRealTime, ConcurrentQueue *objectPool, ConcurrentQueue *objectTimerPool);
@@ -60,6 +129,7 @@ AsyncOpStatus epollAsyncRead(asyncOpRoot *opptr);
 AsyncOpStatus epollAsyncWrite(asyncOpRoot *opptr);
 AsyncOpStatus epollAsyncReadMsg(asyncOpRoot *op);
 AsyncOpStatus epollAsyncWriteMsg(asyncOpRoot *op);
+AsyncOpStatus epollAsyncReadMapped(asyncOpRoot *opptr);
 
 static struct asyncImpl epollImpl = {
   combinerTaskHandler,
@@ -80,7 +150,16 @@ static struct asyncImpl epollImpl = {
   epollAsyncRead,
   epollAsyncWrite,
   epollAsyncReadMsg,
-  epollAsyncWriteMsg
+  epollAsyncWriteMsg,
+  readMsgBatchProc,
+  writeMsgBatchProc,
+  readvProc,
+  writevProc,
+  epollAsyncReadMapped,
+  sendFileProc,
+  spliceProc,
+  readProvidedProc,
+  epollWakeup
 };
 
 static void epollControl(int epollFd, int action, uint32_t events, int fd, void *ptr)
@@ -107,30 +186,257 @@ static int getFd(EPollObject *object)
   }
 }
 
-asyncBase *epollNewAsyncBase()
+static inline uint32_t writeInterest(asyncOpRoot *op)
+{
+  // Zero-copy send waits for buffer release notification on socket error queue
+  return (op->flags & afZeroCopy) && op->opCode == actWrite && ((asyncOp*)op)->state == 1 ? EPOLLERR : EPOLLOUT;
+}
+
+static __tls epollChangeList changeList;
+
+static void epollApplyChange(EPollObject *object)
+{
+  // Object can be already deleted or reused by other base, all state read under lock
+  __spinlock_acquire(&object->ChangeLock);
+  object->ChangeQueued = 0;
+  int fd = getFd(object);
+  uint32_t events = object->DesiredEvents;
+  if (fd != -1 && events != object->RegisteredEvents) {
+    epollControl(((epollBase*)object->Object.root.base)->epollFd,
+                 EPOLL_CTL_MOD,
+                 events ? events | ((events & EPOLLIN) ? EPOLLRDHUP : 0) : EPOLLONESHOT,
+                 fd,
+                 object);
+    object->RegisteredEvents = events;
+  }
+  __spinlock_release(&object->ChangeLock);
+}
+
+static void epollFlushChanges()
+{
+  size_t i;
+  for (i = 0; i < changeList.size; i++)
+    epollApplyChange(changeList.objects[i]);
+  changeList.size = 0;
+}
+
+static void epollQueueChange(epollBase *base, EPollObject *object)
+{
+  if (changeList.base != base) {
+    // Not a loop thread of this base, nobody will flush list
+    epollApplyChange(object);
+    return;
+  }
+
+  if (__uint_atomic_compare_and_swap(&object->ChangeQueued, 0, 1)) {
+    if (changeList.size == MAX_CHANGES)
+      epollFlushChanges();
+    changeList.objects[changeList.size++] = object;
+  }
+}
+
+static uint64_t getMonotonicTimeUs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec*1000000 + (uint64_t)ts.tv_nsec/1000;
+}
+
+static inline void timerHeapSet(epollBase *base, size_t index, aioTimer *timer)
+{
+  base->timerHeap[index] = timer;
+  timer->heapIndex = index;
+}
+
+static void timerHeapSiftUp(epollBase *base, size_t index)
+{
+  aioTimer *timer = base->timerHeap[index];
+  while (index > 0) {
+    size_t parent = (index - 1) / 2;
+    if (base->timerHeap[parent]->endTime <= timer->endTime)
+      break;
+    timerHeapSet(base, index, base->timerHeap[parent]);
+    index = parent;
+  }
+
+  timerHeapSet(base, index, timer);
+}
+
+static void timerHeapSiftDown(epollBase *base, size_t index)
+{
+  aioTimer *timer = base->timerHeap[index];
+  for (;;) {
+    size_t child = index*2 + 1;
+    if (child >= base->timerHeapSize)
+      break;
+    if (child + 1 < base->timerHeapSize && base->timerHeap[child+1]->endTime < base->timerHeap[child]->endTime)
+      child++;
+    if (timer->endTime <= base->timerHeap[child]->endTime)
+      break;
+    timerHeapSet(base, index, base->timerHeap[child]);
+    index = child;
+  }
+
+  timerHeapSet(base, index, timer);
+}
+
+static void timerHeapInsert(epollBase *base, aioTimer *timer)
+{
+  if (base->timerHeapSize == base->timerHeapCapacity) {
+    base->timerHeapCapacity = base->timerHeapCapacity ? base->timerHeapCapacity*2 : 256;
+    base->timerHeap = realloc(base->timerHeap, base->timerHeapCapacity*sizeof(aioTimer*));
+  }
+
+  timerHeapSet(base, base->timerHeapSize++, timer);
+  timerHeapSiftUp(base, timer->heapIndex);
+}
+
+static void timerHeapRemove(epollBase *base, aioTimer *timer)
+{
+  size_t index = timer->heapIndex;
+  aioTimer *last = base->timerHeap[--base->timerHeapSize];
+  timer->heapIndex = TIMER_NOT_QUEUED;
+  if (last != timer) {
+    timerHeapSet(base, index, last);
+    timerHeapSiftUp(base, index);
+    timerHeapSiftDown(base, last->heapIndex);
+  }
+}
+
+// Must be called with timerLock held; timerfd reprogrammed only if nearest deadline moves earlier
+static void timerFdUpdate(epollBase *base)
+{
+  if (base->timerHeapSize == 0)
+    return;
+
+  uint64_t endTime = base->timerHeap[0]->endTime;
+  if (base->timerArmedTime == 0 || endTime < base->timerArmedTime) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = endTime / 1000000;
+    its.it_value.tv_nsec = (endTime % 1000000) * 1000;
+    timerfd_settime(base->timerFd, TFD_TIMER_ABSTIME, &its, 0);
+    base->timerArmedTime = endTime;
+  }
+}
+
+static void timerArm(aioTimer *timer, uint64_t endTime, uintptr_t tag)
+{
+  epollBase *base = (epollBase*)timer->base;
+  __spinlock_acquire(&base->timerLock);
+  if (timer->heapIndex != TIMER_NOT_QUEUED)
+    timerHeapRemove(base, timer);
+  timer->endTime = endTime;
+  timer->tag = tag;
+  timer->seq++;
+  timerHeapInsert(base, timer);
+  timerFdUpdate(base);
+  __spinlock_release(&base->timerLock);
+}
+
+static void processTimers(epollBase *base)
+{
+  uint64_t data;
+  aioTimer *expired = 0;
+  while (read(base->timerFd, &data, sizeof(data)) > 0)
+    continue;
+
+  __spinlock_acquire(&base->timerLock);
+  uint64_t currentTime = getMonotonicTimeUs();
+  while (base->timerHeapSize && base->timerHeap[0]->endTime <= currentTime) {
+    aioTimer *timer = base->timerHeap[0];
+    timerHeapRemove(base, timer);
+    timer->next = expired;
+    expired = timer;
+  }
+
+  base->timerArmedTime = 0;
+  timerFdUpdate(base);
+  __spinlock_release(&base->timerLock);
+
+  while (expired) {
+    aioTimer *timer = expired;
+    asyncOpRoot *op = timer->op;
+    expired = timer->next;
+    if (op->opCode == actUserEvent) {
+      aioUserEvent *event = (aioUserEvent*)op;
+      uintptr_t seq = timer->seq;
+      int needRearm = 1;
+      int activated = eventTryActivate(event);
+      if (activated && event->counter > 0 && --event->counter == 0)
+        needRearm = 0;
+
+      if (needRearm) {
+        // Periodic timer, skip missed ticks; don't rearm timer stopped or restarted by other thread
+        uint64_t endTime = timer->endTime + op->timeout;
+        if (endTime <= currentTime)
+          endTime = currentTime + op->timeout;
+        __spinlock_acquire(&base->timerLock);
+        if (timer->seq == seq && timer->heapIndex == TIMER_NOT_QUEUED) {
+          timer->endTime = endTime;
+          timerHeapInsert(base, timer);
+          timerFdUpdate(base);
+        }
+        __spinlock_release(&base->timerLock);
+      }
+
+      if (activated) {
+        eventDeactivate(event);
+        op->finishMethod(op);
+        eventDecrementReference(event, 1);
+      }
+    } else {
+      opCancel(op, opEncodeTag(op, timer->tag), aosTimeout);
+    }
+  }
+}
+
+asyncBase *epollNewAsyncBase(int edgeTriggered)
 {
-  epollBase *base = malloc(sizeof(epollBase));
+  epollBase *base = alignedMalloc(sizeof(epollBase), CACHE_LINE_SIZE);
   if (base) {
     base->eventFd = eventfd(0, EFD_NONBLOCK);
     base->B.methodImpl = epollImpl;
+    base->edgeTriggered = edgeTriggered;
+    if (edgeTriggered)
+      base->B.methodImpl.combinerTaskHandler = epollEdgeCombinerTaskHandler;
     base->epollFd = epoll_create(MAX_EVENTS);
     if (base->epollFd == -1) {
       fprintf(stderr, " * epollNewAsyncBase: epoll_create failed\n");
     }
 
     base->eventObject = epollNewAioObject(&base->B, ioObjectDevice, &base->eventFd);
+    base->sleepingThreads = 0;
+    base->wakeupPending = 0;
 
     epollControl(base->epollFd, EPOLL_CTL_MOD, EPOLLIN | EPOLLONESHOT, base->eventFd, base->eventObject);
+
+    base->timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    base->timerObject = epollNewAioObject(&base->B, ioObjectDevice, &base->timerFd);
+    base->timerHeap = 0;
+    base->timerHeapSize = 0;
+    base->timerHeapCapacity = 0;
+    base->timerArmedTime = 0;
+    base->timerLock = 0;
+    epollControl(base->epollFd, EPOLL_CTL_MOD, EPOLLIN | EPOLLONESHOT, base->timerFd, base->timerObject);
   }
 
   return (asyncBase *)base;
 }
 
-void epollEnqueue(asyncBase *base, asyncOpRoot *op)
+void epollWakeup(asyncBase *base)
 {
   epollBase *localBase = (epollBase*)base;
+  // Read of sleepingThreads must be ordered after push (pairs with increment before queue check in loop)
+  if (__uint_atomic_fetch_and_add(&localBase->sleepingThreads, 0) &&
+      __uint_atomic_compare_and_swap(&localBase->wakeupPending, 0, 1))
+    eventfd_write(localBase->eventFd, 1);
+}
+
+void epollEnqueue(asyncBase *base, asyncOpRoot *op)
+{
   concurrentQueuePush(&base->globalQueue, op);
-  eventfd_write(localBase->eventFd, 1);
+  epollWakeup(base);
 }
 
 void epollPostEmptyOperation(asyncBase *base)
@@ -141,12 +447,11 @@ void epollPostEmptyOperation(asyncBase *base)
 void combinerTaskHandler(aioObjectRoot *object, asyncOpRoot *op, AsyncOpActionTy opMethod)
 {
   EPollObject *fdObject = (object->type == ioObjectDevice || object->type == ioObjectSocket) ? (EPollObject*)object : 0;
-  uint32_t ioEvents = fdObject ? fdObject->IoEvents : 0;
+  // Events can be added by other loop thread while handler runs, interest is not disarmed by event
+  uint32_t ioEvents = fdObject ? __uint_atomic_exchange((volatile unsigned*)&fdObject->IoEvents, 0) : 0;
 
-  int hasReadOp = object->readQueue.head != 0;
-  int hasWriteOp = object->writeQueue.head != 0;
   if (ioEvents & IO_EVENT_ERROR) {
-    // EPOLLRDHUP mapped to TAG_ERROR, cancel all operations with aosDisconnected status
+    // EPOLLHUP mapped to IO_EVENT_ERROR, cancel all operations with aosDisconnected status
     int available;
     int fd = getFd(fdObject);
     ioctl(fd, FIONREAD, &available);
@@ -164,32 +469,55 @@ void combinerTaskHandler(aioObjectRoot *object, asyncOpRoot *op, AsyncOpActionTy
     executeOperationList(&object->writeQueue);
 
   if (fdObject) {
-    int fd = getFd(fdObject);
-    epollBase *base = (epollBase*)object->base;
-    uint32_t currentEvents = 0;
     uint32_t newEvents = 0;
-
-    // "Calculate" current epoll_ctl mask because we don't have map<fd, oldMask>
-    // EPOLLIN/EPOLLOUT now enabled if read/write queue was not empty and file descriptor not deactivated by EPOLLONESHOT flag
-    int fdDeactivated = (ioEvents & (IO_EVENT_READ | IO_EVENT_WRITE)) != 0;
-
-    if (hasReadOp)
-      currentEvents |= EPOLLIN;
-    if (hasWriteOp)
-      currentEvents |= EPOLLOUT;
-    if (fdDeactivated)
-      currentEvents = 0;
-
     if (object->readQueue.head)
       newEvents |= EPOLLIN;
     if (object->writeQueue.head)
-      newEvents |= EPOLLOUT;
+      newEvents |= writeInterest(object->writeQueue.head);
 
-    if (ioEvents)
-      fdObject->IoEvents = 0;
-    if (currentEvents != newEvents) {
-      epollControl(base->epollFd, EPOLL_CTL_MOD, newEvents ? newEvents | EPOLLONESHOT | EPOLLRDHUP : 0, fd, object);
-    }
+    // epoll_ctl deferred until loop thread goes to epoll_wait, repeated changes collapse into one call
+    fdObject->DesiredEvents = newEvents;
+    if (newEvents != fdObject->RegisteredEvents)
+      epollQueueChange((epollBase*)object->base, fdObject);
+  }
+}
+
+void epollEdgeCombinerTaskHandler(aioObjectRoot *object, asyncOpRoot *op, AsyncOpActionTy opMethod)
+{
+  EPollObject *fdObject = (object->type == ioObjectDevice || object->type == ioObjectSocket) ? (EPollObject*)object : 0;
+  // Take cached readiness; bits not consumed by operation returned EAGAIN are put back below
+  uint32_t ioEvents = fdObject ? __uint_atomic_exchange((volatile unsigned*)&fdObject->IoEvents, 0) : 0;
+
+  if (ioEvents & IO_EVENT_ERROR) {
+    int available;
+    int fd = getFd(fdObject);
+    ioctl(fd, FIONREAD, &available);
+    if (available == 0)
+      cancelOperationList(&object->readQueue, aosDisconnected);
+    cancelOperationList(&object->writeQueue, aosDisconnected);
+  }
+
+  uint32_t needStart = 0;
+  if (op)
+    processAction(op, opMethod, &needStart);
+  if ((ioEvents & IO_EVENT_READ) && object->readQueue.head)
+    needStart |= IO_EVENT_READ;
+  if ((ioEvents & IO_EVENT_WRITE) && object->writeQueue.head)
+    needStart |= IO_EVENT_WRITE;
+  if (needStart & IO_EVENT_READ)
+    executeOperationList(&object->readQueue);
+  if (needStart & IO_EVENT_WRITE)
+    executeOperationList(&object->writeQueue);
+
+  if (fdObject) {
+    // Non-empty queue means head operation got EAGAIN, descriptor is not ready anymore
+    uint32_t stillReady = ioEvents & IO_EVENT_ERROR;
+    if ((ioEvents & IO_EVENT_READ) && !object->readQueue.head)
+      stillReady |= IO_EVENT_READ;
+    if ((ioEvents & IO_EVENT_WRITE) && !object->writeQueue.head)
+      stillReady |= IO_EVENT_WRITE;
+    if (stillReady)
+      __uint_atomic_fetch_and_or((volatile unsigned*)&fdObject->IoEvents, stillReady);
   }
 }
 
@@ -198,22 +526,31 @@ void epollNextFinishedOperation(asyncBase *base)
   int nfds, n;
   struct epoll_event events[MAX_EVENTS];
   epollBase *localBase = (epollBase *)base;
-  messageLoopThreadId = __sync_fetch_and_add(&base->messageLoopThreadCounter, 1);
+  loopThreadAttach(base);
+  changeList.base = localBase;
+  changeList.size = 0;
 
   while (1) {
     do {
       if (!executeGlobalQueue(base)) {
         // Found quit marker
-        unsigned threadsRunning = __uint_atomic_fetch_and_add(&base->messageLoopThreadCounter, 0u-1) - 1;
+        epollFlushChanges();
+        changeList.base = 0;
+        unsigned threadsRunning = loopThreadDetach(base);
         if (threadsRunning)
           epollEnqueue(base, 0);
         return;
       }
 
-      nfds = epoll_wait(localBase->epollFd, events, MAX_EVENTS, 500);
-      time_t currentTime = time(0);
-      if (currentTime % base->messageLoopThreadCounter == messageLoopThreadId)
-        processTimeoutQueue(base, currentTime);
+      // Operations enqueued before we marked as sleeping were not signaled, don't block in this case
+      epollFlushChanges();
+      __uint_atomic_fetch_and_add(&localBase->sleepingThreads, 1);
+      int timeout = concurrentQueueEmpty(&base->globalQueue) ? (int)timeoutQueueWaitTime(base, getMonotonicTimeMs(), 500) : 0;
+      uint64_t waitBeginNs = getMonotonicTimeNs();
+      nfds = epoll_wait(localBase->epollFd, events, MAX_EVENTS, timeout);
+      loopWaitStats(base, waitBeginNs, nfds);
+      __uint_atomic_fetch_and_add(&localBase->sleepingThreads, 0u-1);
+      processTimeoutQueue(base, getMonotonicTimeMs());
     } while (nfds <= 0 && errno == EINTR);
 
     for (n = 0; n < nfds; n++) {
@@ -223,46 +560,39 @@ void epollNextFinishedOperation(asyncBase *base)
       if (object == &localBase->eventObject->root) {
         eventfd_t eventValue;
         eventfd_read(localBase->eventFd, &eventValue);
+        __uint_atomic_compare_and_swap(&localBase->wakeupPending, 1, 0);
         epollControl(localBase->epollFd, EPOLL_CTL_MOD, EPOLLIN | EPOLLONESHOT, localBase->eventFd, object);
-      } else if (object->type == ioObjectTimer) {
-        uint64_t data;
-        aioTimer *timer = (aioTimer*)object;
-        if (read(timer->fd, &data, sizeof(data))) {
-          asyncOpRoot *op = timer->op;
-          if (op->opCode == actUserEvent) {
-            aioUserEvent *event = (aioUserEvent*)op;
-            if (eventTryActivate(event)) {
-              // TODO: compare timer and event tag
-              if (event->counter > 0 && --event->counter == 0) {
-                epollStopTimer(op);
-              } else {
-                // We need rearm epoll for timer
-                epollControl(localBase->epollFd,
-                             EPOLL_CTL_MOD,
-                             EPOLLIN | EPOLLONESHOT,
-                             timer->fd,
-                             __tagged_pointer_make(timer, opGetGeneration(op)));
-              }
-
-              eventDeactivate(event);
-              op->finishMethod(op);
-              eventDecrementReference(event, 1);
-            }
-          } else {
-            opCancel(op, opEncodeTag(op, timerId), aosTimeout);
-          }
-        }
+      } else if (object == &localBase->timerObject->root) {
+        processTimers(localBase);
+        epollControl(localBase->epollFd, EPOLL_CTL_MOD, EPOLLIN | EPOLLONESHOT, localBase->timerFd, object);
       } else {
         uint32_t eventMask = 0;
         if (events[n].events & EPOLLIN)
           eventMask |= IO_EVENT_READ;
         if (events[n].events & EPOLLOUT)
           eventMask |= IO_EVENT_WRITE;
+        // Peer shutdown of its sending side finishes reads only, writes still allowed (half-closed connection)
         if (events[n].events & EPOLLRDHUP)
+          eventMask |= IO_EVENT_READ;
+        if (events[n].events & EPOLLHUP)
           eventMask |= IO_EVENT_ERROR;
 
-        if (eventMask) {
-          ((EPollObject*)object)->IoEvents = eventMask;
+        if (localBase->edgeTriggered) {
+          // Socket error reported once, let pending operations get it from syscall
+          if (events[n].events & EPOLLERR)
+            eventMask |= IO_EVENT_READ | IO_EVENT_WRITE;
+          if (eventMask) {
+            __uint_atomic_fetch_and_or((volatile unsigned*)&((EPollObject*)object)->IoEvents, eventMask);
+            combinerPushCounter(object, COMBINER_TAG_ACCESS);
+          }
+        } else {
+          // Error queue has data (zero-copy send notification) or socket error
+          if (events[n].events & EPOLLERR)
+            eventMask |= IO_EVENT_WRITE;
+          if (!eventMask)
+            continue;
+          // Registration is kept armed: read finished and next one queued by same handler costs no epoll_ctl
+          __uint_atomic_fetch_and_or((volatile unsigned*)&((EPollObject*)object)->IoEvents, eventMask);
           combinerPushCounter(object, COMBINER_TAG_ACCESS);
         }
       }
@@ -276,11 +606,15 @@ aioObject *epollNewAioObject(asyncBase *base, IoObjectTy type, void *data)
   epollBase *localBase = (epollBase*)base;
   EPollObject *object = 0;
   if (!concurrentQueuePop(&objectPool, (void**)&object)) {
+    STATS_ADD(base, objectsAllocated, 1);
     object = alignedMalloc(sizeof(EPollObject), TAGGED_POINTER_ALIGNMENT);
     object->Object.buffer.ptr = 0;
     object->Object.buffer.totalSize = 0;
+    object->ChangeQueued = 0;
+    object->ChangeLock = 0;
   }
 
+  __spinlock_acquire(&object->ChangeLock);
   initObjectRoot(&object->Object.root, base, type, (aioObjectDestructor*)epollDeleteObject);
   switch (type) {
     case ioObjectDevice :
@@ -294,9 +628,19 @@ aioObject *epollNewAioObject(asyncBase *base, IoObjectTy type, void *data)
   }
 
   object->IoEvents = 0;
+  object->DesiredEvents = 0;
+  object->RegisteredEvents = 0;
+  object->ZeroCopyState = 0;
+  object->ZeroCopySent = 0;
+  object->ZeroCopyCompleted = 0;
   object->Object.buffer.offset = 0;
   object->Object.buffer.dataSize = 0;
-  epollControl(localBase->epollFd, EPOLL_CTL_ADD, 0, getFd(object), object);
+  epollControl(localBase->epollFd,
+               EPOLL_CTL_ADD,
+               localBase->edgeTriggered ? EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET : EPOLLONESHOT,
+               getFd(object),
+               object);
+  __spinlock_release(&object->ChangeLock);
   return &object->Object;
 }
 
@@ -320,6 +664,9 @@ int epollCancelAsyncOp(asyncOpRoot *opptr)
 void epollDeleteObject(aioObject *object)
 {
   epollBase *localBase = (epollBase*)object->root.base;
+  EPollObject *fdObject = (EPollObject*)object;
+  // Pending changelist entries can still reference this object
+  __spinlock_acquire(&fdObject->ChangeLock);
   switch (object->root.type) {
     case ioObjectDevice :
       epollControl(localBase->epollFd, EPOLL_CTL_DEL, 0, object->hDevice, 0);
@@ -335,57 +682,43 @@ void epollDeleteObject(aioObject *object)
       break;
   }
 
+  fdObject->RegisteredEvents = 0;
+  __spinlock_release(&fdObject->ChangeLock);
+  STATS_ADD(object->root.base, objectsReleased, 1);
   concurrentQueuePush(&objectPool, object);
 }
 
 void epollInitializeTimer(asyncBase *base, asyncOpRoot *op)
 {
-  epollBase *localBase = (epollBase*)base;
   aioTimer *timer = alignedMalloc(sizeof(aioTimer), TAGGED_POINTER_ALIGNMENT);
-  timer->root.base = base;
-  timer->root.type = ioObjectTimer;
-  timer->fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK);
+  timer->base = base;
   timer->op = op;
-  epollControl(localBase->epollFd, EPOLL_CTL_ADD, 0, timer->fd, timer);
+  timer->heapIndex = TIMER_NOT_QUEUED;
+  timer->seq = 0;
   op->timerId = timer;
 }
 
 void epollStartTimer(asyncOpRoot *op)
 {
-  struct itimerspec its;
-  int periodic = op->opCode == actUserEvent;
-  its.it_value.tv_sec = op->timeout / 1000000;
-  its.it_value.tv_nsec = (op->timeout % 1000000) * 1000;
-  its.it_interval.tv_sec = periodic ? its.it_value.tv_sec : 0;
-  its.it_interval.tv_nsec = periodic ? its.it_value.tv_nsec : 0;
-
-  aioTimer *timer = (aioTimer*)op->timerId;
-  timerfd_settime(timer->fd, 0, &its, 0);
-  epollControl(((epollBase*)timer->root.base)->epollFd,
-               EPOLL_CTL_MOD,
-               EPOLLIN | EPOLLONESHOT,
-               timer->fd,
-               __tagged_pointer_make(timer, opGetGeneration(op)));
+  timerArm((aioTimer*)op->timerId, getMonotonicTimeUs() + op->timeout, opGetGeneration(op));
 }
 
 
 void epollStopTimer(asyncOpRoot *op)
 {
-  uint64_t data;
-  struct itimerspec its;
-  memset(&its, 0, sizeof(its));
+  // Disarm is user space only, timerfd can wake up loop without expired timers
   aioTimer *timer = (aioTimer*)op->timerId;
-  timerfd_settime(timer->fd, 0, &its, 0);
-  epollControl(((epollBase*)timer->root.base)->epollFd, EPOLL_CTL_MOD, 0, timer->fd, &timer->root);
-  while (read(timer->fd, &data, sizeof(data)) > 0)
-    continue;
+  epollBase *base = (epollBase*)timer->base;
+  __spinlock_acquire(&base->timerLock);
+  if (timer->heapIndex != TIMER_NOT_QUEUED)
+    timerHeapRemove(base, timer);
+  timer->seq++;
+  __spinlock_release(&base->timerLock);
 }
 
 void epollDeleteTimer(asyncOpRoot *op)
 {
-  aioTimer *timer = (aioTimer*)op->timerId;
-  close(timer->fd);
-  free(timer);
+  free(op->timerId);
 }
 
 void epollActivate(aioUserEvent *op)
@@ -435,7 +768,8 @@ AsyncOpStatus epollAsyncAccept(asyncOpRoot *opptr)
     op->host.port = clientAddr.sin_port;
     return aosSuccess;
   } else {
-    return aosUnknownError;
+    // Connection taken by other listener of SO_REUSEPORT group or accept started before readiness
+    return errno == EAGAIN || errno == EWOULDBLOCK ? aosPending : aosUnknownError;
   }
 }
 
@@ -484,11 +818,83 @@ AsyncOpStatus epollAsyncRead(asyncOpRoot *opptr)
 }
 
 
+static int epollEnableZeroCopy(EPollObject *object)
+{
+  if (object->ZeroCopyState == 0) {
+    int one = 1;
+    object->ZeroCopyState = setsockopt(object->Object.hSocket, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0 ? 1 : -1;
+  }
+
+  return object->ZeroCopyState == 1;
+}
+
+static void epollReadZeroCopyNotifications(EPollObject *object)
+{
+  // Each notification contains range of released send call numbers
+  for (;;) {
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    uint8_t control[128];
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(object->Object.hSocket, &msg, MSG_ERRQUEUE) == -1)
+      break;
+
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if ((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+          (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+        struct sock_extended_err *err = (struct sock_extended_err*)CMSG_DATA(cmsg);
+        if (err->ee_origin == SO_EE_ORIGIN_ZEROCOPY && (int32_t)(err->ee_data + 1 - object->ZeroCopyCompleted) > 0)
+          object->ZeroCopyCompleted = err->ee_data + 1;
+      }
+    }
+  }
+}
+
+static AsyncOpStatus epollAsyncWriteZeroCopy(asyncOp *op, EPollObject *object)
+{
+  int fd = object->Object.hSocket;
+  if (op->state == 0) {
+    while (op->bytesTransferred < op->transactionSize) {
+      int zeroCopy = epollEnableZeroCopy(object);
+      uint8_t *ptr = (uint8_t*)op->buffer + op->bytesTransferred;
+      size_t size = op->transactionSize - op->bytesTransferred;
+      ssize_t bytesWritten = send(fd, ptr, size, MSG_NOSIGNAL | (zeroCopy ? MSG_ZEROCOPY : 0));
+      if (bytesWritten > 0) {
+        if (zeroCopy)
+          object->ZeroCopySent++;
+      } else if (bytesWritten == -1 && errno == ENOBUFS && zeroCopy) {
+        // Locked memory limit reached, copy this part
+        bytesWritten = send(fd, ptr, size, MSG_NOSIGNAL);
+      }
+
+      if (bytesWritten > 0) {
+        op->bytesTransferred += (size_t)bytesWritten;
+        if (!(op->root.flags & afWaitAll))
+          break;
+      } else if (bytesWritten == 0) {
+        return aosDisconnected;
+      } else {
+        return errno == EAGAIN ? aosPending : aosUnknownError;
+      }
+    }
+
+    op->state = 1;
+    op->zeroCopyId = object->ZeroCopySent;
+  }
+
+  epollReadZeroCopyNotifications(object);
+  return (int32_t)(object->ZeroCopyCompleted - op->zeroCopyId) >= 0 ? aosSuccess : aosPending;
+}
+
 AsyncOpStatus epollAsyncWrite(asyncOpRoot *opptr)
 {
   asyncOp *op = (asyncOp*)opptr;
   EPollObject *object = (EPollObject*)op->root.object;
   int fd = getFd(object);
+  if ((opptr->flags & afZeroCopy) && object->Object.root.type == ioObjectSocket)
+    return epollAsyncWriteZeroCopy(op, object);
 
   ssize_t bytesWritten = object->Object.root.type == ioObjectSocket ?
     send(fd, (uint8_t *)op->buffer + op->bytesTransferred, op->transactionSize - op->bytesTransferred, MSG_NOSIGNAL) :
@@ -507,6 +913,96 @@ AsyncOpStatus epollAsyncWrite(asyncOpRoot *opptr)
 }
 
 
+AsyncOpStatus epollAsyncReadMapped(asyncOpRoot *opptr)
+{
+  asyncOp *op = (asyncOp*)opptr;
+  EPollObject *object = (EPollObject*)op->root.object;
+  struct ioBuffer *sb = &object->Object.buffer;
+  int fd = object->Object.hSocket;
+  size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+  if (op->state == 0) {
+    op->state = 1;
+    if (sb->offset < sb->dataSize) {
+      // Buffered data precedes socket receive queue, nothing can be mapped
+      int finished;
+      op->buffer = malloc(op->transactionSize);
+      finished = copyFromBuffer(op->buffer, &op->bytesTransferred, sb, op->transactionSize);
+      mappedSegmentAppend(op, op->buffer, op->bytesTransferred);
+      if (finished || !(opptr->flags & afWaitAll))
+        return aosSuccess;
+    } else if (op->transactionSize >= pageSize) {
+      size_t mappingSize = op->transactionSize & ~(pageSize - 1);
+      void *mapping = mmap(0, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+      if (mapping != MAP_FAILED) {
+        op->mapping = mapping;
+        op->mappingSize = mappingSize;
+      }
+    }
+  }
+
+  for (;;) {
+    size_t remaining = op->transactionSize - op->mappedSize - op->bytesTransferred;
+    size_t copySize = remaining;
+    uint8_t *copyPtr;
+    ssize_t result;
+    if (remaining == 0)
+      return aosSuccess;
+
+    if (op->mapping && remaining >= pageSize) {
+      zeroCopyReceive zc;
+      socklen_t zcSize = sizeof(zc);
+      size_t length = remaining & ~(pageSize - 1);
+      memset(&zc, 0, sizeof(zc));
+      zc.address = (uint64_t)(uintptr_t)((uint8_t*)op->mapping + op->mappedSize);
+      zc.length = (uint32_t)(length < ZEROCOPY_RECEIVE_MAX ? length : ZEROCOPY_RECEIVE_MAX);
+      if (getsockopt(fd, IPPROTO_TCP, TCP_ZEROCOPY_RECEIVE, &zc, &zcSize) == 0) {
+        if (zc.length) {
+          mappedSegmentAppend(op, (uint8_t*)op->mapping + op->mappedSize, zc.length);
+          op->mappedSize += zc.length;
+          if (!(opptr->flags & afWaitAll))
+            return aosSuccess;
+          continue;
+        }
+
+        if (zc.recvSkipHint == 0) {
+          // Receive queue is empty
+          return aosPending;
+        }
+
+        // Copy unaligned data preceding next page only, following pages can be mapped again
+        if (zc.recvSkipHint < copySize)
+          copySize = zc.recvSkipHint;
+      } else if (errno == EAGAIN) {
+        return aosPending;
+      } else if (op->mappedSize == 0) {
+        // Receive zero-copy not supported: copy all data
+        munmap(op->mapping, op->mappingSize);
+        op->mapping = 0;
+        op->mappingSize = 0;
+      }
+    }
+
+    // Unaligned data, receive zero-copy not supported or end of stream
+    // Buffer capacity covers all data not mapped before first copy
+    if (!op->buffer)
+      op->buffer = malloc(op->transactionSize - op->mappedSize);
+    copyPtr = (uint8_t*)op->buffer + op->bytesTransferred;
+    result = recv(fd, copyPtr, copySize, 0);
+    if (result > 0) {
+      mappedSegmentAppend(op, copyPtr, (size_t)result);
+      op->bytesTransferred += (size_t)result;
+      if (!(opptr->flags & afWaitAll))
+        return aosSuccess;
+    } else if (result == 0) {
+      return aosDisconnected;
+    } else {
+      return errno == EAGAIN ? aosPending : aosUnknownError;
+    }
+  }
+}
+
+
 AsyncOpStatus epollAsyncReadMsg(asyncOpRoot *opptr)
 {
   asyncOp *op = (asyncOp*)opptr;
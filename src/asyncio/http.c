@@ -1,6 +1,7 @@
 #include "asyncio/http.h"
 
 #include "asyncio/asyncio.h"
+#include "asyncio/bufferPool.h"
 #include "asyncio/coroutine.h"
 #include <string.h>
 
@@ -173,7 +174,7 @@ static void releaseProc(asyncOpRoot *opptr)
 {
   HTTPOp *op = (HTTPOp*)opptr;
   if (op->internalBuffer) {
-    free(op->internalBuffer);
+    bufferPoolFree(op->internalBuffer, op->internalBufferSize);
     op->internalBuffer = 0;
     op->internalBufferSize = 0;
   }
@@ -285,6 +286,7 @@ HTTPClient *httpClientNew(asyncBase *base, aioObject *socket)
   }
 
   initObjectRoot(&client->root, base, ioObjectUserDefined, httpClientDestructor);
+  objectSetTraceKind(&client->root, atkHttp);
   client->isHttps = 0;
   client->inBufferOffset = 0;
   httpSetBuffer(&client->state, client->inBuffer, 0);
@@ -302,6 +304,7 @@ HTTPClient *httpsClientNew(asyncBase *base, SSLSocket *socket)
   }
 
   initObjectRoot(&client->root, base, ioObjectUserDefined, httpClientDestructor);
+  objectSetTraceKind(&client->root, atkHttp);
   client->isHttps = 1;
   client->inBufferOffset = 0;
   httpSetBuffer(&client->state, client->inBuffer, 0);
@@ -326,11 +329,7 @@ void aioHttpConnect(HTTPClient *client,
 
   if (tlsextHostName) {
     size_t tlsextHostNameSize = strlen(tlsextHostName) + 1;
-    if (op->internalBufferSize < tlsextHostNameSize) {
-      op->internalBuffer = realloc(op->internalBuffer, tlsextHostNameSize);
-      op->internalBufferSize = tlsextHostNameSize;
-    }
-
+    bufferPoolReserve(&op->internalBuffer, &op->internalBufferSize, tlsextHostNameSize);
     op->dataSize = tlsextHostNameSize;
     memcpy(op->internalBuffer, tlsextHostName, tlsextHostNameSize);
   } else {
@@ -350,15 +349,9 @@ void aioHttpRequest(HTTPClient *client,
                     void *arg)
 {
   HTTPOp *op = allocHttpOp(httpParseStart, requestFinish, client, httpOpConnect, parseCallback, parseArg, (void*)callback, arg, afNone, usTimeout);
-  if (op->internalBufferSize >= requestSize) {
-    op->dataSize = requestSize;
-    memcpy(op->internalBuffer, request, requestSize);
-  } else {
-    op->internalBuffer = realloc(op->internalBuffer, requestSize);
-    op->internalBufferSize = requestSize;
-    op->dataSize = requestSize;
-    memcpy(op->internalBuffer, request, requestSize);
-  }
+  bufferPoolReserve(&op->internalBuffer, &op->internalBufferSize, requestSize);
+  op->dataSize = requestSize;
+  memcpy(op->internalBuffer, request, requestSize);
 
   combinerPushOperation(&op->root, aaStart);
 }
@@ -371,11 +364,7 @@ int ioHttpConnect(HTTPClient *client, const HostAddress *address, const char *tl
 
   if (tlsextHostName) {
     size_t tlsextHostNameSize = strlen(tlsextHostName) + 1;
-    if (op->internalBufferSize < tlsextHostNameSize) {
-      op->internalBuffer = realloc(op->internalBuffer, tlsextHostNameSize);
-      op->internalBufferSize = tlsextHostNameSize;
-    }
-
+    bufferPoolReserve(&op->internalBuffer, &op->internalBufferSize, tlsextHostNameSize);
     op->dataSize = tlsextHostNameSize;
     memcpy(op->internalBuffer, tlsextHostName, tlsextHostNameSize);
   } else {
@@ -397,15 +386,9 @@ AsyncOpStatus ioHttpRequest(HTTPClient *client,
                             void *parseArg)
 {
   HTTPOp *op = allocHttpOp(httpParseStart, 0, client, httpOpConnect, parseCallback, parseArg, 0, 0, afCoroutine, usTimeout);
-  if (op->internalBufferSize >= requestSize) {
-    op->dataSize = requestSize;
-    memcpy(op->internalBuffer, request, requestSize);
-  } else {
-    op->internalBuffer = realloc(op->internalBuffer, requestSize);
-    op->internalBufferSize = requestSize;
-    op->dataSize = requestSize;
-    memcpy(op->internalBuffer, request, requestSize);
-  }
+  bufferPoolReserve(&op->internalBuffer, &op->internalBufferSize, requestSize);
+  op->dataSize = requestSize;
+  memcpy(op->internalBuffer, request, requestSize);
 
   combinerPushOperation(&op->root, aaStart);
   coroutineYield();
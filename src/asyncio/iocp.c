@@ -3,6 +3,7 @@
 #include <mswsock.h>
 #include <windows.h>
 #include "asyncioImpl.h"
+#include "asyncio/bufferPool.h"
 #include "atomic.h"
 #include <stdlib.h>
 #include <time.h>
@@ -72,7 +73,16 @@ static struct asyncImpl iocpImpl = {
   iocpAsyncRead,
   iocpAsyncWrite,
   iocpAsyncReadMsg,
-  iocpAsyncWriteMsg
+  iocpAsyncWriteMsg,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0
 };
 
 static aioObject *getObject(iocpOp *op)
@@ -187,7 +197,7 @@ void postEmptyOperation(asyncBase *base)
 
 asyncBase *iocpNewAsyncBase()
 {
-  iocpBase *base = malloc(sizeof(iocpBase));
+  iocpBase *base = alignedMalloc(sizeof(iocpBase), CACHE_LINE_SIZE);
   if (base) {
     SOCKET tmpSocket;
     DWORD numBytes = 0;
@@ -228,11 +238,11 @@ void iocpNextFinishedOperation(asyncBase *base)
   while (1) {
     ULONG N, i;
 
-    BOOL status = GetQueuedCompletionStatusEx(localBase->completionPort, entries, maxEntriesNum, &N, 500, FALSE);
-
-    time_t currentTime = time(0);
-    if (currentTime % base->messageLoopThreadCounter == messageLoopThreadId)
-      processTimeoutQueue(base, currentTime);
+    DWORD timeout = timeoutQueueWaitTime(base, getMonotonicTimeMs(), 500);
+    uint64_t waitBeginNs = getMonotonicTimeNs();
+    BOOL status = GetQueuedCompletionStatusEx(localBase->completionPort, entries, maxEntriesNum, &N, timeout, FALSE);
+    loopWaitStats(base, waitBeginNs, status ? (int)N : 0);
+    processTimeoutQueue(base, getMonotonicTimeMs());
 
     // ignore false status
     if (status == FALSE)
@@ -255,7 +265,7 @@ void iocpNextFinishedOperation(asyncBase *base)
             aioObjectRoot* object = op->object;
             if (op->callback)
               op->finishMethod(op);
-            concurrentQueuePush(op->objectPool, op);
+            objectPoolPush(op->objectPool, op);
             objectDecrementReference(object, 1);
           }
         }
@@ -318,6 +328,7 @@ aioObject *iocpNewAioObject(asyncBase *base, IoObjectTy type, void *data)
   iocpBase *localBase = (iocpBase*)base;
   aioObject* object = 0;
   if (!concurrentQueuePop(&objectPool, (void*)&object)) {
+    STATS_ADD(base, objectsAllocated, 1);
     object = alignedMalloc(sizeof(aioObject), TAGGED_POINTER_ALIGNMENT);
     object->buffer.ptr = 0;
     object->buffer.totalSize = 0;
@@ -386,6 +397,7 @@ void iocpDeleteObject(aioObject *object)
       break;
   }
 
+  STATS_ADD(object->root.base, objectsReleased, 1);
   concurrentQueuePush(&objectPool, object);
 }
 
@@ -463,14 +475,9 @@ AsyncOpStatus iocpAsyncAccept(asyncOpRoot *opptr)
   iocpOp *op = (iocpOp*)opptr;
   aioObject *object = getObject(op);
 
+  // Released by releaseOp to buffer pool
   const size_t acceptResultSize = 2 * (sizeof(struct sockaddr_in) + 16);
-  if (op->info.internalBuffer == 0) {
-    op->info.internalBuffer = malloc(acceptResultSize);
-    op->info.internalBufferSize = acceptResultSize;
-  } else if (op->info.internalBufferSize < acceptResultSize) {
-    op->info.internalBuffer = realloc(op->info.internalBuffer, acceptResultSize);
-    op->info.internalBufferSize = acceptResultSize;
-  }
+  bufferPoolReserve(&op->info.internalBuffer, &op->info.internalBufferSize, acceptResultSize);
 
   u_long arg = 1;
   op->info.acceptSocket = WSASocket(AF_INET, SOCK_STREAM, IPPROTO_TCP, NULL, 0, WSA_FLAG_OVERLAPPED);
@@ -578,15 +585,7 @@ AsyncOpStatus iocpAsyncReadMsg(asyncOpRoot *opptr)
   iocpOp *op = (iocpOp*)opptr;
   aioObject *object = getObject(op);
 
-  const size_t acceptResultSize = sizeof(recvFromData);
-  if (op->info.internalBuffer == 0) {
-    op->info.internalBuffer = malloc(acceptResultSize);
-    op->info.internalBufferSize = acceptResultSize;
-  }
-  else if (op->info.internalBufferSize < acceptResultSize) {
-    op->info.internalBuffer = realloc(op->info.internalBuffer, acceptResultSize);
-    op->info.internalBufferSize = acceptResultSize;
-  }
+  bufferPoolReserve(&op->info.internalBuffer, &op->info.internalBufferSize, sizeof(recvFromData));
 
   recvFromData *rf = op->info.internalBuffer;
   rf->size = sizeof(rf->addr);
@@ -0,0 +1,834 @@
+#include "asyncioImpl.h"
+#include "asyncio/coroutine.h"
+#include "atomic.h"
+#include "macro.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+static ConcurrentQueue objectPool;
+static ConcurrentQueue iouringOpPool;
+static ConcurrentQueue iouringOpTimerPool;
+
+#define MAX_EVENTS 256
+#define RING_ENTRIES 4096
+
+// Completion queue entry kind stored in high bits of user_data
+#define USER_DATA_KIND_SHIFT 60
+#define USER_DATA_PTR_MASK ((((uint64_t)1) << USER_DATA_KIND_SHIFT) - 1)
+
+typedef enum UserDataKindTy {
+  udOperation = 0,
+  udPoll,
+  udTimer,
+  udWakeup,
+  udIgnore
+} UserDataKindTy;
+
+__NO_PADDING_BEGIN
+typedef struct iouringBase {
+  asyncBase B;
+  int ringFd;
+  unsigned sqEntries;
+  unsigned *sqHead;
+  unsigned *sqTail;
+  unsigned *sqMask;
+  unsigned *sqArray;
+  struct io_uring_sqe *sqes;
+  unsigned *cqHead;
+  unsigned *cqTail;
+  unsigned *cqMask;
+  struct io_uring_cqe *cqes;
+  void *sqRing;
+  void *cqRing;
+  size_t sqRingSize;
+  size_t cqRingSize;
+  size_t sqesSize;
+  unsigned sqLock;
+  unsigned cqLock;
+} iouringBase;
+
+typedef struct iouringOp {
+  asyncOp info;
+  struct sockaddr_in address;
+  socklen_t addressSize;
+  struct iovec iov;
+  struct msghdr msg;
+} iouringOp;
+
+typedef struct aioTimer {
+  asyncBase *base;
+  asyncOpRoot *op;
+  struct __kernel_timespec ts;
+  uint64_t userData;
+  uintptr_t seq;
+} aioTimer;
+__NO_PADDING_END
+
+// Loop thread of this base submits queued SQEs right before waiting
+static __tls iouringBase *loopBase;
+
+void iouringCombinerTaskHandler(aioObjectRoot *object, asyncOpRoot *op, AsyncOpActionTy opMethod);
+void iouringEnqueue(asyncBase *base, asyncOpRoot *op);
+void iouringPostEmptyOperation(asyncBase *base);
+void iouringWakeup(asyncBase *base);
+void iouringNextFinishedOperation(asyncBase *base);
+aioObject *iouringNewAioObject(asyncBase *base, IoObjectTy type, void *data);
+asyncOpRoot *iouringNewAsyncOp(asyncBase *base, int isRealTime, ConcurrentQueue *objectPool, ConcurrentQueue *objectTimerPool);
+int iouringCancelAsyncOp(asyncOpRoot *opptr);
+void iouringDeleteObject(aioObject *object);
+void iouringInitializeTimer(asyncBase *base, asyncOpRoot *op);
+void iouringStartTimer(asyncOpRoot *op);
+void iouringStopTimer(asyncOpRoot *op);
+void iouringDeleteTimer(asyncOpRoot *op);
+void iouringActivate(aioUserEvent *op);
+AsyncOpStatus iouringAsyncConnect(asyncOpRoot *opptr);
+AsyncOpStatus iouringAsyncAccept(asyncOpRoot *opptr);
+AsyncOpStatus iouringAsyncRead(asyncOpRoot *opptr);
+AsyncOpStatus iouringAsyncWrite(asyncOpRoot *opptr);
+AsyncOpStatus iouringAsyncReadMsg(asyncOpRoot *op);
+AsyncOpStatus iouringAsyncWriteMsg(asyncOpRoot *op);
+AsyncOpStatus iouringAsyncReadMsgBatch(asyncOpRoot *op);
+AsyncOpStatus iouringAsyncWriteMsgBatch(asyncOpRoot *op);
+AsyncOpStatus iouringAsyncReadv(asyncOpRoot *op);
+AsyncOpStatus iouringAsyncWritev(asyncOpRoot *op);
+AsyncOpStatus iouringAsyncSendFile(asyncOpRoot *op);
+AsyncOpStatus iouringAsyncSplice(asyncOpRoot *op);
+AsyncOpStatus iouringAsyncReadProvided(asyncOpRoot *op);
+
+static struct asyncImpl iouringImpl = {
+  iouringCombinerTaskHandler,
+  iouringEnqueue,
+  iouringPostEmptyOperation,
+  iouringNextFinishedOperation,
+  iouringNewAioObject,
+  iouringNewAsyncOp,
+  iouringCancelAsyncOp,
+  iouringDeleteObject,
+  iouringInitializeTimer,
+  iouringStartTimer,
+  iouringStopTimer,
+  iouringDeleteTimer,
+  iouringActivate,
+  iouringAsyncConnect,
+  iouringAsyncAccept,
+  iouringAsyncRead,
+  iouringAsyncWrite,
+  iouringAsyncReadMsg,
+  iouringAsyncWriteMsg,
+  iouringAsyncReadMsgBatch,
+  iouringAsyncWriteMsgBatch,
+  iouringAsyncReadv,
+  iouringAsyncWritev,
+  0,
+  iouringAsyncSendFile,
+  iouringAsyncSplice,
+  iouringAsyncReadProvided,
+  iouringWakeup
+};
+
+static inline uint64_t makeUserData(void *ptr, UserDataKindTy kind)
+{
+  return (uint64_t)(uintptr_t)ptr | ((uint64_t)kind << USER_DATA_KIND_SHIFT);
+}
+
+static int getFd(aioObject *object)
+{
+  switch (object->root.type) {
+    case ioObjectDevice :
+      return object->hDevice;
+    case ioObjectSocket :
+      return object->hSocket;
+    default :
+      return -1;
+  }
+}
+
+static int iouringEnter(iouringBase *base, unsigned toSubmit, unsigned minComplete, unsigned flags, const void *arg, size_t argSize)
+{
+  return (int)syscall(__NR_io_uring_enter, base->ringFd, toSubmit, minComplete, flags, arg, argSize);
+}
+
+// Kernel skips waiting for completions if it submitted less entries than requested,
+// so exact number of queued SQEs must be passed to io_uring_enter
+static unsigned iouringQueued(iouringBase *base)
+{
+  return __atomic_load_n(base->sqTail, __ATOMIC_ACQUIRE) - __atomic_load_n(base->sqHead, __ATOMIC_ACQUIRE);
+}
+
+static void iouringFlush(iouringBase *base)
+{
+  unsigned queued = iouringQueued(base);
+  if (queued)
+    iouringEnter(base, queued, 0, 0, 0, 0);
+}
+
+static struct io_uring_sqe *iouringAcquireSqe(iouringBase *base)
+{
+  __spinlock_acquire(&base->sqLock);
+  for (;;) {
+    unsigned head = __atomic_load_n(base->sqHead, __ATOMIC_ACQUIRE);
+    unsigned tail = *base->sqTail;
+    if (tail - head < base->sqEntries) {
+      struct io_uring_sqe *sqe = &base->sqes[tail & *base->sqMask];
+      memset(sqe, 0, sizeof(struct io_uring_sqe));
+      return sqe;
+    }
+
+    // Submission queue is full, pass it to kernel
+    iouringEnter(base, iouringQueued(base), 0, 0, 0, 0);
+  }
+}
+
+static void iouringReleaseSqe(iouringBase *base)
+{
+  __atomic_store_n(base->sqTail, *base->sqTail + 1, __ATOMIC_RELEASE);
+  __spinlock_release(&base->sqLock);
+  if (loopBase != base)
+    iouringFlush(base);
+}
+
+static void iouringSubmit(iouringBase *base, uint8_t opcode, int fd, const void *addr, uint32_t len, uint64_t offset, uint32_t opFlags, uint64_t userData)
+{
+  struct io_uring_sqe *sqe = iouringAcquireSqe(base);
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)(uintptr_t)addr;
+  sqe->len = len;
+  sqe->off = offset;
+  sqe->rw_flags = (__kernel_rwf_t)opFlags;
+  sqe->user_data = userData;
+  iouringReleaseSqe(base);
+}
+
+static void iouringSubmitWakeup(iouringBase *base)
+{
+  iouringSubmit(base, IORING_OP_NOP, -1, 0, 0, 0, 0, makeUserData(0, udWakeup));
+}
+
+static void iouringArmTimer(aioTimer *timer, uintptr_t tag)
+{
+  iouringBase *base = (iouringBase*)timer->base;
+  asyncOpRoot *op = timer->op;
+  if (timer->userData)
+    iouringSubmit(base, IORING_OP_TIMEOUT_REMOVE, -1, (void*)(uintptr_t)timer->userData, 0, 0, 0, makeUserData(0, udIgnore));
+
+  timer->ts.tv_sec = (int64_t)(op->timeout / 1000000);
+  timer->ts.tv_nsec = (long long)((op->timeout % 1000000) * 1000);
+  timer->userData = makeUserData(__tagged_pointer_make(timer, tag), udTimer);
+  iouringSubmit(base, IORING_OP_TIMEOUT, -1, &timer->ts, 1, 0, 0, timer->userData);
+}
+
+static int iouringSetup(iouringBase *base, unsigned entries)
+{
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  base->ringFd = (int)syscall(__NR_io_uring_setup, entries, &params);
+  if (base->ringFd == -1)
+    return 0;
+
+  // Waiting with timeout requires IORING_ENTER_EXT_ARG (linux 5.11+)
+  if (!(params.features & IORING_FEAT_EXT_ARG)) {
+    close(base->ringFd);
+    return 0;
+  }
+
+  base->sqRingSize = params.sq_off.array + params.sq_entries*sizeof(unsigned);
+  base->cqRingSize = params.cq_off.cqes + params.cq_entries*sizeof(struct io_uring_cqe);
+  base->sqesSize = params.sq_entries*sizeof(struct io_uring_sqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (base->cqRingSize > base->sqRingSize)
+      base->sqRingSize = base->cqRingSize;
+    base->cqRingSize = base->sqRingSize;
+  }
+
+  base->sqRing = mmap(0, base->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, base->ringFd, IORING_OFF_SQ_RING);
+  base->cqRing = (params.features & IORING_FEAT_SINGLE_MMAP) ?
+    base->sqRing :
+    mmap(0, base->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, base->ringFd, IORING_OFF_CQ_RING);
+  base->sqes = mmap(0, base->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, base->ringFd, IORING_OFF_SQES);
+  if (base->sqRing == MAP_FAILED || base->cqRing == MAP_FAILED || base->sqes == MAP_FAILED) {
+    fprintf(stderr, " * iouringNewAsyncBase: mmap failed\n");
+    close(base->ringFd);
+    return 0;
+  }
+
+  uint8_t *sq = (uint8_t*)base->sqRing;
+  uint8_t *cq = (uint8_t*)base->cqRing;
+  base->sqEntries = params.sq_entries;
+  base->sqHead = (unsigned*)(sq + params.sq_off.head);
+  base->sqTail = (unsigned*)(sq + params.sq_off.tail);
+  base->sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+  base->sqArray = (unsigned*)(sq + params.sq_off.array);
+  base->cqHead = (unsigned*)(cq + params.cq_off.head);
+  base->cqTail = (unsigned*)(cq + params.cq_off.tail);
+  base->cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+  base->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+  // SQE with index N always placed at ring position N
+  for (unsigned i = 0; i < base->sqEntries; i++)
+    base->sqArray[i] = i;
+  return 1;
+}
+
+asyncBase *iouringNewAsyncBase()
+{
+  iouringBase *base = alignedMalloc(sizeof(iouringBase), CACHE_LINE_SIZE);
+  if (base) {
+    base->B.methodImpl = iouringImpl;
+    base->sqLock = 0;
+    base->cqLock = 0;
+    if (!iouringSetup(base, RING_ENTRIES)) {
+      free(base);
+      return 0;
+    }
+  }
+
+  return (asyncBase*)base;
+}
+
+void iouringCombinerTaskHandler(aioObjectRoot *object, asyncOpRoot *op, AsyncOpActionTy opMethod)
+{
+  uint32_t needStart = 0;
+  if (op) {
+    processAction(op, opMethod, &needStart);
+    if (needStart & IO_EVENT_READ)
+      executeOperationList(&object->readQueue);
+    if (needStart & IO_EVENT_WRITE)
+      executeOperationList(&object->writeQueue);
+  }
+}
+
+void iouringEnqueue(asyncBase *base, asyncOpRoot *op)
+{
+  iouringBase *localBase = (iouringBase*)base;
+  concurrentQueuePush(&base->globalQueue, op);
+  // Loop thread drains global queue before next wait, wakeup needed only for other threads
+  if (loopBase != localBase)
+    iouringSubmitWakeup(localBase);
+}
+
+void iouringWakeup(asyncBase *base)
+{
+  iouringSubmitWakeup((iouringBase*)base);
+}
+
+void iouringPostEmptyOperation(asyncBase *base)
+{
+  iouringEnqueue(base, 0);
+}
+
+static AsyncOpStatus iouringMakeStatus(int32_t res)
+{
+  switch (-res) {
+    case ECANCELED :
+      return aosCanceled;
+    case ECONNRESET :
+    case EPIPE :
+      return aosDisconnected;
+    case EMSGSIZE :
+    case ENOMEM :
+      return aosBufferTooSmall;
+    default :
+      return aosUnknownError;
+  }
+}
+
+static void iouringOpFinished(iouringBase *base, iouringOp *op, int32_t res)
+{
+  asyncOpRoot *root = &op->info.root;
+  aioObject *object = (aioObject*)root->object;
+  AsyncOpStatus result = aosSuccess;
+
+  if (res == -EAGAIN && opGetStatus(root) == aosPending) {
+    // File descriptor does not support poll-driven retry inside kernel
+    short events = (root->opCode & OPCODE_WRITE) ? POLLOUT : POLLIN;
+    iouringSubmit(base, IORING_OP_POLL_ADD, getFd(object), 0, 0, 0, (uint32_t)events, makeUserData(op, udPoll));
+    return;
+  }
+
+  if (res >= 0) {
+    size_t bytes = (size_t)res;
+    switch (root->opCode) {
+      case actAccept : {
+        op->info.acceptSocket = res;
+        op->info.host.family = op->address.sin_family;
+        op->info.host.ipv4 = op->address.sin_addr.s_addr;
+        op->info.host.port = op->address.sin_port;
+        break;
+      }
+
+      case actRead : {
+        struct ioBuffer *sb = &object->buffer;
+        if (bytes == 0) {
+          result = op->info.transactionSize - op->info.bytesTransferred > 0 ? aosDisconnected : aosSuccess;
+        } else if (op->info.transactionSize <= sb->totalSize) {
+          sb->dataSize = bytes;
+          sb->offset = 0;
+          if (!copyFromBuffer(op->info.buffer, &op->info.bytesTransferred, sb, op->info.transactionSize) && (root->flags & afWaitAll)) {
+            combinerPushOperation(root, aaContinue);
+            return;
+          }
+        } else {
+          op->info.bytesTransferred += bytes;
+          if ((root->flags & afWaitAll) && op->info.bytesTransferred < op->info.transactionSize) {
+            combinerPushOperation(root, aaContinue);
+            return;
+          }
+        }
+        break;
+      }
+
+      case actWrite : {
+        if (bytes == 0) {
+          result = op->info.transactionSize - op->info.bytesTransferred > 0 ? aosDisconnected : aosSuccess;
+        } else {
+          op->info.bytesTransferred += bytes;
+          if ((root->flags & afWaitAll) && op->info.bytesTransferred < op->info.transactionSize) {
+            combinerPushOperation(root, aaContinue);
+            return;
+          }
+        }
+        break;
+      }
+
+      case actReadMsg : {
+        op->info.host.family = 0;
+        op->info.host.ipv4 = op->address.sin_addr.s_addr;
+        op->info.host.port = op->address.sin_port;
+        op->info.bytesTransferred = bytes;
+        break;
+      }
+
+      case actWriteMsg : {
+        op->info.bytesTransferred = bytes;
+        break;
+      }
+
+      case actReadv :
+      case actWritev : {
+        if (bytes == 0) {
+          result = op->info.transactionSize - op->info.bytesTransferred > 0 ? aosDisconnected : aosSuccess;
+        } else {
+          op->info.bytesTransferred += bytes;
+          ioVecAdvance(&op->info, bytes);
+          if ((root->flags & afWaitAll) && op->info.bytesTransferred < op->info.transactionSize) {
+            combinerPushOperation(root, aaContinue);
+            return;
+          }
+        }
+        break;
+      }
+
+      default :
+        break;
+    }
+  } else {
+    result = iouringMakeStatus(res);
+  }
+
+  opSetStatus(root, opGetGeneration(root), result);
+  combinerPushOperation(root, aaFinish);
+}
+
+static void iouringTimerFired(aioTimer *timer, uint64_t userData, uintptr_t tag)
+{
+  // Ignore timers which was stopped or rearmed after this completion was generated
+  if (timer->userData != userData)
+    return;
+
+  asyncOpRoot *op = timer->op;
+  if (op->opCode == actUserEvent) {
+    aioUserEvent *event = (aioUserEvent*)op;
+    int needRearm = 1;
+    if (eventTryActivate(event)) {
+      if (event->counter > 0 && --event->counter == 0)
+        needRearm = 0;
+      if (needRearm)
+        iouringArmTimer(timer, ++timer->seq);
+      else
+        timer->userData = 0;
+
+      eventDeactivate(event);
+      op->finishMethod(op);
+      eventDecrementReference(event, 1);
+    } else {
+      iouringArmTimer(timer, ++timer->seq);
+    }
+  } else {
+    timer->userData = 0;
+    opCancel(op, opEncodeTag(op, tag), aosTimeout);
+  }
+}
+
+static void iouringProcessCompletion(iouringBase *base, const struct io_uring_cqe *cqe)
+{
+  UserDataKindTy kind = (UserDataKindTy)(cqe->user_data >> USER_DATA_KIND_SHIFT);
+  void *ptr = (void*)(uintptr_t)(cqe->user_data & USER_DATA_PTR_MASK);
+  switch (kind) {
+    case udOperation :
+      iouringOpFinished(base, (iouringOp*)ptr, cqe->res);
+      break;
+    case udPoll :
+      // Descriptor ready (or poll canceled), restart operation inside combiner
+      combinerPushOperation((asyncOpRoot*)ptr, aaContinue);
+      break;
+    case udTimer : {
+      if (cqe->res == -ETIME) {
+        aioTimer *timer;
+        uintptr_t tag;
+        __tagged_pointer_decode(ptr, (void**)&timer, &tag);
+        iouringTimerFired(timer, cqe->user_data, tag);
+      }
+      break;
+    }
+    default :
+      break;
+  }
+}
+
+static unsigned iouringReap(iouringBase *base, struct io_uring_cqe *cqes, unsigned maxCount)
+{
+  unsigned count = 0;
+  __spinlock_acquire(&base->cqLock);
+  unsigned head = *base->cqHead;
+  unsigned tail = __atomic_load_n(base->cqTail, __ATOMIC_ACQUIRE);
+  while (head != tail && count < maxCount) {
+    cqes[count++] = base->cqes[head & *base->cqMask];
+    head++;
+  }
+  __atomic_store_n(base->cqHead, head, __ATOMIC_RELEASE);
+  __spinlock_release(&base->cqLock);
+  return count;
+}
+
+void iouringNextFinishedOperation(asyncBase *base)
+{
+  struct io_uring_cqe cqes[MAX_EVENTS];
+  iouringBase *localBase = (iouringBase*)base;
+  loopThreadAttach(base);
+  loopBase = localBase;
+
+  while (1) {
+    if (!executeGlobalQueue(base)) {
+      // Found quit marker
+      loopBase = 0;
+      iouringFlush(localBase);
+      unsigned threadsRunning = loopThreadDetach(base);
+      if (threadsRunning)
+        iouringEnqueue(base, 0);
+      return;
+    }
+
+    // Submit all queued SQEs and wait for completions
+    struct __kernel_timespec timeout;
+    struct io_uring_getevents_arg arg;
+    unsigned waitTime = timeoutQueueWaitTime(base, getMonotonicTimeMs(), 500);
+    timeout.tv_sec = 0;
+    timeout.tv_nsec = (long long)waitTime*1000000;
+    memset(&arg, 0, sizeof(arg));
+    arg.ts = (uint64_t)(uintptr_t)&timeout;
+    uint64_t waitBeginNs = getMonotonicTimeNs();
+    iouringEnter(localBase, iouringQueued(localBase), 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+
+    processTimeoutQueue(base, getMonotonicTimeMs());
+
+    unsigned n = iouringReap(localBase, cqes, MAX_EVENTS);
+    loopWaitStats(base, waitBeginNs, (int)n);
+    for (unsigned i = 0; i < n; i++)
+      iouringProcessCompletion(localBase, &cqes[i]);
+  }
+}
+
+aioObject *iouringNewAioObject(asyncBase *base, IoObjectTy type, void *data)
+{
+  aioObject *object = 0;
+  if (!concurrentQueuePop(&objectPool, (void**)&object)) {
+    STATS_ADD(base, objectsAllocated, 1);
+    object = alignedMalloc(sizeof(aioObject), TAGGED_POINTER_ALIGNMENT);
+    object->buffer.ptr = 0;
+    object->buffer.totalSize = 0;
+  }
+
+  initObjectRoot(&object->root, base, type, (aioObjectDestructor*)iouringDeleteObject);
+  switch (type) {
+    case ioObjectDevice :
+      object->hDevice = *(iodevTy *)data;
+      break;
+    case ioObjectSocket :
+      object->hSocket = *(socketTy *)data;
+      break;
+    default :
+      break;
+  }
+
+  object->buffer.offset = 0;
+  object->buffer.dataSize = 0;
+  return object;
+}
+
+asyncOpRoot *iouringNewAsyncOp(asyncBase *base, int isRealTime, ConcurrentQueue *objectPool, ConcurrentQueue *objectTimerPool)
+{
+  __UNUSED(objectPool);
+  __UNUSED(objectTimerPool);
+  // iouringOp is larger than generic asyncOp, it can't be shared with other backends
+  iouringOp *op = 0;
+  if (asyncOpAlloc(base, sizeof(iouringOp), isRealTime, &iouringOpPool, &iouringOpTimerPool, (asyncOpRoot**)&op)) {
+    op->info.internalBuffer = 0;
+    op->info.internalBufferSize = 0;
+  }
+
+  return &op->info.root;
+}
+
+int iouringCancelAsyncOp(asyncOpRoot *opptr)
+{
+  // Operation will be finished by its own completion with -ECANCELED status
+  iouringBase *base = (iouringBase*)opptr->object->base;
+  iouringSubmit(base, IORING_OP_ASYNC_CANCEL, -1, (void*)(uintptr_t)makeUserData(opptr, udOperation), 0, 0, 0, makeUserData(0, udIgnore));
+  iouringSubmit(base, IORING_OP_ASYNC_CANCEL, -1, (void*)(uintptr_t)makeUserData(opptr, udPoll), 0, 0, 0, makeUserData(0, udIgnore));
+  return 0;
+}
+
+void iouringDeleteObject(aioObject *object)
+{
+  switch (object->root.type) {
+    case ioObjectDevice :
+      close(object->hDevice);
+      object->hDevice = -1;
+      break;
+    case ioObjectSocket :
+      close(object->hSocket);
+      object->hSocket = -1;
+      break;
+    default :
+      break;
+  }
+
+  STATS_ADD(object->root.base, objectsReleased, 1);
+  concurrentQueuePush(&objectPool, object);
+}
+
+void iouringInitializeTimer(asyncBase *base, asyncOpRoot *op)
+{
+  aioTimer *timer = alignedMalloc(sizeof(aioTimer), TAGGED_POINTER_ALIGNMENT);
+  timer->base = base;
+  timer->op = op;
+  timer->userData = 0;
+  timer->seq = 0;
+  op->timerId = timer;
+}
+
+void iouringStartTimer(asyncOpRoot *op)
+{
+  aioTimer *timer = (aioTimer*)op->timerId;
+  iouringArmTimer(timer, op->opCode == actUserEvent ? ++timer->seq : opGetGeneration(op));
+}
+
+void iouringStopTimer(asyncOpRoot *op)
+{
+  aioTimer *timer = (aioTimer*)op->timerId;
+  if (timer->userData) {
+    iouringSubmit((iouringBase*)timer->base, IORING_OP_TIMEOUT_REMOVE, -1, (void*)(uintptr_t)timer->userData, 0, 0, 0, makeUserData(0, udIgnore));
+    timer->userData = 0;
+  }
+}
+
+void iouringDeleteTimer(asyncOpRoot *op)
+{
+  free(op->timerId);
+}
+
+void iouringActivate(aioUserEvent *op)
+{
+  iouringEnqueue(op->base, &op->root);
+}
+
+AsyncOpStatus iouringAsyncConnect(asyncOpRoot *opptr)
+{
+  iouringOp *op = (iouringOp*)opptr;
+  aioObject *object = (aioObject*)opptr->object;
+  op->address.sin_family = op->info.host.family;
+  op->address.sin_addr.s_addr = op->info.host.ipv4;
+  op->address.sin_port = op->info.host.port;
+  iouringSubmit((iouringBase*)object->root.base, IORING_OP_CONNECT, getFd(object), &op->address, 0, sizeof(op->address), 0, makeUserData(op, udOperation));
+  return aosPending;
+}
+
+AsyncOpStatus iouringAsyncAccept(asyncOpRoot *opptr)
+{
+  iouringOp *op = (iouringOp*)opptr;
+  aioObject *object = (aioObject*)opptr->object;
+  op->addressSize = sizeof(op->address);
+  iouringSubmit((iouringBase*)object->root.base, IORING_OP_ACCEPT, getFd(object), &op->address, 0, (uint64_t)(uintptr_t)&op->addressSize, SOCK_NONBLOCK, makeUserData(op, udOperation));
+  return aosPending;
+}
+
+static inline uint32_t clampTransferSize(size_t size)
+{
+  // Completion result is int32, larger transfers are split, afWaitAll resubmits the rest
+  return size <= INT_MAX ? (uint32_t)size : INT_MAX;
+}
+
+AsyncOpStatus iouringAsyncRead(asyncOpRoot *opptr)
+{
+  iouringOp *op = (iouringOp*)opptr;
+  aioObject *object = (aioObject*)opptr->object;
+  struct ioBuffer *sb = &object->buffer;
+
+  if (copyFromBuffer(op->info.buffer, &op->info.bytesTransferred, sb, op->info.transactionSize))
+    return aosSuccess;
+
+  void *ptr;
+  size_t size;
+  if (op->info.transactionSize <= sb->totalSize) {
+    ptr = sb->ptr;
+    size = sb->totalSize;
+  } else {
+    ptr = (uint8_t*)op->info.buffer + op->info.bytesTransferred;
+    size = op->info.transactionSize - op->info.bytesTransferred;
+  }
+
+  if (object->root.type == ioObjectSocket)
+    iouringSubmit((iouringBase*)object->root.base, IORING_OP_RECV, getFd(object), ptr, clampTransferSize(size), 0, 0, makeUserData(op, udOperation));
+  else
+    iouringSubmit((iouringBase*)object->root.base, IORING_OP_READ, getFd(object), ptr, clampTransferSize(size), (uint64_t)-1, 0, makeUserData(op, udOperation));
+  return aosPending;
+}
+
+AsyncOpStatus iouringAsyncWrite(asyncOpRoot *opptr)
+{
+  iouringOp *op = (iouringOp*)opptr;
+  aioObject *object = (aioObject*)opptr->object;
+  void *ptr = (uint8_t*)op->info.buffer + op->info.bytesTransferred;
+  size_t size = op->info.transactionSize - op->info.bytesTransferred;
+
+  if (object->root.type == ioObjectSocket)
+    iouringSubmit((iouringBase*)object->root.base, IORING_OP_SEND, getFd(object), ptr, clampTransferSize(size), 0, MSG_NOSIGNAL, makeUserData(op, udOperation));
+  else
+    iouringSubmit((iouringBase*)object->root.base, IORING_OP_WRITE, getFd(object), ptr, clampTransferSize(size), (uint64_t)-1, 0, makeUserData(op, udOperation));
+  return aosPending;
+}
+
+AsyncOpStatus iouringAsyncReadMsg(asyncOpRoot *opptr)
+{
+  iouringOp *op = (iouringOp*)opptr;
+  aioObject *object = (aioObject*)opptr->object;
+  op->iov.iov_base = op->info.buffer;
+  op->iov.iov_len = op->info.transactionSize;
+  memset(&op->msg, 0, sizeof(op->msg));
+  op->msg.msg_name = &op->address;
+  op->msg.msg_namelen = sizeof(op->address);
+  op->msg.msg_iov = &op->iov;
+  op->msg.msg_iovlen = 1;
+  iouringSubmit((iouringBase*)object->root.base, IORING_OP_RECVMSG, getFd(object), &op->msg, 1, 0, 0, makeUserData(op, udOperation));
+  return aosPending;
+}
+
+AsyncOpStatus iouringAsyncWriteMsg(asyncOpRoot *opptr)
+{
+  iouringOp *op = (iouringOp*)opptr;
+  aioObject *object = (aioObject*)opptr->object;
+  op->address.sin_family = op->info.host.family;
+  op->address.sin_addr.s_addr = op->info.host.ipv4;
+  op->address.sin_port = op->info.host.port;
+  op->iov.iov_base = op->info.buffer;
+  op->iov.iov_len = op->info.transactionSize;
+  memset(&op->msg, 0, sizeof(op->msg));
+  op->msg.msg_name = &op->address;
+  op->msg.msg_namelen = sizeof(op->address);
+  op->msg.msg_iov = &op->iov;
+  op->msg.msg_iovlen = 1;
+  iouringSubmit((iouringBase*)object->root.base, IORING_OP_SENDMSG, getFd(object), &op->msg, 1, 0, MSG_NOSIGNAL, makeUserData(op, udOperation));
+  return aosPending;
+}
+
+// Batches executed by recvmmsg/sendmmsg, ring used only for readiness notification
+AsyncOpStatus iouringAsyncReadMsgBatch(asyncOpRoot *opptr)
+{
+  AsyncOpStatus status = readMsgBatchProc(opptr);
+  if (status == aosPending)
+    iouringSubmit((iouringBase*)opptr->object->base, IORING_OP_POLL_ADD, getFd((aioObject*)opptr->object), 0, 0, 0, POLLIN, makeUserData(opptr, udPoll));
+  return status;
+}
+
+AsyncOpStatus iouringAsyncWriteMsgBatch(asyncOpRoot *opptr)
+{
+  AsyncOpStatus status = writeMsgBatchProc(opptr);
+  if (status == aosPending)
+    iouringSubmit((iouringBase*)opptr->object->base, IORING_OP_POLL_ADD, getFd((aioObject*)opptr->object), 0, 0, 0, POLLOUT, makeUserData(opptr, udPoll));
+  return status;
+}
+
+AsyncOpStatus iouringAsyncSendFile(asyncOpRoot *opptr)
+{
+  // sendfile executed synchronously, ring used for waiting socket readiness only
+  AsyncOpStatus status = sendFileProc(opptr);
+  if (status == aosPending)
+    iouringSubmit((iouringBase*)opptr->object->base, IORING_OP_POLL_ADD, getFd((aioObject*)opptr->object), 0, 0, 0, POLLOUT, makeUserData(opptr, udPoll));
+  return status;
+}
+
+AsyncOpStatus iouringAsyncSplice(asyncOpRoot *opptr)
+{
+  // splice executed synchronously like sendfile
+  AsyncOpStatus status = spliceProc(opptr);
+  if (status == aosPending)
+    iouringSubmit((iouringBase*)opptr->object->base, IORING_OP_POLL_ADD, getFd((aioObject*)opptr->object), 0, 0, 0, opptr->opCode == actSpliceTo ? POLLOUT : POLLIN, makeUserData(opptr, udPoll));
+  return status;
+}
+
+AsyncOpStatus iouringAsyncReadProvided(asyncOpRoot *opptr)
+{
+  // POLL_ADD instead of RECV: buffer taken from pool when data already arrived
+  AsyncOpStatus status = readProvidedProc(opptr);
+  if (status == aosPending)
+    iouringSubmit((iouringBase*)opptr->object->base, IORING_OP_POLL_ADD, getFd((aioObject*)opptr->object), 0, 0, 0, POLLIN, makeUserData(opptr, udPoll));
+  return status;
+}
+
+static void iouringSubmitVector(iouringOp *op, int isWrite)
+{
+  aioObject *object = (aioObject*)op->info.root.object;
+  iouringBase *base = (iouringBase*)object->root.base;
+  unsigned count = (unsigned)(op->info.iovCount < IO_VECTOR_MAX ? op->info.iovCount : IO_VECTOR_MAX);
+  if (object->root.type == ioObjectSocket) {
+    memset(&op->msg, 0, sizeof(op->msg));
+    op->msg.msg_iov = op->info.iov;
+    op->msg.msg_iovlen = count;
+    if (isWrite)
+      iouringSubmit(base, IORING_OP_SENDMSG, getFd(object), &op->msg, 1, 0, MSG_NOSIGNAL, makeUserData(op, udOperation));
+    else
+      iouringSubmit(base, IORING_OP_RECVMSG, getFd(object), &op->msg, 1, 0, 0, makeUserData(op, udOperation));
+  } else {
+    iouringSubmit(base, isWrite ? IORING_OP_WRITEV : IORING_OP_READV, getFd(object), op->info.iov, count, (uint64_t)-1, 0, makeUserData(op, udOperation));
+  }
+}
+
+AsyncOpStatus iouringAsyncReadv(asyncOpRoot *opptr)
+{
+  iouringOp *op = (iouringOp*)opptr;
+  if (ioVecCopyFromBuffer(&op->info, &((aioObject*)opptr->object)->buffer))
+    return aosSuccess;
+  iouringSubmitVector(op, 0);
+  return aosPending;
+}
+
+AsyncOpStatus iouringAsyncWritev(asyncOpRoot *opptr)
+{
+  iouringSubmitVector((iouringOp*)opptr, 1);
+  return aosPending;
+}
@@ -38,6 +38,7 @@ typedef struct aioTimer {
 void combinerTaskHandler(aioObjectRoot *object, asyncOpRoot *op, AsyncOpActionTy opMethod);
 void kqueueEnqueue(asyncBase *base, asyncOpRoot *op);
 void kqueuePostEmptyOperation(asyncBase *base);
+void kqueueWakeup(asyncBase *base);
 void kqueueNextFinishedOperation(asyncBase *base);
 aioObject *kqueueNewAioObject(asyncBase *base, IoObjectTy type, void *data);
 asyncOpRoot *kqueueNewAsyncOp(asyncBase *base, int isRealTime, ConcurrentQueue *objectPool, ConcurrentQueue *objectTimerPool);
@@ -74,7 +75,16 @@ static struct asyncImpl kqueueImpl = {
   kqueueAsyncRead,
   kqueueAsyncWrite,
   kqueueAsyncReadMsg,
-  kqueueAsyncWriteMsg
+  kqueueAsyncWriteMsg,
+  readMsgBatchProc,
+  writeMsgBatchProc,
+  readvProc,
+  writevProc,
+  0,
+  sendFileProc,
+  0,
+  readProvidedProc,
+  kqueueWakeup
 };
 
 static void kqueueControl(int kqueueFd, uint16_t flags, int16_t filter, int fd, void *ptr)
@@ -99,7 +109,7 @@ static int getFd(aioObject *object)
 
 asyncBase *kqueueNewAsyncBase()
 {
-  kqueueBase *base = malloc(sizeof(kqueueBase));
+  kqueueBase *base = alignedMalloc(sizeof(kqueueBase), CACHE_LINE_SIZE);
   if (base) {
     base->B.methodImpl = kqueueImpl;
     base->kqueueFd = kqueue();
@@ -121,6 +131,11 @@ void kqueueEnqueue(asyncBase *base, asyncOpRoot *op)
   kqueueControl(localBase->kqueueFd, EV_ENABLE, EVFILT_USER, 1, 0);
 }
 
+void kqueueWakeup(asyncBase *base)
+{
+  kqueueControl(((kqueueBase*)base)->kqueueFd, EV_ENABLE, EVFILT_USER, 1, 0);
+}
+
 void kqueuePostEmptyOperation(asyncBase *base)
 {
   kqueueEnqueue(base, 0);
@@ -137,7 +152,7 @@ void combinerTaskHandler(aioObjectRoot *object, asyncOpRoot *op, AsyncOpActionTy
   int hasWriteOp = object->writeQueue.head != 0;
  
   if ((readEvents | writeEvents) & IO_EVENT_ERROR) {
-    // EV_EOF mapped to TAG_ERROR, cancel all operations with aosDisconnected status
+    // EV_EOF on write filter mapped to IO_EVENT_ERROR, cancel all operations with aosDisconnected status
     int available;
     int fd = getFd((aioObject*)object);
     ioctl(fd, FIONREAD, &available);
@@ -181,26 +196,26 @@ void kqueueNextFinishedOperation(asyncBase *base)
   int nfds, n;
   struct kevent events[MAX_EVENTS];
   kqueueBase *localBase = (kqueueBase *)base;
-  messageLoopThreadId = __sync_fetch_and_add(&base->messageLoopThreadCounter, 1);
+  loopThreadAttach(base);
 
   while (1) {
     do {
       if (!executeGlobalQueue(base)) {
         // Found quit marker
-        unsigned threadsRunning = __uint_atomic_fetch_and_add(&base->messageLoopThreadCounter, 0u-1) - 1;
+        unsigned threadsRunning = loopThreadDetach(base);
         if (threadsRunning)
           kqueueEnqueue(base, 0);
         return;
       }
 
       struct timespec timeout;
-      timeout.tv_sec = 1;
-      timeout.tv_nsec = 0;
+      unsigned waitTime = timeoutQueueWaitTime(base, getMonotonicTimeMs(), 1000);
+      timeout.tv_sec = waitTime / 1000;
+      timeout.tv_nsec = (waitTime % 1000) * 1000000;
+      uint64_t waitBeginNs = getMonotonicTimeNs();
       nfds = kevent(localBase->kqueueFd, 0, 0, events, MAX_EVENTS, &timeout);
-
-      time_t currentTime = time(0);
-      if (currentTime % base->messageLoopThreadCounter == messageLoopThreadId)
-        processTimeoutQueue(base, currentTime);
+      loopWaitStats(base, waitBeginNs, nfds);
+      processTimeoutQueue(base, getMonotonicTimeMs());
     } while (nfds <= 0 && errno == EINTR);
 
     for (n = 0; n < nfds; n++) {
@@ -227,9 +242,10 @@ void kqueueNextFinishedOperation(asyncBase *base)
           opCancel(op, opEncodeTag(op, timerId), aosTimeout);
         }
       } else {
+        // EV_EOF on read filter means peer shutdown of its sending side only, writes still allowed (half-closed connection)
         uint32_t eventMask = (events[n].flags & EV_EOF) ? IO_EVENT_ERROR : 0;
         if (events[n].filter == EVFILT_READ) {
-          ((KQueueObject*)object)->ReadEvents = eventMask | IO_EVENT_READ;
+          ((KQueueObject*)object)->ReadEvents = IO_EVENT_READ;
           combinerPushCounter(object, COMBINER_TAG_ACCESS);
         } else if (events[n].filter == EVFILT_WRITE) {
           ((KQueueObject*)object)->WriteEvents = eventMask | IO_EVENT_WRITE;
@@ -245,6 +261,7 @@ aioObject *kqueueNewAioObject(asyncBase *base, IoObjectTy type, void *data)
 {
   KQueueObject *object = 0;
   if (!concurrentQueuePop(&objectPool, (void**)&object)) {
+    STATS_ADD(base, objectsAllocated, 1);
     object = alignedMalloc(sizeof(KQueueObject), TAGGED_POINTER_ALIGNMENT);
     object->Object.buffer.ptr = 0;
     object->Object.buffer.totalSize = 0;
@@ -301,6 +318,7 @@ void kqueueDeleteObject(aioObject *object)
       break;
   }
   
+  STATS_ADD(object->root.base, objectsReleased, 1);
   concurrentQueuePush(&objectPool, object);
 }
 
@@ -394,7 +412,8 @@ AsyncOpStatus kqueueAsyncAccept(asyncOpRoot *opptr)
     op->host.port = clientAddr.sin_port;
     return aosSuccess;
   } else {
-    return aosUnknownError;
+    // Connection taken by other listener of SO_REUSEPORT group or accept started before readiness
+    return errno == EAGAIN || errno == EWOULDBLOCK ? aosPending : aosUnknownError;
   }
 }
 
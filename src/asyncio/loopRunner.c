@@ -0,0 +1,194 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+// pthread_setaffinity_np, pthread_setname_np
+#define _GNU_SOURCE
+#endif
+#include "asyncio/loopRunner.h"
+#include "macro.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef OS_WINDOWS
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#if defined(OS_LINUX)
+#include <sched.h>
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(OS_FREEBSD)
+#include <pthread_np.h>
+#include <sys/param.h>
+#include <sys/cpuset.h>
+#endif
+
+struct asyncLoopThread {
+  asyncBase *base;
+  // CPU thread pinned to, -1 if not pinned
+  int cpu;
+  char name[16];
+#ifdef OS_WINDOWS
+  HANDLE thread;
+#else
+  pthread_t thread;
+#endif
+};
+
+void asyncCpuSetZero(asyncCpuSet *set)
+{
+  memset(set->bits, 0, sizeof(set->bits));
+}
+
+void asyncCpuSetAdd(asyncCpuSet *set, unsigned cpu)
+{
+  if (cpu < ASYNC_CPU_SET_SIZE)
+    set->bits[cpu / 64] |= (uint64_t)1 << (cpu % 64);
+}
+
+int asyncCpuSetContains(const asyncCpuSet *set, unsigned cpu)
+{
+  return cpu < ASYNC_CPU_SET_SIZE && (set->bits[cpu / 64] & ((uint64_t)1 << (cpu % 64))) != 0;
+}
+
+static void loopThreadPin(int cpu)
+{
+#if defined(OS_WINDOWS)
+  GROUP_AFFINITY affinity;
+  memset(&affinity, 0, sizeof(affinity));
+  affinity.Group = (WORD)(cpu / 64);
+  affinity.Mask = (KAFFINITY)1 << (cpu % 64);
+  SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL);
+#elif defined(OS_LINUX)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  // Allocate memory from node of current CPU even if process was started with other policy (numactl --interleave)
+  syscall(SYS_set_mempolicy, MPOL_LOCAL, NULL, 0);
+#elif defined(OS_FREEBSD)
+  cpuset_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+  // No hard affinity on other systems
+  __UNUSED(cpu);
+#endif
+}
+
+static void loopThreadSetName(const char *name)
+{
+#if defined(OS_LINUX)
+  pthread_setname_np(pthread_self(), name);
+#elif defined(OS_FREEBSD)
+  pthread_set_name_np(pthread_self(), name);
+#elif defined(OS_DARWIN)
+  pthread_setname_np(name);
+#else
+  __UNUSED(name);
+#endif
+}
+
+static void loopThreadRun(asyncLoopThread *thread)
+{
+  // Pin before first allocation: run queue and operation caches of thread are first touched here
+  if (thread->cpu >= 0)
+    loopThreadPin(thread->cpu);
+  if (thread->name[0])
+    loopThreadSetName(thread->name);
+  asyncLoop(thread->base);
+}
+
+#ifdef OS_WINDOWS
+static DWORD WINAPI loopThreadProc(LPVOID arg)
+{
+  loopThreadRun((asyncLoopThread*)arg);
+  return 0;
+}
+#else
+static void *loopThreadProc(void *arg)
+{
+  loopThreadRun((asyncLoopThread*)arg);
+  return 0;
+}
+#endif
+
+static void loopThreadInit(asyncLoopThread *thread, asyncBase *base, int cpu, const char *name)
+{
+  thread->base = base;
+  thread->cpu = cpu;
+  // Thread name limited to 15 characters on Linux
+  if (name)
+    snprintf(thread->name, sizeof(thread->name), "%s", name);
+  else
+    thread->name[0] = 0;
+}
+
+asyncLoopThread *asyncLoopThreadStart(asyncBase *base, int cpu, const char *name)
+{
+  asyncLoopThread *thread = (asyncLoopThread*)malloc(sizeof(asyncLoopThread));
+  loopThreadInit(thread, base, cpu, name);
+#ifdef OS_WINDOWS
+  thread->thread = CreateThread(NULL, 0, loopThreadProc, thread, 0, NULL);
+  if (thread->thread == NULL) {
+#else
+  if (pthread_create(&thread->thread, 0, loopThreadProc, thread) != 0) {
+#endif
+    free(thread);
+    return 0;
+  }
+
+  return thread;
+}
+
+void asyncLoopThreadJoin(asyncLoopThread *thread)
+{
+#ifdef OS_WINDOWS
+  WaitForSingleObject(thread->thread, INFINITE);
+  CloseHandle(thread->thread);
+#else
+  pthread_join(thread->thread, 0);
+#endif
+  free(thread);
+}
+
+void asyncLoopRun(asyncBase *base, unsigned threads, const asyncCpuSet *affinity, const char *name)
+{
+  unsigned i;
+  unsigned started = 0;
+  unsigned cpusNum = 0;
+  int cpus[ASYNC_CPU_SET_SIZE];
+  char threadName[16];
+  asyncLoopThread **loopThreads = (asyncLoopThread**)calloc(threads, sizeof(asyncLoopThread*));
+
+  if (affinity) {
+    for (i = 0; i < ASYNC_CPU_SET_SIZE; i++) {
+      if (asyncCpuSetContains(affinity, i))
+        cpus[cpusNum++] = (int)i;
+    }
+  }
+
+  for (i = 0; i < threads; i++) {
+    if (name)
+      snprintf(threadName, sizeof(threadName), "%s-%u", name, i);
+    loopThreads[i] = asyncLoopThreadStart(base, cpusNum ? cpus[i % cpusNum] : -1, name ? threadName : 0);
+    if (!loopThreads[i])
+      break;
+    started++;
+  }
+
+  // Base must be served even if no thread can be created
+  if (!started && threads) {
+    asyncLoopThread thread;
+    if (name)
+      snprintf(threadName, sizeof(threadName), "%s-0", name);
+    loopThreadInit(&thread, base, cpusNum ? cpus[0] : -1, name ? threadName : 0);
+    loopThreadRun(&thread);
+  }
+
+  for (i = 0; i < started; i++)
+    asyncLoopThreadJoin(loopThreads[i]);
+
+  free(loopThreads);
+}
@@ -0,0 +1,146 @@
+#include "asyncio/relay.h"
+#include "asyncio/device.h"
+#include "asyncio/socket.h"
+#include "asyncioImpl.h"
+#include "atomic.h"
+#include <stdlib.h>
+
+#define RELAY_CHUNK_SIZE 65536
+
+typedef struct relayContext relayContext;
+
+typedef struct relayDirection {
+  relayContext *relay;
+  aioObject *source;
+  aioObject *destination;
+  struct pipeTy pipe;
+  void *buffer;
+  uint64_t bytesTransferred;
+} relayDirection;
+
+struct relayContext {
+  relayDirection directions[2];
+  uint64_t usTimeout;
+  aioRelayCb *callback;
+  void *arg;
+  int useSplice;
+  AsyncOpStatus status;
+  unsigned activeDirections;
+  unsigned failed;
+};
+
+static void relayRead(relayDirection *direction);
+
+static void relayDirectionFinish(relayDirection *direction)
+{
+  relayContext *relay = direction->relay;
+  if (__uint_atomic_fetch_and_add(&relay->activeDirections, (unsigned)-1) != 1)
+    return;
+
+  relay->callback(relay->status,
+                  relay->directions[0].source,
+                  relay->directions[1].source,
+                  relay->directions[0].bytesTransferred,
+                  relay->directions[1].bytesTransferred,
+                  relay->arg);
+
+  unsigned i;
+  for (i = 0; i < 2; i++) {
+    if (relay->useSplice)
+      pipeClose(relay->directions[i].pipe);
+    free(relay->directions[i].buffer);
+  }
+  free(relay);
+}
+
+static void relayFail(relayDirection *direction, AsyncOpStatus status)
+{
+  // First error stops both directions
+  relayContext *relay = direction->relay;
+  if (__uint_atomic_compare_and_swap(&relay->failed, 0, 1)) {
+    relay->status = status;
+    cancelIo(&relay->directions[0].source->root);
+    cancelIo(&relay->directions[1].source->root);
+  }
+
+  relayDirectionFinish(direction);
+}
+
+static void relayEndOfStream(relayDirection *direction)
+{
+  // Half close: peer of destination receives end of stream, other direction continues
+  socketShutdown(aioObjectSocket(direction->destination), SOCKET_SHUTDOWN_WRITE);
+  relayDirectionFinish(direction);
+}
+
+static void relayWriteCb(AsyncOpStatus status, aioObject *object, size_t transferred, void *arg)
+{
+  __UNUSED(object);
+  relayDirection *direction = (relayDirection*)arg;
+  if (status == aosSuccess) {
+    direction->bytesTransferred += transferred;
+    relayRead(direction);
+  } else {
+    relayFail(direction, status);
+  }
+}
+
+static void relayReadCb(AsyncOpStatus status, aioObject *object, size_t transferred, void *arg)
+{
+  __UNUSED(object);
+  relayDirection *direction = (relayDirection*)arg;
+  relayContext *relay = direction->relay;
+  if (status == aosSuccess) {
+    if (relay->useSplice)
+      aioSpliceTo(direction->destination, direction->pipe.read, transferred, afWaitAll, relay->usTimeout, relayWriteCb, direction);
+    else
+      aioWrite(direction->destination, direction->buffer, transferred, afWaitAll | afNoCopy, relay->usTimeout, relayWriteCb, direction);
+  } else if (status == aosDisconnected && !relay->failed) {
+    relayEndOfStream(direction);
+  } else {
+    relayFail(direction, status);
+  }
+}
+
+static void relayRead(relayDirection *direction)
+{
+  relayContext *relay = direction->relay;
+  if (relay->useSplice)
+    aioSpliceFrom(direction->source, direction->pipe.write, RELAY_CHUNK_SIZE, afNone, relay->usTimeout, relayReadCb, direction);
+  else
+    aioRead(direction->source, direction->buffer, RELAY_CHUNK_SIZE, afNone, relay->usTimeout, relayReadCb, direction);
+}
+
+void aioRelay(aioObject *a, aioObject *b, uint64_t usTimeout, aioRelayCb callback, void *arg)
+{
+  unsigned i;
+  relayContext *relay = (relayContext*)calloc(1, sizeof(relayContext));
+  relay->usTimeout = usTimeout;
+  relay->callback = callback;
+  relay->arg = arg;
+  relay->status = aosSuccess;
+  relay->activeDirections = 2;
+  relay->failed = 0;
+  relay->directions[0].source = relay->directions[1].destination = a;
+  relay->directions[1].source = relay->directions[0].destination = b;
+
+  // Splice requires both objects to be sockets served by backend with splice support
+  relay->useSplice = a->root.base->methodImpl.splice && b->root.base->methodImpl.splice &&
+                     a->root.type == ioObjectSocket && b->root.type == ioObjectSocket;
+  if (relay->useSplice) {
+    if (pipeCreate(&relay->directions[0].pipe, 1) != 0) {
+      relay->useSplice = 0;
+    } else if (pipeCreate(&relay->directions[1].pipe, 1) != 0) {
+      pipeClose(relay->directions[0].pipe);
+      relay->useSplice = 0;
+    }
+  }
+
+  for (i = 0; i < 2; i++) {
+    relay->directions[i].relay = relay;
+    relay->directions[i].buffer = relay->useSplice ? 0 : malloc(RELAY_CHUNK_SIZE);
+  }
+
+  relayRead(&relay->directions[0]);
+  relayRead(&relay->directions[1]);
+}
@@ -3,72 +3,183 @@
 // http://www.1024cores.net
 
 #include "asyncio/ringBuffer.h"
+#include "asyncio/asyncioTypes.h"
 #include "atomic.h"
 #include <assert.h>
 #include <stdlib.h>
+#ifndef OS_WINDOWS
+#include <sys/mman.h>
+#endif
 
 #define CONCURRENT_QUEUE_INITIAL_SIZE_LOG2 12
+// Set in enqueuePos of partition left by consumers, producers go to next partition
+#define PARTITION_CLOSED ((size_t)1 << (sizeof(size_t)*8 - 1))
+
+static inline size_t partitionSize(uint32_t index)
+{
+  return (size_t)1 << (index + CONCURRENT_QUEUE_INITIAL_SIZE_LOG2);
+}
+
+static ConcurrentQueueElement *partitionAlloc(size_t size)
+{
+#ifdef OS_WINDOWS
+  return (ConcurrentQueueElement*)malloc(size*sizeof(ConcurrentQueueElement));
+#else
+  void *memory = mmap(0, size*sizeof(ConcurrentQueueElement), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return memory != MAP_FAILED ? (ConcurrentQueueElement*)memory : 0;
+#endif
+}
+
+static void partitionFree(ConcurrentQueueElement *queue, size_t size)
+{
+#ifdef OS_WINDOWS
+  __UNUSED(size);
+  free(queue);
+#else
+  munmap(queue, size*sizeof(ConcurrentQueueElement));
+#endif
+}
 
 static void partitionInit(ConcurrentQueuePartition *buffer, size_t size)
 {
   assert((size & (size-1)) == 0 && "Invalid ring buffer size");
-  if (!buffer->queue) {
-    ConcurrentQueueElement *queue = (ConcurrentQueueElement*)malloc(size*sizeof(ConcurrentQueueElement));
+  if (!__pointer_atomic_load((void *volatile*)&buffer->queue, __ATOMIC_ACQUIRE)) {
+    ConcurrentQueueElement *queue = partitionAlloc(size);
     for (size_t i = 0; i < size; i++)
       queue[i].sequence = i;
     if (!__pointer_atomic_compare_and_swap((void *volatile*)&buffer->queue, 0, queue))
-      free(queue);
+      partitionFree(queue, size);
   }
 }
 
+static void partitionRelease(ConcurrentQueuePartition *buffer, size_t size)
+{
+  // Drained partition can't be unmapped: thread with stale partition index can still read it
+  // Pages returned to system and read as zeroes, zero sequence means "empty" for consumers and "full" for producers
+  // Late consumer still can store sequence of its claimed element here, this value never matches position of closed partition
+#ifdef OS_WINDOWS
+  __UNUSED(buffer);
+  __UNUSED(size);
+#else
+  madvise(buffer->queue, size*sizeof(ConcurrentQueueElement), MADV_DONTNEED);
+#endif
+}
+
 static int partitionPush(ConcurrentQueuePartition *buffer, void *data, size_t mask)
 {
   ConcurrentQueueElement *element = 0;
-  size_t pos = buffer->enqueuePos;
+  // Positions only hand out cells, element data is published by sequence (release) and observed by its acquire load
+  size_t pos = __uintptr_atomic_load(&buffer->enqueuePos, __ATOMIC_RELAXED);
   for (;;) {
+    if (pos & PARTITION_CLOSED)
+      return 0;
     element = &buffer->queue[pos & mask];
-    size_t seq = element->sequence;
+    size_t seq = __uintptr_atomic_load(&element->sequence, __ATOMIC_ACQUIRE);
     intptr_t diff = (intptr_t)seq - (intptr_t)pos;
     if (diff == 0) {
-      if (__uintptr_atomic_compare_and_swap(&buffer->enqueuePos, pos, pos+1))
+      if (__uintptr_atomic_compare_and_swap_explicit(&buffer->enqueuePos, pos, pos+1, __ATOMIC_RELAXED))
         break;
     } else if (diff < 0) {
       // Queue is full
       return 0;
     } else {
-      pos = buffer->enqueuePos;
+      pos = __uintptr_atomic_load(&buffer->enqueuePos, __ATOMIC_RELAXED);
     }
   }
 
   element->data = data;
-  element->sequence = pos + 1;
+  __uintptr_atomic_store(&element->sequence, pos + 1, __ATOMIC_RELEASE);
   return 1;
 }
 
 static int partitionPop(ConcurrentQueuePartition *buffer, void **data, size_t mask)
 {
-  if (!buffer->queue)
+  ConcurrentQueueElement *queue = __pointer_atomic_load((void *volatile*)&buffer->queue, __ATOMIC_ACQUIRE);
+  if (!queue)
     return 0;
 
+  // Data read before claim: after last element claimed, partition can be closed and its pages released,
+  // published element can't be overwritten until some consumer claims it
   ConcurrentQueueElement *element = 0;
-  size_t pos = buffer->dequeuePos;
+  size_t pos = __uintptr_atomic_load(&buffer->dequeuePos, __ATOMIC_RELAXED);
   for (;;) {
-    element = &buffer->queue[pos & mask];
-    size_t seq = element->sequence;
+    element = &queue[pos & mask];
+    size_t seq = __uintptr_atomic_load(&element->sequence, __ATOMIC_ACQUIRE);
     intptr_t diff = (intptr_t)seq - (intptr_t)(pos+1);
     if (diff == 0) {
-      if (__uintptr_atomic_compare_and_swap(&buffer->dequeuePos, pos, pos+1))
+      *data = element->data;
+      if (__uintptr_atomic_compare_and_swap_explicit(&buffer->dequeuePos, pos, pos+1, __ATOMIC_RELAXED))
         break;
     } else if (diff < 0) {
       // Queue is empty
       return 0;
     } else {
-      pos = buffer->dequeuePos;
+      pos = __uintptr_atomic_load(&buffer->dequeuePos, __ATOMIC_RELAXED);
     }
   }
 
-  *data = element->data;
-  element->sequence = pos + (mask+1);
+  __uintptr_atomic_store(&element->sequence, pos + (mask+1), __ATOMIC_RELEASE);
+  return 1;
+}
+
+static size_t partitionPopBatch(ConcurrentQueuePartition *buffer, void **data, size_t count, size_t mask)
+{
+  ConcurrentQueueElement *queue = __pointer_atomic_load((void *volatile*)&buffer->queue, __ATOMIC_ACQUIRE);
+  if (!queue)
+    return 0;
+
+  size_t pos = __uintptr_atomic_load(&buffer->dequeuePos, __ATOMIC_RELAXED);
+  size_t n;
+  for (;;) {
+    // Count ready elements starting from current position and copy them, claim all of them at once
+    n = 0;
+    while (n < count && n <= mask && __uintptr_atomic_load(&queue[(pos+n) & mask].sequence, __ATOMIC_ACQUIRE) == pos + n + 1) {
+      data[n] = queue[(pos+n) & mask].data;
+      n++;
+    }
+
+    if (n) {
+      if (__uintptr_atomic_compare_and_swap_explicit(&buffer->dequeuePos, pos, pos+n, __ATOMIC_RELAXED))
+        break;
+      pos = __uintptr_atomic_load(&buffer->dequeuePos, __ATOMIC_RELAXED);
+    } else {
+      intptr_t diff = (intptr_t)__uintptr_atomic_load(&queue[pos & mask].sequence, __ATOMIC_ACQUIRE) - (intptr_t)(pos+1);
+      if (diff < 0)
+        return 0;
+      pos = __uintptr_atomic_load(&buffer->dequeuePos, __ATOMIC_RELAXED);
+    }
+  }
+
+  for (size_t i = 0; i < n; i++)
+    __uintptr_atomic_store(&queue[(pos+i) & mask].sequence, pos + i + (mask+1), __ATOMIC_RELEASE);
+
+  return n;
+}
+
+static int partitionClose(ConcurrentQueuePartition *buffer)
+{
+  // Returns non-zero if partition closed and all claimed elements were consumed
+  size_t pos = buffer->enqueuePos;
+  while (!(pos & PARTITION_CLOSED)) {
+    if (__uintptr_atomic_compare_and_swap(&buffer->enqueuePos, pos, pos | PARTITION_CLOSED))
+      break;
+    pos = buffer->enqueuePos;
+  }
+
+  return buffer->dequeuePos == (pos & ~PARTITION_CLOSED);
+}
+
+static int nextReadPartition(ConcurrentQueue *queue, uint32_t currentReadPartition)
+{
+  // Consumer leaves partition only when no producer can add element to it,
+  // elements claimed by producers before closing must be consumed first
+  // Returns zero if partition has claimed but not yet published elements
+  ConcurrentQueuePartition *partition = &queue->Partitions[currentReadPartition];
+  if (!partitionClose(partition))
+    return 0;
+
+  if (__uint_atomic_compare_and_swap(&queue->ReadPartition, currentReadPartition, currentReadPartition+1))
+    partitionRelease(partition, partitionSize(currentReadPartition));
   return 1;
 }
 
@@ -77,11 +188,10 @@ void concurrentQueuePush(ConcurrentQueue *queue, void *data)
   for (;;) {
     uint32_t currentWritePartition = queue->WritePartition;
     ConcurrentQueuePartition *partition = &queue->Partitions[currentWritePartition];
-    size_t partitionSize = (size_t)1 << (currentWritePartition + CONCURRENT_QUEUE_INITIAL_SIZE_LOG2);
-    size_t mask = partitionSize-1;
+    size_t size = partitionSize(currentWritePartition);
 
-    partitionInit(partition, partitionSize);
-    if (partitionPush(partition, data, mask))
+    partitionInit(partition, size);
+    if (partitionPush(partition, data, size-1))
       return;
 
     __uint_atomic_compare_and_swap(&queue->WritePartition, currentWritePartition, currentWritePartition+1);
@@ -93,15 +203,48 @@ int concurrentQueuePop(ConcurrentQueue *queue, void **data)
   for (;;) {
     uint32_t currentReadPartition = queue->ReadPartition;
     ConcurrentQueuePartition *partition = &queue->Partitions[currentReadPartition];
-    size_t partitionSize = (size_t)1 << (currentReadPartition + CONCURRENT_QUEUE_INITIAL_SIZE_LOG2);
-    size_t mask = partitionSize-1;
-
+    size_t mask = partitionSize(currentReadPartition)-1;
     if (partitionPop(partition, data, mask))
       return 1;
 
     if (currentReadPartition == queue->WritePartition)
       return 0;
 
-    __uint_atomic_compare_and_swap(&queue->ReadPartition, currentReadPartition, currentReadPartition+1);
+    // Element claimed by slow producer is not waited, it will be observed by next call
+    if (!nextReadPartition(queue, currentReadPartition))
+      return partitionPop(partition, data, mask);
   }
 }
+
+size_t concurrentQueuePopBatch(ConcurrentQueue *queue, void **data, size_t count)
+{
+  for (;;) {
+    uint32_t currentReadPartition = queue->ReadPartition;
+    ConcurrentQueuePartition *partition = &queue->Partitions[currentReadPartition];
+    size_t mask = partitionSize(currentReadPartition)-1;
+    size_t n = partitionPopBatch(partition, data, count, mask);
+    if (n)
+      return n;
+
+    if (currentReadPartition == queue->WritePartition)
+      return 0;
+
+    if (!nextReadPartition(queue, currentReadPartition))
+      return partitionPopBatch(partition, data, count, mask);
+  }
+}
+
+int concurrentQueueEmpty(ConcurrentQueue *queue)
+{
+  uint32_t currentReadPartition = queue->ReadPartition;
+  if (currentReadPartition != queue->WritePartition)
+    return 0;
+
+  ConcurrentQueuePartition *partition = &queue->Partitions[currentReadPartition];
+  if (!partition->queue)
+    return 1;
+
+  size_t mask = partitionSize(currentReadPartition) - 1;
+  size_t pos = partition->dequeuePos;
+  return partition->queue[pos & mask].sequence != pos + 1;
+}
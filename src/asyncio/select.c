@@ -83,7 +83,20 @@ static struct asyncImpl selectImpl = {
   selectAsyncRead,
   selectAsyncWrite,
   selectAsyncReadMsg,
-  selectAsyncWriteMsg
+  selectAsyncWriteMsg,
+  readMsgBatchProc,
+  writeMsgBatchProc,
+  readvProc,
+  writevProc,
+  0,
+  sendFileProc,
+#ifdef OS_LINUX
+  spliceProc,
+#else
+  0,
+#endif
+  readProvidedProc,
+  0
 };
 
 //static aioObject *getObject(selectOp *op)
@@ -152,7 +165,7 @@ static void stopTimer(asyncOpRoot *op)
 asyncBase *selectNewAsyncBase()
 {
 __NO_EXPAND_RECURSIVE_MACRO_BEGIN
-  selectBase *base = malloc(sizeof(selectBase));
+  selectBase *base = alignedMalloc(sizeof(selectBase), CACHE_LINE_SIZE);
   if (base) {
     struct sigaction sAction;
 
@@ -236,10 +249,12 @@ void selectNextFinishedOperation(asyncBase *base)
 
     do {
       tv.tv_sec = 0;
-      tv.tv_usec = 500*1000;      
+      tv.tv_usec = timeoutQueueWaitTime(base, getMonotonicTimeMs(), 500)*1000;
+      uint64_t waitBeginNs = getMonotonicTimeNs();
       result = select(nfds, &readFds, &writeFds, NULL, &tv);
+      loopWaitStats(base, waitBeginNs, result);
       if (result == 0)
-        processTimeoutQueue(base, time(0));
+        processTimeoutQueue(base, getMonotonicTimeMs());
     } while (result <= 0 && errno == EINTR);
 
     if (FD_ISSET(localBase->pipeFd[0], &readFds)) {
@@ -0,0 +1,125 @@
+#include "asyncio/shard.h"
+#include "asyncio/loopRunner.h"
+#include "asyncio/socket.h"
+#include <stdlib.h>
+
+typedef struct asyncShard {
+  asyncBase *base;
+  aioObject *listener;
+  // Null if thread not started
+  asyncLoopThread *thread;
+} asyncShard;
+
+struct asyncShardGroup {
+  unsigned shardsNum;
+  asyncShard *shards;
+};
+
+asyncShardGroup *createShardGroup(AsyncMethod method, unsigned shardsNum)
+{
+  unsigned i;
+  asyncShardGroup *group = (asyncShardGroup*)malloc(sizeof(asyncShardGroup));
+  group->shardsNum = shardsNum;
+  group->shards = (asyncShard*)calloc(shardsNum, sizeof(asyncShard));
+  for (i = 0; i < shardsNum; i++)
+    group->shards[i].base = createAsyncBase(method);
+  return group;
+}
+
+unsigned shardGroupSize(asyncShardGroup *group)
+{
+  return group->shardsNum;
+}
+
+asyncBase *shardGroupBase(asyncShardGroup *group, unsigned index)
+{
+  return group->shards[index].base;
+}
+
+aioObject *shardGroupListener(asyncShardGroup *group, unsigned index)
+{
+  return group->shards[index].listener;
+}
+
+int shardGroupListen(asyncShardGroup *group, const HostAddress *address, aioAcceptCb callback, void *arg)
+{
+  unsigned i;
+  socketTy *sockets = (socketTy*)malloc(sizeof(socketTy) * group->shardsNum);
+  for (i = 0; i < group->shardsNum; i++) {
+    // Without port reuse only one shard can listen, it is not an error for single shard group
+    socketTy hSocket = socketCreate(AF_INET, SOCK_STREAM, IPPROTO_TCP, 1);
+    if (hSocket == INVALID_SOCKET) {
+      unsigned j;
+      for (j = 0; j < i; j++)
+        socketClose(sockets[j]);
+      free(sockets);
+      return -1;
+    }
+
+    sockets[i] = hSocket;
+    socketReuseAddr(hSocket);
+    if ((socketReusePort(hSocket) != 0 && group->shardsNum > 1) ||
+        socketBind(hSocket, address) != 0 ||
+        socketListen(hSocket) != 0) {
+      unsigned j;
+      for (j = 0; j <= i; j++)
+        socketClose(sockets[j]);
+      free(sockets);
+      return -1;
+    }
+  }
+
+  // All sockets bound, listeners can be activated
+  for (i = 0; i < group->shardsNum; i++) {
+    asyncShard *shard = &group->shards[i];
+    shard->listener = newSocketIo(shard->base, sockets[i]);
+    aioAccept(shard->listener, 0, callback, arg);
+  }
+
+  free(sockets);
+  return 0;
+}
+
+void shardGroupStart(asyncShardGroup *group)
+{
+  unsigned i;
+  for (i = 0; i < group->shardsNum; i++)
+    group->shards[i].thread = asyncLoopThreadStart(group->shards[i].base, -1, 0);
+}
+
+void shardGroupStop(asyncShardGroup *group)
+{
+  unsigned i;
+  for (i = 0; i < group->shardsNum; i++)
+    postQuitOperation(group->shards[i].base);
+}
+
+void shardGroupJoin(asyncShardGroup *group)
+{
+  unsigned i;
+  for (i = 0; i < group->shardsNum; i++) {
+    asyncShard *shard = &group->shards[i];
+    if (shard->thread) {
+      asyncLoopThreadJoin(shard->thread);
+      shard->thread = 0;
+    }
+  }
+}
+
+void shardGroupDestroy(asyncShardGroup *group)
+{
+  unsigned i;
+  for (i = 0; i < group->shardsNum; i++) {
+    asyncShard *shard = &group->shards[i];
+    if (shard->listener) {
+      // Cancelled accept operation holds listener until its callback runs, drain base on calling thread
+      deleteAioObject(shard->listener);
+      shard->listener = 0;
+      postQuitOperation(shard->base);
+      asyncLoop(shard->base);
+    }
+  }
+
+  free(group->shards);
+  free(group);
+}
@@ -504,6 +504,7 @@ SMTPClient *smtpClientNew(asyncBase *base, HostAddress localAddress, SmtpServerT
   }
 
   initObjectRoot(&client->root, base, ioObjectUserDefined, smtpClientDestructor);
+  objectSetTraceKind(&client->root, atkSmtp);
   client->TlsSocket = 0;
   client->Type = type;
   client->ptr = client->buffer;
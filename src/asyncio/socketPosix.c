@@ -1,11 +1,24 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+// recvmmsg/sendmmsg, splice
+#define _GNU_SOURCE
+#endif
 #include "asyncio/socket.h"
+#include "macro.h"
+#include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <unistd.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <string.h>
+#ifdef OS_LINUX
+#include <sys/sendfile.h>
+#endif
 
 void initializeSocketSubsystem()
 {
@@ -64,6 +77,21 @@ void socketReuseAddr(socketTy hSocket)
   setsockopt(hSocket, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(int));
 }
 
+int socketReusePort(socketTy hSocket)
+{
+  // FreeBSD balances connections between listeners only with SO_REUSEPORT_LB
+  int optval = 1;
+#if defined(SO_REUSEPORT_LB)
+  return setsockopt(hSocket, SOL_SOCKET, SO_REUSEPORT_LB, &optval, sizeof(int));
+#elif defined(SO_REUSEPORT)
+  return setsockopt(hSocket, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(int));
+#else
+  __UNUSED(hSocket);
+  __UNUSED(optval);
+  return -1;
+#endif
+}
+
 uint32_t addrfromAscii(const char *cp)
 {
   uint32_t res = inet_addr(cp);
@@ -90,6 +118,217 @@ int socketSyncRead(socketTy hSocket, void *buffer, size_t size, int waitAll, siz
   }
 }
 
+#ifdef OS_LINUX
+// Control buffer for UDP_SEGMENT (uint16_t) or UDP_GRO (int) ancillary data
+#define MSG_CONTROL_SIZE CMSG_SPACE(sizeof(int))
+
+typedef union msgControl {
+  char buffer[MSG_CONTROL_SIZE];
+  struct cmsghdr align;
+} msgControl;
+
+static void fillMsgHeaders(struct mmsghdr *headers,
+                           struct iovec *iov,
+                           struct sockaddr_in *addresses,
+                           msgControl *control,
+                           const aioMsg *msgs,
+                           size_t count,
+                           int isWrite)
+{
+  size_t i;
+  memset(headers, 0, sizeof(struct mmsghdr) * count);
+  for (i = 0; i < count; i++) {
+    iov[i].iov_base = msgs[i].buffer;
+    iov[i].iov_len = msgs[i].size;
+    headers[i].msg_hdr.msg_name = &addresses[i];
+    headers[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    headers[i].msg_hdr.msg_iov = &iov[i];
+    headers[i].msg_hdr.msg_iovlen = 1;
+    if (isWrite) {
+      addresses[i].sin_family = msgs[i].address.family;
+      addresses[i].sin_addr.s_addr = msgs[i].address.ipv4;
+      addresses[i].sin_port = msgs[i].address.port;
+      if (msgs[i].segmentSize) {
+        // Kernel splits buffer into datagrams of segmentSize bytes
+        memset(&control[i], 0, sizeof(msgControl));
+        headers[i].msg_hdr.msg_control = control[i].buffer;
+        headers[i].msg_hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&headers[i].msg_hdr);
+        cmsg->cmsg_level = IPPROTO_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        uint16_t segmentSize = (uint16_t)msgs[i].segmentSize;
+        memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(segmentSize));
+      }
+    } else {
+      headers[i].msg_hdr.msg_control = control[i].buffer;
+      headers[i].msg_hdr.msg_controllen = sizeof(msgControl);
+    }
+  }
+}
+
+static size_t groSegmentSize(struct msghdr *header)
+{
+  struct cmsghdr *cmsg;
+  for (cmsg = CMSG_FIRSTHDR(header); cmsg; cmsg = CMSG_NXTHDR(header, cmsg)) {
+    if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO) {
+      int segmentSize;
+      memcpy(&segmentSize, CMSG_DATA(cmsg), sizeof(segmentSize));
+      return (size_t)segmentSize;
+    }
+  }
+
+  return 0;
+}
+#endif
+
+ssize_t socketReadMsgBatch(socketTy hSocket, aioMsg *msgs, size_t count)
+{
+  size_t i;
+  if (count > SOCKET_MSG_BATCH_SIZE)
+    count = SOCKET_MSG_BATCH_SIZE;
+#ifdef OS_LINUX
+  struct mmsghdr headers[SOCKET_MSG_BATCH_SIZE];
+  struct iovec iov[SOCKET_MSG_BATCH_SIZE];
+  struct sockaddr_in addresses[SOCKET_MSG_BATCH_SIZE];
+  msgControl control[SOCKET_MSG_BATCH_SIZE];
+  fillMsgHeaders(headers, iov, addresses, control, msgs, count, 0);
+  int result = recvmmsg(hSocket, headers, (unsigned)count, MSG_DONTWAIT, 0);
+  if (result == 0) {
+    // Nothing received without error (empty batch), caller checks errno
+    errno = EAGAIN;
+    return -1;
+  } else if (result < 0) {
+    return -1;
+  }
+
+  for (i = 0; i < (size_t)result; i++) {
+    msgs[i].address.family = 0;
+    msgs[i].address.ipv4 = addresses[i].sin_addr.s_addr;
+    msgs[i].address.port = addresses[i].sin_port;
+    msgs[i].transferred = headers[i].msg_len;
+    msgs[i].segmentSize = groSegmentSize(&headers[i].msg_hdr);
+  }
+
+  return result;
+#else
+  for (i = 0; i < count; i++) {
+    struct sockaddr_in source;
+    socklen_t addrlen = sizeof(source);
+    ssize_t result = recvfrom(hSocket, msgs[i].buffer, msgs[i].size, MSG_DONTWAIT, (struct sockaddr*)&source, &addrlen);
+    if (result < 0)
+      break;
+    msgs[i].address.family = 0;
+    msgs[i].address.ipv4 = source.sin_addr.s_addr;
+    msgs[i].address.port = source.sin_port;
+    msgs[i].transferred = (size_t)result;
+    msgs[i].segmentSize = 0;
+  }
+
+  if (count == 0)
+    errno = EAGAIN;
+  return i ? (ssize_t)i : -1;
+#endif
+}
+
+ssize_t socketWriteMsgBatch(socketTy hSocket, const aioMsg *msgs, size_t count)
+{
+  size_t i;
+  if (count > SOCKET_MSG_BATCH_SIZE)
+    count = SOCKET_MSG_BATCH_SIZE;
+#ifdef OS_LINUX
+  struct mmsghdr headers[SOCKET_MSG_BATCH_SIZE];
+  struct iovec iov[SOCKET_MSG_BATCH_SIZE];
+  struct sockaddr_in addresses[SOCKET_MSG_BATCH_SIZE];
+  msgControl control[SOCKET_MSG_BATCH_SIZE];
+  __UNUSED(i);
+  fillMsgHeaders(headers, iov, addresses, control, msgs, count, 1);
+  int result = sendmmsg(hSocket, headers, (unsigned)count, MSG_DONTWAIT | MSG_NOSIGNAL);
+  return result > 0 ? result : -1;
+#else
+  for (i = 0; i < count; i++) {
+    // No segmentation offload, split buffer in user space
+    struct sockaddr_in remoteAddress;
+    size_t segmentSize = msgs[i].segmentSize ? msgs[i].segmentSize : msgs[i].size;
+    size_t offset = 0;
+    remoteAddress.sin_family = msgs[i].address.family;
+    remoteAddress.sin_addr.s_addr = msgs[i].address.ipv4;
+    remoteAddress.sin_port = msgs[i].address.port;
+    do {
+      size_t size = msgs[i].size - offset < segmentSize ? msgs[i].size - offset : segmentSize;
+      if (sendto(hSocket, (uint8_t*)msgs[i].buffer + offset, size, MSG_DONTWAIT, (struct sockaddr*)&remoteAddress, sizeof(remoteAddress)) < 0)
+        return i ? (ssize_t)i : -1;
+      offset += size;
+    } while (offset < msgs[i].size);
+  }
+
+  return (ssize_t)i;
+#endif
+}
+
+int socketSetUdpSegmentSize(socketTy hSocket, unsigned segmentSize)
+{
+#if defined(OS_LINUX) && defined(UDP_SEGMENT)
+  int optval = (int)segmentSize;
+  return setsockopt(hSocket, IPPROTO_UDP, UDP_SEGMENT, &optval, sizeof(int));
+#else
+  __UNUSED(hSocket);
+  __UNUSED(segmentSize);
+  return -1;
+#endif
+}
+
+int socketEnableUdpGro(socketTy hSocket, int enable)
+{
+#if defined(OS_LINUX) && defined(UDP_GRO)
+  return setsockopt(hSocket, IPPROTO_UDP, UDP_GRO, &enable, sizeof(int));
+#else
+  __UNUSED(hSocket);
+  __UNUSED(enable);
+  return -1;
+#endif
+}
+
+ssize_t socketSendFile(socketTy hSocket, iodevTy file, uint64_t offset, size_t size)
+{
+#if defined(OS_LINUX)
+  off_t fileOffset = (off_t)offset;
+  return sendfile(hSocket, file, &fileOffset, size);
+#elif defined(OS_FREEBSD)
+  // Partially sent data reported with EAGAIN
+  off_t bytes = 0;
+  int result = sendfile(file, hSocket, (off_t)offset, size, 0, &bytes, 0);
+  return result == 0 || bytes > 0 ? (ssize_t)bytes : -1;
+#elif defined(OS_DARWIN)
+  off_t bytes = (off_t)size;
+  int result = sendfile(file, hSocket, (off_t)offset, &bytes, 0, 0);
+  return result == 0 || bytes > 0 ? (ssize_t)bytes : -1;
+#else
+  __UNUSED(hSocket);
+  __UNUSED(file);
+  __UNUSED(offset);
+  __UNUSED(size);
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+ssize_t socketSplice(socketTy hSocket, iodevTy pipe, size_t size, int toSocket)
+{
+#if defined(OS_LINUX)
+  return toSocket ?
+    splice(pipe, 0, hSocket, 0, size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK) :
+    splice(hSocket, 0, pipe, 0, size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+#else
+  __UNUSED(hSocket);
+  __UNUSED(pipe);
+  __UNUSED(size);
+  __UNUSED(toSocket);
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
 int socketSyncWrite(socketTy hSocket, const void *buffer, size_t size, int waitAll, size_t *bytesTransferred)
 {
 #ifdef OS_LINUX
@@ -114,3 +353,41 @@ int socketSyncWrite(socketTy hSocket, const void *buffer, size_t size, int waitA
     return transferred == size;
   }
 }
+
+int socketSyncWritev(socketTy hSocket, const aioIoVec *iov, size_t iovCount, int waitAll, size_t *bytesTransferred)
+{
+#ifdef OS_LINUX
+  int flags = MSG_NOSIGNAL;
+#else
+  int flags = 0;
+#endif
+  size_t transferred = 0;
+  size_t index = 0;
+  size_t offset = 0;
+  while (index < iovCount) {
+    ssize_t result;
+    if (offset) {
+      // Tail of partially sent element
+      result = send(hSocket, (uint8_t*)iov[index].iov_base + offset, iov[index].iov_len - offset, flags);
+    } else {
+      struct msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = (struct iovec*)(uintptr_t)(iov + index);
+      msg.msg_iovlen = iovCount - index < IOV_MAX ? iovCount - index : IOV_MAX;
+      result = sendmsg(hSocket, &msg, flags);
+    }
+
+    if (result <= 0)
+      break;
+
+    transferred += (size_t)result;
+    offset += (size_t)result;
+    while (index < iovCount && offset >= iov[index].iov_len)
+      offset -= iov[index++].iov_len;
+    if (!waitAll)
+      break;
+  }
+
+  *bytesTransferred = transferred;
+  return waitAll ? index == iovCount : transferred != 0;
+}
@@ -1,4 +1,5 @@
 #include "asyncio/asyncio.h"
+#include "asyncio/bufferPool.h"
 #include "asyncio/coroutine.h"
 #include "asyncio/socket.h"
 #include "asyncio/socketSSL.h"
@@ -83,7 +84,7 @@ static void releaseOp(asyncOpRoot *opptr)
 {
   SSLOp *op = (SSLOp*)opptr;
   if (op->internalBuffer) {
-    free(op->internalBuffer);
+    bufferPoolFree(op->internalBuffer, op->internalBufferSize);
     op->internalBuffer = 0;
     op->internalBufferSize = 0;
   }
@@ -129,14 +130,7 @@ static asyncOpRoot *newWriteAsyncOp(aioObjectRoot *object,
 
   initAsyncOpRoot(&op->root, context->StartProc, cancel, context->FinishProc, releaseOp, object, callback, arg, flags, opCode, usTimeout);
   if (!(flags & afNoCopy) && context->TransactionSize) {
-    if (op->internalBuffer == 0) {
-      op->internalBuffer = malloc(context->TransactionSize);
-      op->internalBufferSize = context->TransactionSize;
-    } else if (op->internalBufferSize < context->TransactionSize) {
-      op->internalBufferSize = context->TransactionSize;
-      op->internalBuffer = realloc(op->internalBuffer, context->TransactionSize);
-    }
-
+    bufferPoolReserve(&op->internalBuffer, &op->internalBufferSize, context->TransactionSize);
     memcpy(op->internalBuffer, context->Buffer, context->TransactionSize);
     op->buffer = op->internalBuffer;
   } else {
@@ -300,6 +294,7 @@ SSLSocket *sslSocketNew(asyncBase *base, aioObject *existingSocket)
   SSL_set_bio(S->ssl, S->bioIn, S->bioOut);
 
   initObjectRoot(&S->root, base, ioObjectUserDefined, sslSocketDestructor);
+  objectSetTraceKind(&S->root, atkSSL);
   S->object = socket;
   return S;
 }
@@ -1,4 +1,5 @@
 #include "asyncio/socket.h"
+#include "macro.h"
 
 void initializeSocketSubsystem()
 {
@@ -52,6 +53,14 @@ void socketReuseAddr(socketTy hSocket)
 }
 
 
+int socketReusePort(socketTy hSocket)
+{
+  // No kernel load balancing between listeners on Windows
+  __UNUSED(hSocket);
+  return -1;
+}
+
+
 uint32_t addrfromAscii(const char *cp)
 {
   uint32_t res = inet_addr(cp);
@@ -88,6 +97,89 @@ int socketSyncRead(socketTy hSocket, void *buffer, size_t size, int waitAll, siz
   }
 }
 
+ssize_t socketReadMsgBatch(socketTy hSocket, aioMsg *msgs, size_t count)
+{
+  // No recvmmsg analogue, socket must be in non-blocking mode
+  size_t i;
+  if (count > SOCKET_MSG_BATCH_SIZE)
+    count = SOCKET_MSG_BATCH_SIZE;
+  for (i = 0; i < count; i++) {
+    struct sockaddr_in source;
+    int addrlen = sizeof(source);
+    int result = recvfrom(hSocket, (char*)msgs[i].buffer, (int)msgs[i].size, 0, (struct sockaddr*)&source, &addrlen);
+    if (result == SOCKET_ERROR)
+      break;
+    msgs[i].address.family = 0;
+    msgs[i].address.ipv4 = source.sin_addr.s_addr;
+    msgs[i].address.port = source.sin_port;
+    msgs[i].transferred = (size_t)result;
+    msgs[i].segmentSize = 0;
+  }
+
+  return i ? (ssize_t)i : -1;
+}
+
+
+ssize_t socketWriteMsgBatch(socketTy hSocket, const aioMsg *msgs, size_t count)
+{
+  size_t i;
+  if (count > SOCKET_MSG_BATCH_SIZE)
+    count = SOCKET_MSG_BATCH_SIZE;
+  for (i = 0; i < count; i++) {
+    // No segmentation offload, split buffer in user space
+    struct sockaddr_in remoteAddress;
+    size_t segmentSize = msgs[i].segmentSize ? msgs[i].segmentSize : msgs[i].size;
+    size_t offset = 0;
+    remoteAddress.sin_family = msgs[i].address.family;
+    remoteAddress.sin_addr.s_addr = msgs[i].address.ipv4;
+    remoteAddress.sin_port = msgs[i].address.port;
+    do {
+      size_t size = msgs[i].size - offset < segmentSize ? msgs[i].size - offset : segmentSize;
+      if (sendto(hSocket, (const char*)msgs[i].buffer + offset, (int)size, 0, (struct sockaddr*)&remoteAddress, sizeof(remoteAddress)) == SOCKET_ERROR)
+        return i ? (ssize_t)i : -1;
+      offset += size;
+    } while (offset < msgs[i].size);
+  }
+
+  return (ssize_t)i;
+}
+
+
+int socketSetUdpSegmentSize(socketTy hSocket, unsigned segmentSize)
+{
+  __UNUSED(hSocket);
+  __UNUSED(segmentSize);
+  return -1;
+}
+
+
+int socketEnableUdpGro(socketTy hSocket, int enable)
+{
+  __UNUSED(hSocket);
+  __UNUSED(enable);
+  return -1;
+}
+
+
+ssize_t socketSendFile(socketTy hSocket, iodevTy file, uint64_t offset, size_t size)
+{
+  __UNUSED(hSocket);
+  __UNUSED(file);
+  __UNUSED(offset);
+  __UNUSED(size);
+  return -1;
+}
+
+ssize_t socketSplice(socketTy hSocket, iodevTy pipe, size_t size, int toSocket)
+{
+  __UNUSED(hSocket);
+  __UNUSED(pipe);
+  __UNUSED(size);
+  __UNUSED(toSocket);
+  return -1;
+}
+
+
 int socketSyncWrite(socketTy hSocket, const void *buffer, size_t size, int waitAll, size_t *bytesTransferred)
 {
   DWORD bytesNum = 0;
@@ -115,3 +207,19 @@ int socketSyncWrite(socketTy hSocket, const void *buffer, size_t size, int waitA
     return transferred == size;
   }
 }
+
+int socketSyncWritev(socketTy hSocket, const aioIoVec *iov, size_t iovCount, int waitAll, size_t *bytesTransferred)
+{
+  size_t i;
+  size_t transferred = 0;
+  for (i = 0; i < iovCount; i++) {
+    size_t bytes = 0;
+    int result = socketSyncWrite(hSocket, iov[i].iov_base, iov[i].iov_len, 1, &bytes);
+    transferred += bytes;
+    if (!result)
+      break;
+  }
+
+  *bytesTransferred = transferred;
+  return waitAll ? i == iovCount : transferred != 0;
+}
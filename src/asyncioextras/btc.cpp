@@ -1,4 +1,5 @@
 #include "asyncioextras/btc.h"
+#include "asyncio/bufferPool.h"
 #include "p2putils/xmstream.h"
 #include <stdlib.h>
 #include <string.h>
@@ -153,7 +154,7 @@ static void releaseProc(asyncOpRoot *opptr)
 {
   btcOp *op = (btcOp*)opptr;
   if (op->internalBuffer) {
-    free(op->internalBuffer);
+    bufferPoolFree(op->internalBuffer, op->internalBufferSize);
     op->internalBuffer = 0;
     op->internalBufferSize = 0;
   }
@@ -202,14 +203,7 @@ static asyncOpRoot *newWriteAsyncOp(aioObjectRoot *object,
   op->state = stInitialize;
 
   if (!(flags & afNoCopy)) {
-    if (op->internalBuffer == nullptr) {
-      op->internalBuffer = malloc(context->TransactionSize);
-      op->internalBufferSize = context->TransactionSize;
-    } else if (op->internalBufferSize < context->TransactionSize) {
-      op->internalBufferSize = context->TransactionSize;
-      op->internalBuffer = realloc(op->internalBuffer, context->TransactionSize);
-    }
-
+    bufferPoolReserve(&op->internalBuffer, &op->internalBufferSize, context->TransactionSize);
     memcpy(op->internalBuffer, context->Buffer, context->TransactionSize);
     op->buffer = op->internalBuffer;
   } else {
@@ -451,6 +445,7 @@ BTCSocket *btcSocketNew(asyncBase *base, aioObject *plainSocket)
   if (!concurrentQueuePop(&objectPool, (void**)&socket))
     socket = static_cast<BTCSocket*>(malloc(sizeof(BTCSocket)));
   initObjectRoot(&socket->root, base, ioObjectUserDefined, btcSocketDestructor);
+  objectSetTraceKind(&socket->root, atkBtc);
 
   socket->plainSocket = plainSocket;
 
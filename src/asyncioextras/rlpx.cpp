@@ -149,6 +149,7 @@ rlpxSocket *rlpxSocketNew(asyncBase *base, aioObject *plainSocket)
     socket = static_cast<rlpxSocket*>(malloc(sizeof(rlpxSocket)));
   }
   initObjectRoot(&socket->root, base, ioObjectUserDefined, rlpxSocketDestructor);
+  objectSetTraceKind(&socket->root, atkRlpx);
   socket->plainSocket = plainSocket;
   return socket;
 }
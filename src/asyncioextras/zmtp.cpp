@@ -713,6 +713,7 @@ zmtpSocket *zmtpSocketNew(asyncBase *base, aioObject *plainSocket, zmtpSocketTy
   }
 
   initObjectRoot(&socket->root, base, ioObjectUserDefined, zmtpSocketDestructor);
+  objectSetTraceKind(&socket->root, atkZmtp);
   socket->plainSocket = plainSocket;
   socket->type = type;
   socket->needSendMore = false;
@@ -1,4 +1,5 @@
 #include "asyncio/asyncio.h"
+#include "asyncio/shard.h"
 #include "asyncio/socket.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -41,8 +42,8 @@ void acceptCb(AsyncOpStatus status, aioObject *listener, HostAddress client, soc
 
 int main(int argc, char **argv)
 {
-  if (argc != 3) {
-    fprintf(stderr, "usage: %s <method> <port>\n", argv[0]);
+  if (argc != 3 && argc != 4) {
+    fprintf(stderr, "usage: %s <method> <port> [threads]\n", argv[0]);
     return 1;
   }
   
@@ -68,6 +69,19 @@ int main(int argc, char **argv)
   address.port = htons(static_cast<uint16_t>(atoi(argv[2])));
   
   initializeSocketSubsystem();
+  if (argc == 4) {
+    // One reactor per thread, kernel distributes connections between SO_REUSEPORT listeners
+    asyncShardGroup *group = createShardGroup(method, static_cast<unsigned>(atoi(argv[3])));
+    if (shardGroupListen(group, &address, acceptCb, nullptr) != 0) {
+      fprintf(stderr, "cannot bind\n");
+      exit(1);
+    }
+
+    shardGroupStart(group);
+    shardGroupJoin(group);
+    return 0;
+  }
+
   socketTy hSocket = socketCreate(AF_INET, SOCK_STREAM, IPPROTO_TCP, 1);
   socketReuseAddr(hSocket);
   if (socketBind(hSocket, &address) != 0) {
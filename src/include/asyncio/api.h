@@ -24,6 +24,8 @@ typedef enum AsyncMethod {
   amEPoll,
   amKQueue,
   amIOCP,
+  amIOUring,
+  amEPollET
 } AsyncMethod;
 
 
@@ -34,6 +36,31 @@ typedef enum IoObjectTy {
   ioObjectUserDefined
 } IoObjectTy;
 
+// Object kinds distinguished by latency histograms, first values match IoObjectTy
+// User defined objects set own kind with objectSetTraceKind
+typedef enum aioTraceKind {
+  atkSocket = 0,
+  atkDevice,
+  atkTimer,
+  atkUserDefined,
+  atkSSL,
+  atkHttp,
+  atkSmtp,
+  atkP2P,
+  atkZmtp,
+  atkRlpx,
+  atkBtc,
+  atkMax
+} aioTraceKind;
+
+// Operation lifecycle points reported to trace hook
+typedef enum aioTracePoint {
+  atpCreated = 0,
+  atpStarted,
+  atpCompleted,
+  atpDispatched
+} aioTracePoint;
+
 
 typedef enum AsyncOpStatus {
   aosUnknown = -1,
@@ -55,7 +82,10 @@ typedef enum AsyncFlags {
   afRealtime = 4,
   afActiveOnce = 8,
   afRunning = 16,
-  afCoroutine = 32
+  afCoroutine = 32,
+  // TCP send without copy to kernel (MSG_ZEROCOPY, epoll only), implies afNoCopy;
+  // operation finished after kernel released buffer, other backends send with copy
+  afZeroCopy = 64
 } AsyncFlags;
 
 typedef enum AsyncOpActionTy {
@@ -106,10 +136,74 @@ typedef void aioReleaseProc(asyncOpRoot*);
 typedef void aioObjectDestructor(aioObjectRoot*);
 typedef void aioObjectDestructorCb(aioObjectRoot*, void*);
 typedef void userEventDestructorCb(aioUserEvent*, void*);
+typedef void aioTraceCb(asyncOpRoot*, aioTracePoint, uint64_t, void*);
 
 extern __tls unsigned currentFinishedSync;
 extern __tls unsigned messageLoopThreadId;
 
+// Snapshot of asyncBase runtime counters, summed over per-thread slots by asyncBaseGetStats
+typedef struct asyncStats {
+  uint64_t opsStarted;
+  uint64_t opsCompletedSync;
+  uint64_t opsCompletedAsync;
+  uint64_t combinerEntries;
+  uint64_t combinerRetries;
+  uint64_t globalQueueDepth;
+  uint64_t waitCalls;
+  uint64_t waitEvents;
+  uint64_t waitTimeNs;
+  uint64_t timeoutsFired;
+  uint64_t opPoolSize;
+  uint64_t objectPoolSize;
+} asyncStats;
+
+// Latency percentiles (ns) of one object kind and operation code, see asyncBaseGetLatency
+// Queueing delay: start of operation after creation plus callback dispatch after completion
+// I/O time: operation waiting for I/O readiness or completion
+typedef struct aioLatencyStats {
+  uint64_t count;
+  uint64_t queueDelayP50;
+  uint64_t queueDelayP99;
+  uint64_t queueDelayP999;
+  uint64_t ioTimeP50;
+  uint64_t ioTimeP99;
+  uint64_t ioTimeP999;
+} aioLatencyStats;
+
+// Runtime counters (asyncBaseGetStats), one slot per loop thread, summed only when read
+// Threads not attached to base as loop thread update shared slot with atomic add: locked instruction
+// and cache line transfer per counter update, operations should be started from loop threads on hot paths
+typedef struct asyncStatsSlot {
+  uint64_t opsAllocated;
+  uint64_t opsTaken;
+  uint64_t opsReleased;
+  uint64_t opsCompletedSync;
+  uint64_t opsCompletedAsync;
+  uint64_t combinerEntries;
+  uint64_t combinerRetries;
+  uint64_t queueEnqueued;
+  uint64_t queueExecuted;
+  uint64_t waitCalls;
+  uint64_t waitEvents;
+  uint64_t waitTimeNs;
+  uint64_t timeoutsFired;
+  uint64_t objectsAllocated;
+  uint64_t objectsCreated;
+  uint64_t objectsReleased;
+} asyncStatsSlot;
+
+extern __tls asyncBase *threadQueueBase;
+extern __tls asyncStatsSlot *threadStats;
+void asyncStatsAddShared(asyncBase *base, size_t offset, uint64_t value);
+
+#define STATS_ADD(base, field, value) \
+  do { \
+    if (threadQueueBase == (base)) \
+      threadStats->field += (value); \
+    else \
+      asyncStatsAddShared((base), offsetof(asyncStatsSlot, field), (value)); \
+  } while (0)
+
 #ifndef __cplusplus
 #define STATIC_CAST(x, y) ((x)(y))
 #define REINTERPRET_CAST(x, y) ((x)(y))
@@ -172,6 +266,7 @@ void eqPushBack(List *list, asyncOpRoot *op);
 typedef struct asyncOpListLink {
   asyncOpRoot *op;
   uintptr_t tag;
+  uint64_t endTime;
   asyncOpListLink *next;
 } asyncOpListLink;
 
@@ -186,11 +281,6 @@ typedef struct ListImpl {
   asyncOpRoot *next;
 } ListImpl;
 
-typedef struct pageMap {
-  asyncOpListLink ***map;
-  unsigned lock;
-} pageMap;
-
 
 struct aioObjectRoot {
   AsyncOpTaggedPtr Head;
@@ -202,6 +292,7 @@ struct aioObjectRoot {
   volatile uint32_t CancelIoFlag;
 
   IoObjectTy type;
+  aioTraceKind traceKind;
   aioObjectDestructor *destructor;
   aioObjectDestructorCb *destructorCb;
   void *destructorCbArg;
@@ -227,10 +318,15 @@ struct asyncOpRoot {
     uint64_t endTime;
   };
   AsyncOpRunningTy running;
+  // Lifecycle times (ns) of traced operation, createdTime is zero when tracing was disabled at initAsyncOpRoot
+  uint64_t createdTime;
+  uint64_t startedTime;
+  uint64_t completedTime;
 };
 
 void initObjectRoot(aioObjectRoot *object, asyncBase *base, IoObjectTy type, aioObjectDestructor destructor);
 void objectSetDestructorCb(aioObjectRoot *object, aioObjectDestructorCb callback, void *arg);
+void objectSetTraceKind(aioObjectRoot *object, aioTraceKind kind);
 void eventSetDestructorCb(aioUserEvent *event, userEventDestructorCb callback, void *arg);
 
 void cancelIo(aioObjectRoot *object);
@@ -258,6 +354,11 @@ typedef asyncOpRoot *SyncImplProc(aioObjectRoot*, AsyncFlags, uint64_t, void*, v
 typedef void MakeResultProc(void*);
 typedef void InitOpProc(asyncOpRoot*, void*);
 
+// Object pool access through per-thread magazine, shared queue used only for refill and spill of half magazine
+// Objects cached by thread are returned to pool when it leaves message loop or exits
+int objectPoolPop(ConcurrentQueue *pool, void **data);
+void objectPoolPush(ConcurrentQueue *pool, void *data);
+
 int asyncOpAlloc(asyncBase *base, size_t size, int isRealTime, ConcurrentQueue *objectPool, ConcurrentQueue *objectTimerPool, asyncOpRoot **result);
 void releaseAsyncOp(asyncOpRoot *op);
 
@@ -321,8 +422,10 @@ static inline asyncOpRoot *combinerAcquire(aioObjectRoot *object,
   AsyncOpTaggedPtr opTagged = taggedAsyncOpStub();
   AsyncOpTaggedPtr allocatedTagged;
   asyncOpRoot *allocated = 0;
+  unsigned attempts = 0;
 
   do {
+    attempts++;
     head = object->Head;
     if (head.data) {
       if (!allocated) {
@@ -335,10 +438,13 @@ static inline asyncOpRoot *combinerAcquire(aioObjectRoot *object,
     } else {
       opTagged = taggedAsyncOpStub();
     }
-  } while (!__uintptr_atomic_compare_and_swap(&object->Head.data, head.data, opTagged.data));
+  } while (!__uintptr_atomic_compare_and_swap_explicit(&object->Head.data, head.data, opTagged.data, __ATOMIC_ACQ_REL));
 
+  if (attempts > 1)
+    STATS_ADD(object->base, combinerRetries, attempts-1);
   if (!head.data) {
     // This thread entered a combiner
+    STATS_ADD(object->base, combinerEntries, 1);
     if (queue->head) {
       // Object has operations in queue
       // Put operation to queue end and try exit combiner
@@ -365,7 +471,9 @@ static inline void combinerPushOperation(asyncOpRoot *op, AsyncOpActionTy action
   AsyncOpTaggedPtr opTagged = taggedAsyncOpMake(op, actionType, 0);
   AsyncOpTaggedPtr newOp;
   AsyncOpTaggedPtr head;
+  unsigned attempts = 0;
   do {
+    attempts++;
     head = object->Head;
     if (head.data) {
       newOp = opTagged;
@@ -373,15 +481,21 @@ static inline void combinerPushOperation(asyncOpRoot *op, AsyncOpActionTy action
     } else {
       newOp = taggedAsyncOpStub();
     }
-  } while (!__uintptr_atomic_compare_and_swap(&object->Head.data, head.data, newOp.data));
+  } while (!__uintptr_atomic_compare_and_swap_explicit(&object->Head.data, head.data, newOp.data, __ATOMIC_ACQ_REL));
 
-  if (!head.data)
+  if (attempts > 1)
+    STATS_ADD(object->base, combinerRetries, attempts-1);
+  if (!head.data) {
+    STATS_ADD(object->base, combinerEntries, 1);
     combiner(object, taggedAsyncOpStub(), opTagged);
+  }
 }
 
 static inline void combinerPushCounter(aioObjectRoot *object, uint32_t tag) {
-  if (__uintptr_atomic_fetch_and_add(&object->Head.data, tag) == 0)
+  if (__uintptr_atomic_fetch_and_add_explicit(&object->Head.data, tag, __ATOMIC_ACQ_REL) == 0) {
+    STATS_ADD(object->base, combinerEntries, 1);
     combiner(object, taggedAsyncOpMake(0, aaNone, tag), taggedAsyncOpMake(0, aaNone, tag));
+  }
 }
 
 static inline void runAioOperation(aioObjectRoot *object,
@@ -402,6 +516,7 @@ static inline void runAioOperation(aioObjectRoot *object,
     asyncOpRoot *op = syncImpl(object, flags, usTimeout, callback, arg, contextPtr);
     if (!op) {
       if (++currentFinishedSync < MAX_SYNCHRONOUS_FINISHED_OPERATION && (callback == 0 || flags & afActiveOnce)) {
+        STATS_ADD(object->base, opsCompletedSync, 1);
         makeResult(contextPtr);
       } else {
         asyncOpRoot *op = createAsyncOp(object, flags, usTimeout, callback, arg, opCode, contextPtr);
@@ -441,6 +556,8 @@ static inline asyncOpRoot *runIoOperation(aioObjectRoot *object,
         initOp(op, contextPtr);
         opForceStatus(op, aosSuccess);
         addToGlobalQueue(op);
+      } else {
+        STATS_ADD(object->base, opsCompletedSync, 1);
       }
     } else if (opGetStatus(op) != aosPending) {
       // Operation finished already
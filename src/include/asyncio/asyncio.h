@@ -11,6 +11,9 @@ typedef void aioConnectCb(AsyncOpStatus, aioObject*, void*);
 typedef void aioAcceptCb(AsyncOpStatus, aioObject*, HostAddress, socketTy, void*);
 typedef void aioCb(AsyncOpStatus, aioObject*, size_t, void*);
 typedef void aioReadMsgCb(AsyncOpStatus, aioObject*, HostAddress, size_t, void*);
+typedef void aioMsgBatchCb(AsyncOpStatus, aioObject*, aioMsg*, size_t, void*);
+typedef void aioReadMappedCb(AsyncOpStatus, aioObject*, aioMappedBuffer*, void*);
+typedef void aioReadProvidedCb(AsyncOpStatus, aioObject*, void*, size_t, void*);
   
 socketTy aioObjectSocket(aioObject *object);
 iodevTy aioObjectDevice(aioObject *object);
@@ -21,8 +24,21 @@ aioObject *newSocketIo(asyncBase *base, socketTy hSocket);
 aioObject *newDeviceIo(asyncBase *base, iodevTy hDevice);
 void deleteAioObject(aioObject *object);
 asyncBase *aioGetBase(aioObject *object);
+// Counters are not synchronized with each other, gauges (queue depth, pool sizes) are approximate
+void asyncBaseGetStats(asyncBase *base, struct asyncStats *stats);
+// Tracing applies to operations created after it was enabled, hook called on thread where lifecycle point reached
+void asyncBaseSetTraceHook(asyncBase *base, aioTraceCb callback, void *arg);
+void asyncBaseEnableLatencyHistograms(asyncBase *base, int enabled);
+// Returns 0 if there are no samples for object kind and operation code
+int asyncBaseGetLatency(asyncBase *base, aioTraceKind kind, int opCode, aioLatencyStats *stats);
 
 void setSocketBuffer(aioObject *socket, size_t bufferSize);
+// Size of buffers used by provided buffer reads (default 16Kb)
+// Can be changed at any time, buffers of old size are freed when returned to pool
+void aioSetProvidedBufferSize(asyncBase *base, size_t size);
+// Write operations queued on object are sent with one writev when it becomes writable
+// Supported by readiness backends (epoll, kqueue, select), ignored by others
+void aioSetWriteCoalescing(aioObject *object, int enabled);
 
 aioUserEvent *newUserEvent(asyncBase* base, int isSemaphore, aioEventCb callback, void* arg);
 void userEventStartTimer(aioUserEvent *event, uint64_t usTimeout, int counter);
@@ -48,6 +64,25 @@ asyncOpRoot *implWrite(aioObject *object,
                        void *arg,
                        size_t *bytesTransferred);
 
+asyncOpRoot *implWritev(aioObject *object,
+                        const aioIoVec *iov,
+                        size_t iovCount,
+                        AsyncFlags flags,
+                        uint64_t usTimeout,
+                        aioCb callback,
+                        void *arg,
+                        size_t *bytesTransferred);
+
+asyncOpRoot *implSendFile(aioObject *object,
+                          iodevTy file,
+                          uint64_t offset,
+                          size_t size,
+                          AsyncFlags flags,
+                          uint64_t usTimeout,
+                          aioCb callback,
+                          void *arg,
+                          size_t *bytesTransferred);
+
 void implReadModify(asyncOpRoot *op, void *buffer, size_t size);
 
 void aioConnect(aioObject *object,
@@ -69,6 +104,76 @@ ssize_t aioRead(aioObject *object,
                 aioCb callback,
                 void *arg);
 
+// Vectored I/O, iov array can be released after call
+// Read buffers are filled in place, write data copied once into internal buffer (not copied with afNoCopy)
+ssize_t aioReadv(aioObject *object,
+                 const aioIoVec *iov,
+                 size_t iovCount,
+                 AsyncFlags flags,
+                 uint64_t usTimeout,
+                 aioCb callback,
+                 void *arg);
+
+ssize_t aioWritev(aioObject *object,
+                  const aioIoVec *iov,
+                  size_t iovCount,
+                  AsyncFlags flags,
+                  uint64_t usTimeout,
+                  aioCb callback,
+                  void *arg);
+
+// Send file region to stream socket by kernel (sendfile), file must stay open until operation finished
+// Backends without sendfile support read data to internal buffer and write it
+ssize_t aioSendFile(aioObject *object,
+                    iodevTy file,
+                    uint64_t offset,
+                    size_t size,
+                    AsyncFlags flags,
+                    uint64_t usTimeout,
+                    aioCb callback,
+                    void *arg);
+
+// Bulk TCP receive without copy (TCP_ZEROCOPY_RECEIVE, epoll only): received pages mapped to caller address space,
+// data that can't be mapped (not page aligned, other backends) copied to tail buffer, segments keep stream order
+// Buffer passed to callback must be released by aioReleaseMapped for any operation status, without callback it is released by library
+void aioReadMapped(aioObject *object,
+                   size_t size,
+                   AsyncFlags flags,
+                   uint64_t usTimeout,
+                   aioReadMappedCb callback,
+                   void *arg);
+void aioReleaseMapped(aioMappedBuffer *buffer);
+
+// Read without caller buffer: when data arrives, buffer taken from pool shared by all objects of base
+// and passed to callback with received data (up to aioSetProvidedBufferSize bytes), pending operation holds no memory
+// Buffer must be returned by aioReleaseProvided, callback gets null buffer if operation failed
+// Without callback received data is discarded and buffer returned to pool
+// Backends without readiness notification (IOCP) take buffer when operation started
+void aioReadProvided(aioObject *object,
+                     AsyncFlags flags,
+                     uint64_t usTimeout,
+                     aioReadProvidedCb callback,
+                     void *arg);
+void aioReleaseProvided(aioObject *object, void *buffer);
+
+// Move data between stream socket and pipe inside kernel (splice), aioSpliceFrom fills pipe from socket,
+// aioSpliceTo drains pipe to socket; operation finished with aosUnknownError if backend has no splice support
+void aioSpliceFrom(aioObject *object,
+                   iodevTy pipe,
+                   size_t size,
+                   AsyncFlags flags,
+                   uint64_t usTimeout,
+                   aioCb callback,
+                   void *arg);
+
+void aioSpliceTo(aioObject *object,
+                 iodevTy pipe,
+                 size_t size,
+                 AsyncFlags flags,
+                 uint64_t usTimeout,
+                 aioCb callback,
+                 void *arg);
+
 ssize_t aioReadMsg(aioObject *object,
                    void *buffer,
                    size_t size,
@@ -94,13 +199,39 @@ ssize_t aioWriteMsg(aioObject *object,
                     aioCb callback,
                     void *arg);
 
+// Receive at least one and up to 'count' datagrams, result is number of filled messages
+// Message array and buffers must be valid until operation finished
+ssize_t aioReadMsgBatch(aioObject *object,
+                        aioMsg *msgs,
+                        size_t count,
+                        AsyncFlags flags,
+                        uint64_t usTimeout,
+                        aioMsgBatchCb callback,
+                        void *arg);
+
+// Send all 'count' datagrams, data is not copied
+// Backend without batch support (IOCP) sends them one by one, callback gets number of datagrams sent
+ssize_t aioWriteMsgBatch(aioObject *object,
+                         aioMsg *msgs,
+                         size_t count,
+                         AsyncFlags flags,
+                         uint64_t usTimeout,
+                         aioMsgBatchCb callback,
+                         void *arg);
 
 int ioConnect(aioObject *object, const HostAddress *address, uint64_t usTimeout);
 socketTy ioAccept(aioObject *object, uint64_t usTimeout);
 ssize_t ioRead(aioObject *object, void *buffer, size_t size, AsyncFlags flags, uint64_t usTimeout);
+ssize_t ioReadv(aioObject *object, const aioIoVec *iov, size_t iovCount, AsyncFlags flags, uint64_t usTimeout);
+ssize_t ioWritev(aioObject *object, const aioIoVec *iov, size_t iovCount, AsyncFlags flags, uint64_t usTimeout);
 ssize_t ioReadMsg(aioObject *object, void *buffer, size_t size, AsyncFlags flags, uint64_t usTimeout);
+ssize_t ioSendFile(aioObject *object, iodevTy file, uint64_t offset, size_t size, AsyncFlags flags, uint64_t usTimeout);
+ssize_t ioReadMapped(aioObject *object, size_t size, AsyncFlags flags, uint64_t usTimeout, aioMappedBuffer *buffer);
+ssize_t ioReadProvided(aioObject *object, AsyncFlags flags, uint64_t usTimeout, void **buffer);
 ssize_t ioWrite(aioObject *object, const void *buffer, size_t size, AsyncFlags flags, uint64_t usTimeout);
 ssize_t ioWriteMsg(aioObject *object, const HostAddress *address, const void *buffer, size_t size, AsyncFlags flags, uint64_t usTimeout);
+ssize_t ioReadMsgBatch(aioObject *object, aioMsg *msgs, size_t count, AsyncFlags flags, uint64_t usTimeout);
+ssize_t ioWriteMsgBatch(aioObject *object, aioMsg *msgs, size_t count, AsyncFlags flags, uint64_t usTimeout);
 void ioSleep(aioUserEvent *event, uint64_t usTimeout);
 void ioWaitUserEvent(aioUserEvent *event);
 
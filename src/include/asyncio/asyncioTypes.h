@@ -2,6 +2,7 @@
 #define __ASYNCTYPES_H_
 
 #include "libp2pconfig.h"
+#include <stddef.h>
 #include <stdint.h>
 
 #if defined(OS_WINDOWS)
@@ -12,6 +13,11 @@
 typedef HANDLE iodevTy;
 typedef SOCKET socketTy;
 typedef int socketLenTy;
+// Scatter/gather element
+typedef struct aioIoVec {
+  void *iov_base;
+  size_t iov_len;
+} aioIoVec;
 #if defined(_MSC_VER)
 #include <BaseTsd.h>
 typedef SSIZE_T ssize_t;
@@ -21,6 +27,9 @@ typedef SSIZE_T ssize_t;
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sched.h>
+#include <sys/uio.h>
+// Scatter/gather element, passed to readv/writev without conversion
+typedef struct iovec aioIoVec;
 typedef int iodevTy;
 typedef int socketTy;
 typedef socklen_t socketLenTy;
@@ -43,4 +52,28 @@ typedef struct HostAddress {
   uint16_t family;
 } HostAddress;
 
+// One datagram of batched receive/send
+// size is buffer capacity, transferred is datagram length after operation
+// segmentSize: send buffer as datagrams of this size (UDP GSO), on receive size of coalesced segments (UDP GRO, 0 if not coalesced)
+typedef struct aioMsg {
+  HostAddress address;
+  void *buffer;
+  size_t size;
+  size_t transferred;
+  size_t segmentSize;
+} aioMsg;
+
+// Received data returned by mapped read (aioReadMapped), must be released by aioReleaseMapped
+// segments: received data in stream order, each one points to pages mapped from socket receive
+// queue (read only) or to tail (data not suitable for mapping, copied); size: total received size
+typedef struct aioMappedBuffer {
+  aioIoVec *segments;
+  size_t segmentsCount;
+  size_t size;
+  void *tail;
+  size_t tailSize;
+  void *mapping;
+  size_t mappingSize;
+} aioMappedBuffer;
+
 #endif //__ASYNCTYPES_H_
@@ -0,0 +1,34 @@
+// Size-class pool for operation internal buffers
+// Capacity rounded up to power of two from BUFFER_POOL_MIN_SIZE to BUFFER_POOL_MAX_SIZE, larger buffers
+// allocated by malloc directly. Each thread keeps few free buffers of every class, excess goes to shared
+// per-class queue limited by BUFFER_POOL_SHARED_LIMIT bytes, buffers over limit released to system allocator
+
+#ifndef __ASYNCIO_BUFFERPOOL_H_
+#define __ASYNCIO_BUFFERPOOL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#define BUFFER_POOL_MIN_SIZE_LOG2 6
+#define BUFFER_POOL_MAX_SIZE_LOG2 20
+#define BUFFER_POOL_MIN_SIZE ((size_t)1 << BUFFER_POOL_MIN_SIZE_LOG2)
+#define BUFFER_POOL_MAX_SIZE ((size_t)1 << BUFFER_POOL_MAX_SIZE_LOG2)
+#define BUFFER_POOL_SHARED_LIMIT ((size_t)16 << 20)
+
+// Returns buffer with at least size bytes, real capacity stored to *capacity and must be passed to bufferPoolFree
+void *bufferPoolAlloc(size_t size, size_t *capacity);
+void bufferPoolFree(void *buffer, size_t capacity);
+// Replaces *buffer with pooled buffer of at least size bytes if current capacity is not enough
+// Buffer content is not preserved
+void *bufferPoolReserve(void **buffer, size_t *capacity, size_t size);
+// Moves buffers cached by calling thread to shared pool, called by message loop thread before leaving loop
+void bufferPoolFlushThreadCache();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__ASYNCIO_BUFFERPOOL_H_
@@ -29,6 +29,9 @@ void pipeClose(struct pipeTy pipePtr);
 
 int deviceSyncRead(iodevTy hDevice, void *buffer, size_t size, int waitAll, size_t *bytesTransferred);
 int deviceSyncWrite(iodevTy hDevice, const void *buffer, size_t size, int waitAll, size_t *bytesTransferred);
+int deviceSyncWritev(iodevTy hDevice, const aioIoVec *iov, size_t iovCount, int waitAll, size_t *bytesTransferred);
+// Positioned read (regular files), current file position not changed
+int deviceSyncReadAt(iodevTy hDevice, void *buffer, size_t size, uint64_t offset, size_t *bytesTransferred);
 
 #ifdef __cplusplus
 }
@@ -41,7 +41,7 @@ typedef struct HTTPOp {
   HostAddress address;
   httpParseCb *parseCallback;
   void *parseArg;
-  uint8_t *internalBuffer;
+  void *internalBuffer;
   size_t internalBufferSize;
   size_t dataSize;
 } HTTPOp;
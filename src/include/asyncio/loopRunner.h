@@ -0,0 +1,37 @@
+#ifndef __ASYNCIO_LOOPRUNNER_H_
+#define __ASYNCIO_LOOPRUNNER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "asyncio/asyncio.h"
+
+// Set of CPUs for loop threads, same capacity as Linux cpu_set_t
+#define ASYNC_CPU_SET_SIZE 1024
+
+typedef struct asyncCpuSet {
+  uint64_t bits[ASYNC_CPU_SET_SIZE / 64];
+} asyncCpuSet;
+
+void asyncCpuSetZero(asyncCpuSet *set);
+void asyncCpuSetAdd(asyncCpuSet *set, unsigned cpu);
+int asyncCpuSetContains(const asyncCpuSet *set, unsigned cpu);
+
+// Thread running asyncLoop of base, pinned to cpu if it is not negative, named if name is not null
+// Returns null if thread can't be created, join waits for thread exit and releases handle
+typedef struct asyncLoopThread asyncLoopThread;
+asyncLoopThread *asyncLoopThreadStart(asyncBase *base, int cpu, const char *name);
+void asyncLoopThreadJoin(asyncLoopThread *thread);
+
+// Runs asyncLoop of base in given number of threads, returns after all of them exit (postQuitOperation)
+// Thread i is pinned to i-th CPU of affinity set (round robin if there are more threads than CPUs),
+// null affinity leaves threads unpinned. Threads named "<name>-<i>" if name is not null
+// Pinned thread allocates own run queue and operation caches, they are placed on its NUMA node
+void asyncLoopRun(asyncBase *base, unsigned threads, const asyncCpuSet *affinity, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__ASYNCIO_LOOPRUNNER_H_
@@ -0,0 +1,25 @@
+#ifndef __ASYNCIO_RELAY_H_
+#define __ASYNCIO_RELAY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "asyncio/asyncio.h"
+
+// Bidirectional stream relay (TCP proxy, port forwarding)
+// Data moved through pipe by splice without copy to user space (epoll, select and io_uring on Linux),
+// other backends use read/write through relay buffer
+// End of stream on one side forwarded to other side as write shutdown, relay finished when both directions
+// reached end of stream or after first error (all pending operations on both objects canceled)
+// Objects are not deleted by relay, callback called once
+typedef void aioRelayCb(AsyncOpStatus status, aioObject *a, aioObject *b, uint64_t bytesAtoB, uint64_t bytesBtoA, void *arg);
+
+// usTimeout is idle timeout for each direction, 0 means no timeout
+void aioRelay(aioObject *a, aioObject *b, uint64_t usTimeout, aioRelayCb callback, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__ASYNCIO_RELAY_H_
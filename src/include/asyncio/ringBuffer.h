@@ -8,25 +8,41 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#define CONCURRENT_QUEUE_CACHE_LINE_SIZE 64
+// Partition sizes grow from 2^12 to 2^43 elements, partition indices only increase
+// Pages of partitions left by consumers are returned to system, current partitions keep their size
+// after queue drained: resident memory is bounded by size of largest partition in use, not by queue depth
+#define CONCURRENT_QUEUE_PARTITIONS_NUM 32
+
 typedef struct ConcurrentQueueElement {
   void *data;
   volatile size_t sequence;
 } ConcurrentQueueElement;
 
+// Producer and consumer positions placed to separate cache lines
 typedef struct ConcurrentQueuePartition {
-  ConcurrentQueueElement *queue;
+  ConcurrentQueueElement *volatile queue;
+  uint8_t queuePadding[CONCURRENT_QUEUE_CACHE_LINE_SIZE - sizeof(void*)];
   volatile size_t enqueuePos;
+  uint8_t enqueuePadding[CONCURRENT_QUEUE_CACHE_LINE_SIZE - sizeof(size_t)];
   volatile size_t dequeuePos;
+  uint8_t dequeuePadding[CONCURRENT_QUEUE_CACHE_LINE_SIZE - sizeof(size_t)];
 } ConcurrentQueuePartition;
 
 typedef struct ConcurrentQueue {
-  ConcurrentQueuePartition Partitions[64];
+  ConcurrentQueuePartition Partitions[CONCURRENT_QUEUE_PARTITIONS_NUM];
   volatile uint32_t ReadPartition;
+  uint8_t ReadPadding[CONCURRENT_QUEUE_CACHE_LINE_SIZE - sizeof(uint32_t)];
   volatile uint32_t WritePartition;
+  uint8_t WritePadding[CONCURRENT_QUEUE_CACHE_LINE_SIZE - sizeof(uint32_t)];
 } ConcurrentQueue;
 
 // Concurrent ring buffer API
 void concurrentQueuePush(ConcurrentQueue *queue, void *data);
 int concurrentQueuePop(ConcurrentQueue *queue, void **data);
+// Pops up to count elements with one atomic operation, returns number of popped elements
+size_t concurrentQueuePopBatch(ConcurrentQueue *queue, void **data, size_t count);
+// Snapshot check, push running concurrently with this call can be not observed
+int concurrentQueueEmpty(ConcurrentQueue *queue);
 
 #endif //__ASYNCIO_RINGBUFFER_H_
@@ -0,0 +1,35 @@
+#ifndef __ASYNCIO_SHARD_H_
+#define __ASYNCIO_SHARD_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "asyncio/asyncio.h"
+
+// Group of independent reactors, each one served by own thread
+// Listeners bound with SO_REUSEPORT let kernel spread incoming connections between shards,
+// accepted sockets stay on reactor of listener which accepted them
+typedef struct asyncShardGroup asyncShardGroup;
+
+asyncShardGroup *createShardGroup(AsyncMethod method, unsigned shardsNum);
+unsigned shardGroupSize(asyncShardGroup *group);
+asyncBase *shardGroupBase(asyncShardGroup *group, unsigned index);
+aioObject *shardGroupListener(asyncShardGroup *group, unsigned index);
+
+// Creates listening socket for each shard and starts aioAccept on it
+// Callback must call aioAccept(listener, ...) again to continue accepting
+int shardGroupListen(asyncShardGroup *group, const HostAddress *address, aioAcceptCb callback, void *arg);
+
+void shardGroupStart(asyncShardGroup *group);
+void shardGroupStop(asyncShardGroup *group);
+void shardGroupJoin(asyncShardGroup *group);
+// Group must be stopped and joined, accept callbacks get aosCanceled on calling thread and must not restart accept
+// Bases of shards are not released (asyncBase has no destructor)
+void shardGroupDestroy(asyncShardGroup *group);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__ASYNCIO_SHARD_H_
@@ -26,9 +26,30 @@ int socketBind(socketTy hSocket, const HostAddress *address);
 int socketListen(socketTy hSocket);
 int socketShutdown(socketTy hSocket, int how);
 void socketReuseAddr(socketTy hSocket);
+int socketReusePort(socketTy hSocket);
 
 int socketSyncRead(socketTy hSocket, void *buffer, size_t size, int waitAll, size_t *bytesTransferred);
 int socketSyncWrite(socketTy hSocket, const void *buffer, size_t size, int waitAll, size_t *bytesTransferred);
+int socketSyncWritev(socketTy hSocket, const aioIoVec *iov, size_t iovCount, int waitAll, size_t *bytesTransferred);
+
+// Non-blocking receive/send of up to SOCKET_MSG_BATCH_SIZE datagrams (recvmmsg/sendmmsg where available)
+// Returns number of processed messages or -1 if nothing was processed (errno is EAGAIN if there was no error)
+#define SOCKET_MSG_BATCH_SIZE 64
+ssize_t socketReadMsgBatch(socketTy hSocket, aioMsg *msgs, size_t count);
+ssize_t socketWriteMsgBatch(socketTy hSocket, const aioMsg *msgs, size_t count);
+
+// UDP segmentation offload (Linux only, returns -1 if not supported)
+// With segment size set every aioWriteMsg buffer larger than segment sent as multiple datagrams
+// With GRO enabled received buffer can contain several datagrams, use aioReadMsgBatch to get segment size
+int socketSetUdpSegmentSize(socketTy hSocket, unsigned segmentSize);
+int socketEnableUdpGro(socketTy hSocket, int enable);
+
+// Non-blocking transfer of file region to stream socket by kernel (sendfile)
+// Returns number of sent bytes (0 at end of file) or -1, not supported on Windows
+ssize_t socketSendFile(socketTy hSocket, iodevTy file, uint64_t offset, size_t size);
+// Non-blocking move of data between stream socket and pipe by kernel (splice), Linux only
+// Returns number of moved bytes (0 if socket closed by peer) or -1
+ssize_t socketSplice(socketTy hSocket, iodevTy pipe, size_t size, int toSocket);
 
 #ifdef __cplusplus
 }
@@ -3,8 +3,46 @@
 
 #include "asyncio/asyncioTypes.h"
 #include "macro.h"
+#if defined(OS_LINUX)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(OS_FREEBSD)
+#include <sys/types.h>
+#include <sys/umtx.h>
+#endif
+
+// Spinlock tuning: number of lock word checks before parking and upper bound of backoff in cpu relax hints
+#define SPINLOCK_SPIN_LIMIT 64
+#define SPINLOCK_BACKOFF_MAX 64
+
+// Memory orders for *_explicit functions, same meaning as C11 memory_order_*
+// GCC and clang define them as builtin macros, Microsoft compiler always uses full barrier
+#ifdef _MSC_VER
+#ifndef __ATOMIC_RELAXED
+#define __ATOMIC_RELAXED 0
+#define __ATOMIC_CONSUME 1
+#define __ATOMIC_ACQUIRE 2
+#define __ATOMIC_RELEASE 3
+#define __ATOMIC_ACQ_REL 4
+#define __ATOMIC_SEQ_CST 5
+#endif
+#if defined(_M_ARM) || defined(_M_ARM64)
+#define __ATOMIC_MSVC_FENCE() MemoryBarrier()
+#else
+#define __ATOMIC_MSVC_FENCE() _ReadWriteBarrier()
+#endif
+#endif
 
 __NO_UNUSED_FUNCTION_BEGIN
+// Strongest failure order allowed for compare and swap with given success order
+static inline int __atomic_failure_order(int order)
+{
+  return order == __ATOMIC_SEQ_CST ? __ATOMIC_SEQ_CST :
+         (order == __ATOMIC_ACQUIRE || order == __ATOMIC_ACQ_REL) ? __ATOMIC_ACQUIRE :
+         __ATOMIC_RELAXED;
+}
+
 static inline unsigned __uint_atomic_fetch_and_add(unsigned volatile *ptr, unsigned value)
 {
 #ifndef _MSC_VER // Not Microsoft compiler
@@ -14,6 +52,15 @@ static inline unsigned __uint_atomic_fetch_and_add(unsigned volatile *ptr, unsig
 #endif
 }
 
+static inline uint64_t __uint64_atomic_fetch_and_add(uint64_t volatile *ptr, uint64_t value)
+{
+#ifndef _MSC_VER // Not Microsoft compiler
+  return __atomic_fetch_add(ptr, value, __ATOMIC_RELAXED);
+#else
+  return InterlockedExchangeAdd64((volatile LONG64*)ptr, value);
+#endif
+}
+
 static inline int __uint_atomic_compare_and_swap(unsigned volatile *ptr, unsigned v1, unsigned v2)
 {
 #ifndef _MSC_VER // Not Microsoft compiler
@@ -36,6 +83,24 @@ static inline uintptr_t __uintptr_atomic_fetch_and_add(uintptr_t volatile *ptr,
 #endif
 }
 
+static inline unsigned __uint_atomic_fetch_and_or(unsigned volatile *ptr, unsigned value)
+{
+#ifndef _MSC_VER // Not Microsoft compiler
+  return __sync_fetch_and_or(ptr, value);
+#else
+  return InterlockedOr((volatile LONG*)ptr, value);
+#endif
+}
+
+static inline unsigned __uint_atomic_exchange(unsigned volatile *ptr, unsigned value)
+{
+#ifndef _MSC_VER // Not Microsoft compiler
+  return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+#else
+  return InterlockedExchange((volatile LONG*)ptr, value);
+#endif
+}
+
 static inline int __uintptr_atomic_compare_and_swap(uintptr_t volatile *ptr, uintptr_t v1, uintptr_t v2)
 {
 #ifndef _MSC_VER // Not Microsoft compiler
@@ -67,30 +132,191 @@ static inline void *__pointer_atomic_exchange(void *volatile *pointer, void *v1)
 #endif
 }
 
-static inline void __spinlock_acquire(unsigned *lock)
+static inline unsigned __uint_atomic_load(unsigned volatile *ptr, int order)
 {
-  for (;;) {
-    int i;
-    for (i = 0; i < 7777; i++) {
-      if (__uint_atomic_compare_and_swap(lock, 0, 1))
-        return;
-    }
-#ifdef OS_WINDOWS
-    SwitchToThread();
+#ifndef _MSC_VER
+  return __atomic_load_n(ptr, order);
 #else
-    sched_yield();
+  unsigned value = *ptr;
+  __UNUSED(order);
+  __ATOMIC_MSVC_FENCE();
+  return value;
 #endif
+}
+
+static inline void __uint_atomic_store(unsigned volatile *ptr, unsigned value, int order)
+{
+#ifndef _MSC_VER
+  __atomic_store_n(ptr, value, order);
+#else
+  if (order == __ATOMIC_SEQ_CST) {
+    InterlockedExchange((volatile LONG*)ptr, value);
+  } else {
+    __ATOMIC_MSVC_FENCE();
+    *ptr = value;
   }
+#endif
+}
+
+static inline uintptr_t __uintptr_atomic_load(uintptr_t volatile *ptr, int order)
+{
+#ifndef _MSC_VER
+  return __atomic_load_n(ptr, order);
+#else
+  uintptr_t value = *ptr;
+  __UNUSED(order);
+  __ATOMIC_MSVC_FENCE();
+  return value;
+#endif
+}
+
+static inline void __uintptr_atomic_store(uintptr_t volatile *ptr, uintptr_t value, int order)
+{
+#ifndef _MSC_VER
+  __atomic_store_n(ptr, value, order);
+#else
+  if (order == __ATOMIC_SEQ_CST) {
+    InterlockedExchangePointer((void *volatile*)ptr, (void*)value);
+  } else {
+    __ATOMIC_MSVC_FENCE();
+    *ptr = value;
+  }
+#endif
+}
+
+static inline void *__pointer_atomic_load(void *volatile *ptr, int order)
+{
+#ifndef _MSC_VER
+  return __atomic_load_n(ptr, order);
+#else
+  void *value = *ptr;
+  __UNUSED(order);
+  __ATOMIC_MSVC_FENCE();
+  return value;
+#endif
+}
+
+static inline uintptr_t __uintptr_atomic_fetch_and_add_explicit(uintptr_t volatile *ptr, uintptr_t value, int order)
+{
+#ifndef _MSC_VER
+  return __atomic_fetch_add(ptr, value, order);
+#else
+  __UNUSED(order);
+  return __uintptr_atomic_fetch_and_add(ptr, value);
+#endif
+}
+
+static inline int __uint_atomic_compare_and_swap_explicit(unsigned volatile *ptr, unsigned v1, unsigned v2, int order)
+{
+#ifndef _MSC_VER
+  return __atomic_compare_exchange_n(ptr, &v1, v2, 0, order, __atomic_failure_order(order));
+#else
+  __UNUSED(order);
+  return __uint_atomic_compare_and_swap(ptr, v1, v2);
+#endif
+}
+
+static inline int __uintptr_atomic_compare_and_swap_explicit(uintptr_t volatile *ptr, uintptr_t v1, uintptr_t v2, int order)
+{
+#ifndef _MSC_VER
+  return __atomic_compare_exchange_n(ptr, &v1, v2, 0, order, __atomic_failure_order(order));
+#else
+  __UNUSED(order);
+  return __uintptr_atomic_compare_and_swap(ptr, v1, v2);
+#endif
+}
+
+static inline unsigned __uint_atomic_exchange_explicit(unsigned volatile *ptr, unsigned value, int order)
+{
+#ifndef _MSC_VER
+  return __atomic_exchange_n(ptr, value, order);
+#else
+  __UNUSED(order);
+  return InterlockedExchange((volatile LONG*)ptr, value);
+#endif
+}
+
+// Hint for processor that current thread is spinning (pause on x86, yield on ARM)
+static inline void __cpu_relax(void)
+{
+#if defined(_MSC_VER)
+  YieldProcessor();
+#elif defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  __asm__ __volatile__("yield" ::: "memory");
+#else
+  __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+// Sleep while *address equals value, spurious wakeups are allowed
+static inline void __address_wait(volatile unsigned *address, unsigned value)
+{
+#if defined(OS_WINDOWS)
+  WaitOnAddress(address, &value, sizeof(value), INFINITE);
+#elif defined(OS_LINUX)
+  syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, value, 0, 0, 0);
+#elif defined(OS_FREEBSD)
+  _umtx_op((void*)address, UMTX_OP_WAIT_UINT_PRIVATE, value, 0, 0);
+#else
+  __UNUSED(address);
+  __UNUSED(value);
+  sched_yield();
+#endif
+}
+
+static inline void __address_wake_one(volatile unsigned *address)
+{
+#if defined(OS_WINDOWS)
+  WakeByAddressSingle((PVOID)address);
+#elif defined(OS_LINUX)
+  syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, 1, 0, 0, 0);
+#elif defined(OS_FREEBSD)
+  _umtx_op((void*)address, UMTX_OP_WAKE_PRIVATE, 1, 0, 0);
+#else
+  __UNUSED(address);
+#endif
+}
+
+// Lock word: 0 - free, 1 - locked, 2 - locked and waiters may sleep in kernel
+// Spins with exponential backoff first, then parks on futex; release wakes one sleeper only if lock word was 2
+static inline void __spinlock_acquire(volatile unsigned *lock)
+{
+  unsigned backoff = 1;
+  int i;
+  if (__uint_atomic_compare_and_swap_explicit(lock, 0, 1, __ATOMIC_ACQUIRE))
+    return;
+
+  for (i = 0; i < SPINLOCK_SPIN_LIMIT; i++) {
+    unsigned j;
+    for (j = 0; j < backoff; j++)
+      __cpu_relax();
+    if (backoff < SPINLOCK_BACKOFF_MAX)
+      backoff <<= 1;
+
+    // Spin on plain load, don't take cache line exclusively until lock looks free
+    unsigned state = __uint_atomic_load(lock, __ATOMIC_RELAXED);
+    if (state == 0 && __uint_atomic_compare_and_swap_explicit(lock, 0, 1, __ATOMIC_ACQUIRE))
+      return;
+    if (state == 2)
+      break;
+  }
+
+  // Lock acquired here stays in state 2: other sleepers can exist, release must wake them
+  while (__uint_atomic_exchange_explicit(lock, 2, __ATOMIC_ACQUIRE) != 0)
+    __address_wait(lock, 2);
 }
 
 static inline int __spinlock_try_acquire(volatile unsigned *lock)
 {
-  return __uint_atomic_compare_and_swap(lock, 0, 1) ? 1 : 0;
+  return __uint_atomic_compare_and_swap_explicit(lock, 0, 1, __ATOMIC_ACQUIRE) ? 1 : 0;
 }
 
 static inline void __spinlock_release(volatile unsigned *lock)
 {
-  *lock = 0;
+  if (__uint_atomic_exchange_explicit(lock, 0, __ATOMIC_RELEASE) == 2)
+    __address_wake_one(lock);
 }
 
 __NO_UNUSED_FUNCTION_END
@@ -170,6 +170,7 @@ p2pConnection *p2pConnectionNew(aioObject *socket)
   }
 
   initObjectRoot(&connection->root, aioGetBase(socket), ioObjectUserDefined, destructor);
+  objectSetTraceKind(&connection->root, atkP2P);
   connection->socket = socket;
   setSocketBuffer(socket, 256);
   return connection;
@@ -512,19 +513,15 @@ static AsyncOpStatus sendProc(asyncOpRoot *opptr)
           memcpy(sendBuffer+sizeof(p2pHeader), op->buffer, op->header.size);
           childOp = implWrite(connection->socket, sendBuffer, sizeof(p2pHeader)+op->header.size, afWaitAll, 0, resumeRwCb, opptr, &bytes);
         } else {
-          op->rwState = stTransferring;
-          childOp = implWrite(connection->socket, &op->header, sizeof(p2pHeader), afWaitAll, 0, resumeRwCb, opptr, &bytes);
+          // Header and body in one gathered write
+          aioIoVec iov[2] = {{&op->header, sizeof(p2pHeader)}, {op->buffer, op->header.size}};
+          op->rwState = stFinished;
+          childOp = implWritev(connection->socket, iov, 2, afWaitAll, 0, resumeRwCb, opptr, &bytes);
         }
 
         break;
       }
 
-      case stTransferring : {
-        op->rwState = stFinished;
-        childOp = implWrite(connection->socket, op->buffer, op->header.size, afWaitAll, 0, resumeRwCb, opptr, &bytes);
-        break;
-      }
-
       case stFinished :
         return aosSuccess;
 
@@ -550,12 +547,9 @@ asyncOpRoot *implp2pSend(p2pConnection *connection, const void *data, p2pHeader
     memcpy(sendBuffer+sizeof(p2pHeader), data, header.size);
     childOp = implWrite(connection->socket, sendBuffer, sizeof(p2pHeader)+header.size, afWaitAll, 0, resumeRwCb, nullptr, &bytes);
   } else {
-    state = stTransferring;
-    childOp = implWrite(connection->socket, &header, sizeof(p2pHeader), afWaitAll, 0, resumeRwCb, nullptr, &bytes);
-    if (!childOp) {
-      state = stFinished;
-      childOp = implWrite(connection->socket, data, header.size, afWaitAll, 0, resumeRwCb, nullptr, &bytes);
-    }
+    aioIoVec iov[2] = {{&header, sizeof(p2pHeader)}, {const_cast<void*>(data), header.size}};
+    state = stFinished;
+    childOp = implWritev(connection->socket, iov, 2, afWaitAll, 0, resumeRwCb, nullptr, &bytes);
   }
 
   if (childOp) {
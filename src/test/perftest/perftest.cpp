@@ -0,0 +1,392 @@
+// Multi-thread benchmarks of asyncio synchronization primitives
+// Usage: perftest [pool|queue|atomic|lock]
+
+#include "asyncio/asyncio.h"
+#include "asyncio/api.h"
+#include "asyncio/ringBuffer.h"
+#include "atomic.h"
+#include <chrono>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+static const unsigned gThreadsNum[] = {1, 2, 4, 8};
+
+template<typename Proc>
+static double runThreads(unsigned threadsNum, Proc proc)
+{
+  std::vector<std::thread> threads;
+  auto begin = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < threadsNum; i++)
+    threads.emplace_back(proc, i);
+  for (auto &thread: threads)
+    thread.join();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// ======================================================================
+// =                                                                    =
+// =                         Object pools                               =
+// =                                                                    =
+// ======================================================================
+
+static const unsigned gPoolIterations = 2000000;
+// Objects held by thread at once, like operations in flight
+static const unsigned gPoolBurstSize = 16;
+
+static void *poolAlloc(ConcurrentQueue *pool, bool magazine)
+{
+  void *object;
+  int result = magazine ? objectPoolPop(pool, &object) : concurrentQueuePop(pool, &object);
+  return result ? object : malloc(64);
+}
+
+static void poolFree(ConcurrentQueue *pool, void *object, bool magazine)
+{
+  if (magazine)
+    objectPoolPush(pool, object);
+  else
+    concurrentQueuePush(pool, object);
+}
+
+// Adjacent pools, like operation pools of asyncBase used at once
+static const unsigned gPoolsNum = 4;
+
+static void test_pool(unsigned threadsNum, bool magazine, unsigned poolsNum)
+{
+  static ConcurrentQueue pools[2][gPoolsNum];
+  ConcurrentQueue *pool = pools[magazine ? 1 : 0];
+  double seconds = runThreads(threadsNum, [pool, magazine, poolsNum](unsigned) {
+    void *objects[gPoolBurstSize];
+    for (unsigned i = 0; i < gPoolIterations / gPoolBurstSize; i++) {
+      for (unsigned j = 0; j < gPoolBurstSize; j++)
+        objects[j] = poolAlloc(&pool[j % poolsNum], magazine);
+      for (unsigned j = 0; j < gPoolBurstSize; j++)
+        poolFree(&pool[j % poolsNum], objects[j], magazine);
+    }
+  });
+
+  uint64_t operations = static_cast<uint64_t>(threadsNum) * gPoolIterations;
+  printf("pool %-15s x%u threads: %u, alloc+free: %" PRIu64 ", elapsed time: %.3lf, %.1lf ns/op, rate: %.3lf Mop/s\n",
+         magazine ? "magazine" : "concurrentQueue",
+         poolsNum,
+         threadsNum,
+         operations,
+         seconds,
+         seconds * 1e9 / operations,
+         operations / seconds / 1e6);
+}
+
+static void test_pools()
+{
+  for (unsigned threadsNum: gThreadsNum) {
+    test_pool(threadsNum, false, 1);
+    test_pool(threadsNum, true, 1);
+    test_pool(threadsNum, false, gPoolsNum);
+    test_pool(threadsNum, true, gPoolsNum);
+  }
+}
+
+// ======================================================================
+// =                                                                    =
+// =                         MPMC queue                                 =
+// =                                                                    =
+// ======================================================================
+
+static const unsigned gQueueThreadsNum[] = {1, 2, 4, 8, 16, 32, 64};
+static const unsigned gQueueElementsNum = 8000000;
+static const unsigned gQueueBurstSize = 16;
+
+static void test_queue(unsigned threadsNum, bool batch)
+{
+  // Every thread is producer and consumer: pushes burst of elements, then pops same number of any elements
+  ConcurrentQueue *queue = static_cast<ConcurrentQueue*>(calloc(1, sizeof(ConcurrentQueue)));
+  unsigned iterations = gQueueElementsNum / threadsNum / gQueueBurstSize;
+  double seconds = runThreads(threadsNum, [queue, iterations, batch](unsigned index) {
+    void *data[gQueueBurstSize];
+    for (unsigned i = 0; i < iterations; i++) {
+      for (unsigned j = 0; j < gQueueBurstSize; j++)
+        concurrentQueuePush(queue, reinterpret_cast<void*>(static_cast<uintptr_t>(index+1)));
+      size_t popped = 0;
+      while (popped < gQueueBurstSize) {
+        if (batch)
+          popped += concurrentQueuePopBatch(queue, data, gQueueBurstSize - popped);
+        else
+          popped += concurrentQueuePop(queue, data);
+      }
+    }
+  });
+
+  uint64_t operations = static_cast<uint64_t>(iterations) * threadsNum * gQueueBurstSize;
+  printf("queue %-6s threads: %2u, push+pop: %" PRIu64 ", elapsed time: %.3lf, %.1lf ns/op, rate: %.3lf Mop/s\n",
+         batch ? "batch" : "single",
+         threadsNum,
+         operations,
+         seconds,
+         seconds * 1e9 / operations,
+         operations / seconds / 1e6);
+  free(queue);
+}
+
+static void test_queues()
+{
+  for (unsigned threadsNum: gQueueThreadsNum) {
+    test_queue(threadsNum, false);
+    test_queue(threadsNum, true);
+  }
+}
+
+// ======================================================================
+// =                                                                    =
+// =                 Memory ordering of combiner primitives             =
+// =                                                                    =
+// ======================================================================
+
+// Same algorithms built with sequentially consistent and with per call site orderings
+// x86 differs in release stores only (xchg vs mov), ARM64 in every access (dmb vs ldar/stlr/casal)
+struct OrderSeqCst {
+  static const int Relaxed = __ATOMIC_SEQ_CST;
+  static const int Acquire = __ATOMIC_SEQ_CST;
+  static const int Release = __ATOMIC_SEQ_CST;
+  static const int AcqRel = __ATOMIC_SEQ_CST;
+  static const char *name() { return "seq_cst"; }
+};
+
+struct OrderExplicit {
+  static const int Relaxed = __ATOMIC_RELAXED;
+  static const int Acquire = __ATOMIC_ACQUIRE;
+  static const int Release = __ATOMIC_RELEASE;
+  static const int AcqRel = __ATOMIC_ACQ_REL;
+  static const char *name() { return "acq_rel"; }
+};
+
+static const unsigned gAtomicIterations = 4000000;
+static const unsigned gCombinerNodesNum = 1024;
+static const uintptr_t gCombinerStub = 1;
+
+__NO_PADDING_BEGIN
+struct CombinerNode {
+  CombinerNode *next;
+  uintptr_t done;
+};
+__NO_PADDING_END
+
+struct alignas(64) CombinerObject {
+  volatile uintptr_t head = 0;
+  alignas(64) uint64_t processed = 0;
+};
+
+template<typename Order>
+static inline void combinerRun(CombinerObject *object, CombinerNode *node)
+{
+  // Same protocol as combiner(): owner executes tasks, exits when only stub remains
+  object->processed++;
+  __uintptr_atomic_store(&node->done, 1, Order::Release);
+  for (;;) {
+    uintptr_t head;
+    while ( (head = __uintptr_atomic_load(&object->head, Order::Relaxed)) == gCombinerStub ) {
+      if (__uintptr_atomic_compare_and_swap_explicit(&object->head, gCombinerStub, 0, Order::Release))
+        return;
+    }
+
+    while (!__uintptr_atomic_compare_and_swap_explicit(&object->head, head, gCombinerStub, Order::Acquire))
+      head = __uintptr_atomic_load(&object->head, Order::Relaxed);
+
+    while (head != gCombinerStub) {
+      CombinerNode *current = reinterpret_cast<CombinerNode*>(head);
+      head = reinterpret_cast<uintptr_t>(current->next);
+      object->processed++;
+      __uintptr_atomic_store(&current->done, 1, Order::Release);
+    }
+  }
+}
+
+template<typename Order>
+static inline void combinerPush(CombinerObject *object, CombinerNode *node)
+{
+  // Same protocol as combinerPushOperation()
+  uintptr_t head;
+  uintptr_t newHead;
+  do {
+    head = __uintptr_atomic_load(&object->head, Order::Relaxed);
+    if (head) {
+      node->next = reinterpret_cast<CombinerNode*>(head);
+      newHead = reinterpret_cast<uintptr_t>(node);
+    } else {
+      newHead = gCombinerStub;
+    }
+  } while (!__uintptr_atomic_compare_and_swap_explicit(&object->head, head, newHead, Order::AcqRel));
+
+  if (!head)
+    combinerRun<Order>(object, node);
+}
+
+template<typename Order>
+static void test_combiner(unsigned threadsNum)
+{
+  CombinerObject object;
+  double seconds = runThreads(threadsNum, [&object](unsigned) {
+    std::vector<CombinerNode> nodes(gCombinerNodesNum);
+    for (auto &node: nodes)
+      node.done = 1;
+    for (unsigned i = 0; i < gAtomicIterations; i++) {
+      CombinerNode *node = &nodes[i % gCombinerNodesNum];
+      // Node can be reused after combiner executed it
+      while (!__uintptr_atomic_load(&node->done, Order::Acquire))
+        std::this_thread::yield();
+      node->done = 0;
+      combinerPush<Order>(&object, node);
+    }
+
+    // Wait for own nodes before vector destruction
+    for (auto &node: nodes) {
+      while (!__uintptr_atomic_load(&node.done, Order::Acquire))
+        std::this_thread::yield();
+    }
+  });
+
+  uint64_t operations = static_cast<uint64_t>(threadsNum) * gAtomicIterations;
+  if (object.processed != operations)
+    fprintf(stderr, "ERROR: combiner executed %" PRIu64 " of %" PRIu64 " tasks\n", object.processed, operations);
+  printf("combiner %-8s threads: %u, push+run: %" PRIu64 ", elapsed time: %.3lf, %.1lf ns/op, rate: %.3lf Mop/s\n",
+         Order::name(),
+         threadsNum,
+         operations,
+         seconds,
+         seconds * 1e9 / operations,
+         operations / seconds / 1e6);
+}
+
+template<typename Order>
+static void test_spinlock(unsigned threadsNum)
+{
+  // Short critical section like timer wheel update
+  static volatile unsigned lock = 0;
+  static uint64_t counter;
+  counter = 0;
+  double seconds = runThreads(threadsNum, [](unsigned) {
+    for (unsigned i = 0; i < gAtomicIterations; i++) {
+      for (;;) {
+        if (__uint_atomic_load(&lock, Order::Relaxed) == 0 &&
+            __uint_atomic_compare_and_swap_explicit(&lock, 0, 1, Order::Acquire))
+          break;
+      }
+      counter++;
+      __uint_atomic_store(&lock, 0, Order::Release);
+    }
+  });
+
+  uint64_t operations = static_cast<uint64_t>(threadsNum) * gAtomicIterations;
+  if (counter != operations)
+    fprintf(stderr, "ERROR: spinlock counter %" PRIu64 " of %" PRIu64 "\n", counter, operations);
+  printf("spinlock %-8s threads: %u, lock+unlock: %" PRIu64 ", elapsed time: %.3lf, %.1lf ns/op, rate: %.3lf Mop/s\n",
+         Order::name(),
+         threadsNum,
+         operations,
+         seconds,
+         seconds * 1e9 / operations,
+         operations / seconds / 1e6);
+}
+
+static void test_atomics()
+{
+  for (unsigned threadsNum: gThreadsNum) {
+    test_combiner<OrderSeqCst>(threadsNum);
+    test_combiner<OrderExplicit>(threadsNum);
+  }
+  for (unsigned threadsNum: gThreadsNum) {
+    test_spinlock<OrderSeqCst>(threadsNum);
+    test_spinlock<OrderExplicit>(threadsNum);
+  }
+}
+
+// ======================================================================
+// =                                                                    =
+// =                         Lock contention                            =
+// =                                                                    =
+// ======================================================================
+
+static const unsigned gLockThreadsNum[] = {2, 4, 8, 16, 32, 64};
+static const unsigned gLockIterations = 4000000;
+static volatile unsigned gLockSink;
+
+// Previous __spinlock_acquire: CAS loop without cpu relax hints, sched_yield after 7777 attempts
+static void legacySpinlockAcquire(volatile unsigned *lock)
+{
+  for (;;) {
+    for (unsigned i = 0; i < 7777; i++) {
+      if (__uint_atomic_compare_and_swap(lock, 0, 1))
+        return;
+    }
+    sched_yield();
+  }
+}
+
+static void legacySpinlockRelease(volatile unsigned *lock)
+{
+  __uint_atomic_store(lock, 0, __ATOMIC_RELEASE);
+}
+
+static void test_lock(unsigned threadsNum, bool adaptive)
+{
+  // Short critical section (like timer wheel update) and some work between acquisitions
+  static volatile unsigned lock;
+  static uint64_t data[8];
+  lock = 0;
+  memset(data, 0, sizeof(data));
+  unsigned iterations = gLockIterations / threadsNum;
+  double seconds = runThreads(threadsNum, [iterations, adaptive](unsigned) {
+    unsigned local = 0;
+    for (unsigned i = 0; i < iterations; i++) {
+      if (adaptive)
+        __spinlock_acquire(&lock);
+      else
+        legacySpinlockAcquire(&lock);
+      for (unsigned j = 0; j < 8; j++)
+        data[j]++;
+      if (adaptive)
+        __spinlock_release(&lock);
+      else
+        legacySpinlockRelease(&lock);
+      for (unsigned j = 0; j < 32; j++)
+        local = local * 1103515245u + 12345u;
+    }
+    __uint_atomic_fetch_and_add(&gLockSink, local);
+  });
+
+  uint64_t operations = static_cast<uint64_t>(iterations) * threadsNum;
+  if (data[0] != operations)
+    fprintf(stderr, "ERROR: lock counter %" PRIu64 " of %" PRIu64 "\n", data[0], operations);
+  printf("lock %-8s threads: %2u, lock+unlock: %" PRIu64 ", elapsed time: %.3lf, %.1lf ns/op, rate: %.3lf Mop/s\n",
+         adaptive ? "adaptive" : "legacy",
+         threadsNum,
+         operations,
+         seconds,
+         seconds * 1e9 / operations,
+         operations / seconds / 1e6);
+}
+
+static void test_locks()
+{
+  for (unsigned threadsNum: gLockThreadsNum) {
+    test_lock(threadsNum, false);
+    test_lock(threadsNum, true);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  const char *name = argc >= 2 ? argv[1] : nullptr;
+  if (!name || strcmp(name, "pool") == 0)
+    test_pools();
+  if (!name || strcmp(name, "queue") == 0)
+    test_queues();
+  if (!name || strcmp(name, "atomic") == 0)
+    test_atomics();
+  if (!name || strcmp(name, "lock") == 0)
+    test_locks();
+  return 0;
+}
@@ -22,6 +22,7 @@ static uint64_t gTotalPacketNum = 4000000ULL;
 
 static unsigned gGroupSize = 1000;
 static unsigned gMessageSize = 16;
+static const unsigned gBatchSize = SOCKET_MSG_BATCH_SIZE;
 
 // For debugging
 static __tls uint64_t threadPacketsNum = 0;
@@ -37,7 +38,9 @@ struct Context {
 enum AIOSenderTy {
   aioSenderBlocking = 0,
   aioSenderAsync,
-  aioSenderCoroutine
+  aioSenderCoroutine,
+  aioSenderAsyncBatch,
+  aioSenderCoroutineBatch
 };
 
 enum AIOReceiverTy {
@@ -45,7 +48,9 @@ enum AIOReceiverTy {
   aioReceiverAsync,
   aioReceiverAsyncTimer,
   aioReceiverAsyncRT,
-  aioReceiverCoroutine
+  aioReceiverCoroutine,
+  aioReceiverAsyncBatch,
+  aioReceiverCoroutineBatch
 };
 
 __NO_PADDING_BEGIN
@@ -56,6 +61,7 @@ struct SenderCtx {
   aioObject *client;
   unsigned counter;
   char buffer[65536];  
+  aioMsg msgs[gBatchSize];
 };
 
 struct ReceiverCtx {
@@ -71,6 +77,8 @@ struct ReceiverCtx {
   uint64_t oldPacketsNum;
   uint64_t packetsNum; 
   char buffer[65536];  
+  aioMsg msgs[gBatchSize];
+  char batchBuffer[gBatchSize][2048];
   
   ReceiverCtx() : started(false), oldPacketsNum(0), packetsNum(0) {}
 };
@@ -80,7 +88,9 @@ __NO_PADDING_END
 static const char *aioSenderName[] = {
   "blocking",
   "async",
-  "coroutine"
+  "coroutine",
+  "async+batch",
+  "coroutine+batch"
 };
 
 static const char *aioReceiverName[] = {
@@ -88,7 +98,9 @@ static const char *aioReceiverName[] = {
   "async",
   "async+timer",
   "async+timer+rt",
-  "coroutine"
+  "coroutine",
+  "async+batch",
+  "coroutine+batch"
 };
 
 // ======================================================================
@@ -182,6 +194,84 @@ void *test_coroutine_sender(void *arg)
   return nullptr;
 }
 
+static void initializeSenderMsgs(SenderCtx *senderCtx)
+{
+  for (unsigned i = 0; i < gBatchSize; i++) {
+    senderCtx->msgs[i].address.family = AF_INET;
+    senderCtx->msgs[i].address.ipv4 = inet_addr("127.0.0.1");
+    senderCtx->msgs[i].address.port = htons(senderCtx->config->port);
+    senderCtx->msgs[i].buffer = senderCtx->buffer;
+    senderCtx->msgs[i].size = senderCtx->config->messageSize;
+    senderCtx->msgs[i].segmentSize = 0;
+  }
+}
+
+static size_t senderBatchSize(SenderCtx *senderCtx)
+{
+  uint64_t remaining = senderCtx->config->totalPacketNum - senderCtx->counter;
+  return remaining < gBatchSize ? static_cast<size_t>(remaining) : gBatchSize;
+}
+
+void test_aio_batch_writecb(AsyncOpStatus status, aioObject *object, aioMsg *msgs, size_t count, void *arg)
+{
+  __UNUSED(msgs);
+  SenderCtx *senderCtx = static_cast<SenderCtx*>(arg);
+  if (status == aosSuccess)
+    senderCtx->counter += static_cast<unsigned>(count);
+  if (senderCtx->counter >= senderCtx->config->totalPacketNum) {
+    postQuitOperation(aioGetBase(object));
+    return;
+  }
+
+  ssize_t result;
+  while ((result = aioWriteMsgBatch(object, senderCtx->msgs, senderBatchSize(senderCtx), afActiveOnce, 0, test_aio_batch_writecb, senderCtx)) > 0) {
+    senderCtx->counter += static_cast<unsigned>(result);
+    if (senderCtx->counter >= senderCtx->config->totalPacketNum) {
+      postQuitOperation(aioGetBase(object));
+      return;
+    }
+  }
+}
+
+void *test_aio_batch_sender(void *arg)
+{
+  SenderCtx *senderCtx = static_cast<SenderCtx*>(arg);
+  asyncBase *localBase = createAsyncBase(amOSDefault);
+
+  senderCtx->localBase = localBase;
+  senderCtx->client = newSocketIo(localBase, senderCtx->clientSocket);
+  senderCtx->counter = 0;
+  initializeSenderMsgs(senderCtx);
+  aioWriteMsgBatch(senderCtx->client, senderCtx->msgs, senderBatchSize(senderCtx), afNone, 0, test_aio_batch_writecb, senderCtx);
+  asyncLoop(localBase);
+  return nullptr;
+}
+
+void test_coroutine_batch_sender_coro(void *arg)
+{
+  SenderCtx *senderCtx = static_cast<SenderCtx*>(arg);
+  initializeSenderMsgs(senderCtx);
+  while (senderCtx->counter < senderCtx->config->totalPacketNum) {
+    ssize_t result = ioWriteMsgBatch(senderCtx->client, senderCtx->msgs, senderBatchSize(senderCtx), afNone, 0);
+    if (result < 0)
+      break;
+    senderCtx->counter += static_cast<unsigned>(result);
+  }
+}
+
+void *test_coroutine_batch_sender(void *arg)
+{
+  asyncBase *localBase = createAsyncBase(amOSDefault);
+
+  SenderCtx *senderCtx = static_cast<SenderCtx*>(arg);
+  senderCtx->localBase = localBase;
+  senderCtx->client = newSocketIo(localBase, senderCtx->clientSocket);
+  senderCtx->counter = 0;
+  coroutineCall(coroutineNew(test_coroutine_batch_sender_coro, senderCtx, 0x40000));
+  asyncLoop(localBase);
+  return nullptr;
+}
+
 // ======================================================================
 // =                                                                    =
 // =                         Receivers                                  =
@@ -355,6 +445,68 @@ void *test_coroutine_receiver(void *arg)
 }
 
 
+static void initializeReceiverMsgs(ReceiverCtx *ctx)
+{
+  for (unsigned i = 0; i < gBatchSize; i++) {
+    ctx->msgs[i].buffer = ctx->batchBuffer[i];
+    ctx->msgs[i].size = sizeof(ctx->batchBuffer[i]);
+  }
+}
+
+static void receiverAddPackets(ReceiverCtx *ctx, size_t count)
+{
+  ctx->started = true;
+  if (ctx->packetsNum == 0)
+    ctx->beginPt = getTimeMark();
+  uint64_t oldPacketsNum = ctx->packetsNum;
+  ctx->packetsNum += count;
+  if (ctx->packetsNum / ctx->config->groupSize != oldPacketsNum / ctx->config->groupSize)
+    ctx->endPt = getTimeMark();
+}
+
+// Asynchronous batched receiver callback
+void test_batch_readcb(AsyncOpStatus status,
+                       aioObject *socket,
+                       aioMsg *msgs,
+                       size_t count,
+                       void *arg)
+{
+  __UNUSED(msgs);
+  ReceiverCtx *ctx = static_cast<ReceiverCtx*>(arg);
+  if (status == aosSuccess)
+    receiverAddPackets(ctx, count);
+  aioReadMsgBatch(socket, ctx->msgs, gBatchSize, afNone, 0, test_batch_readcb, ctx);
+}
+
+void *test_aio_batch_receiver(void *arg)
+{
+  ReceiverCtx *ctx = static_cast<ReceiverCtx*>(arg);
+  initializeReceiverMsgs(ctx);
+  aioReadMsgBatch(ctx->server, ctx->msgs, gBatchSize, afNone, 0, test_batch_readcb, ctx);
+  asyncLoop(ctx->base);
+  return nullptr;
+}
+
+void test_coroutine_batch_receiver_coro(void *arg)
+{
+  ReceiverCtx *ctx = static_cast<ReceiverCtx*>(arg);
+  initializeReceiverMsgs(ctx);
+  for (;;) {
+    ssize_t result = ioReadMsgBatch(ctx->server, ctx->msgs, gBatchSize, afNone, 1000000);
+    if (result < 0)
+      return;
+    receiverAddPackets(ctx, static_cast<size_t>(result));
+  }
+}
+
+void *test_coroutine_batch_receiver(void *arg)
+{
+  ReceiverCtx *receiverCtx = static_cast<ReceiverCtx*>(arg);
+  coroutineCall(coroutineNew(test_coroutine_batch_receiver_coro, receiverCtx, 0x20000));
+  asyncLoop(receiverCtx->base);
+  return nullptr;
+}
+
 // ======================================================================
 // =                                                                    =
 // =                       Benchmark function                           =
@@ -408,6 +560,16 @@ void test_aio(unsigned senderThreads, unsigned receiverThreads, uint16_t port, A
         thread.detach();        
         break;
       }
+      case aioReceiverAsyncBatch : {
+        std::thread thread(test_aio_batch_receiver, &allReceivers[i]);
+        thread.detach();
+        break;
+      }
+      case aioReceiverCoroutineBatch : {
+        std::thread thread(test_coroutine_batch_receiver, &allReceivers[i]);
+        thread.detach();
+        break;
+      }
     }
   }  
   
@@ -438,6 +600,16 @@ void test_aio(unsigned senderThreads, unsigned receiverThreads, uint16_t port, A
         thread.detach();        
         break;
       }
+      case aioSenderAsyncBatch : {
+        std::thread thread(test_aio_batch_sender, &allSenders[i]);
+        thread.detach();
+        break;
+      }
+      case aioSenderCoroutineBatch : {
+        std::thread thread(test_coroutine_batch_sender, &allSenders[i]);
+        thread.detach();
+        break;
+      }
     }
   }
   
@@ -493,50 +665,59 @@ void test_aio(unsigned senderThreads, unsigned receiverThreads, uint16_t port, A
 
 int main(int argc, char **argv)
 {
-  __UNUSED(argc);
-  __UNUSED(argv);
-
   initializeSocketSubsystem();
   uint16_t port = gPortBase;
   
-  // Blocking tests
-  test_aio(1, 1, port++, aioSenderBlocking, aioReceiverBlocking);
-  test_aio(4, 1, port++, aioSenderBlocking, aioReceiverBlocking);
-  test_aio(1, 2, port++, aioSenderBlocking, aioReceiverBlocking);
-  test_aio(1, 4, port++, aioSenderBlocking, aioReceiverBlocking);
-  test_aio(4, 4, port++, aioSenderBlocking, aioReceiverBlocking);
-  
-  // Senders test with blocking receiver
-  test_aio(1, 1, port++, aioSenderAsync, aioReceiverBlocking);
-  test_aio(4, 1, port++, aioSenderAsync, aioReceiverBlocking);
-  test_aio(1, 1, port++, aioSenderCoroutine, aioReceiverBlocking);
-  test_aio(4, 1, port++, aioSenderCoroutine, aioReceiverBlocking);
-
-  // Receivers test with blocking sender
-  test_aio(1, 1, port++, aioSenderBlocking, aioReceiverAsync);
-  test_aio(4, 1, port++, aioSenderBlocking, aioReceiverAsync);
-  test_aio(1, 1, port++, aioSenderBlocking, aioReceiverAsyncTimer);
-  test_aio(4, 1, port++, aioSenderBlocking, aioReceiverAsyncTimer);
-  test_aio(1, 1, port++, aioSenderBlocking, aioReceiverAsyncRT);
-  test_aio(4, 1, port++, aioSenderBlocking, aioReceiverAsyncRT);
-  test_aio(1, 1, port++, aioSenderBlocking, aioReceiverCoroutine);
-  test_aio(4, 1, port++, aioSenderBlocking, aioReceiverCoroutine);
-
-  // Multi-threading receivers
-  test_aio(1, 2, port++, aioSenderBlocking, aioReceiverAsync);
-  test_aio(1, 4, port++, aioSenderBlocking, aioReceiverAsync);
-  test_aio(4, 4, port++, aioSenderBlocking, aioReceiverAsync);
-  
-  test_aio(1, 2, port++, aioSenderBlocking, aioReceiverAsyncTimer);
-  test_aio(1, 4, port++, aioSenderBlocking, aioReceiverAsyncTimer);
-  test_aio(4, 4, port++, aioSenderBlocking, aioReceiverAsyncTimer);
+  // 'batch' argument runs only single versus batched comparison
+  bool batchOnly = argc >= 2 && strcmp(argv[1], "batch") == 0;
+  if (!batchOnly) {
+    // Blocking tests
+    test_aio(1, 1, port++, aioSenderBlocking, aioReceiverBlocking);
+    test_aio(4, 1, port++, aioSenderBlocking, aioReceiverBlocking);
+    test_aio(1, 2, port++, aioSenderBlocking, aioReceiverBlocking);
+    test_aio(1, 4, port++, aioSenderBlocking, aioReceiverBlocking);
+    test_aio(4, 4, port++, aioSenderBlocking, aioReceiverBlocking);
+
+    // Senders test with blocking receiver
+    test_aio(1, 1, port++, aioSenderAsync, aioReceiverBlocking);
+    test_aio(4, 1, port++, aioSenderAsync, aioReceiverBlocking);
+    test_aio(1, 1, port++, aioSenderCoroutine, aioReceiverBlocking);
+    test_aio(4, 1, port++, aioSenderCoroutine, aioReceiverBlocking);
+
+    // Receivers test with blocking sender
+    test_aio(1, 1, port++, aioSenderBlocking, aioReceiverAsync);
+    test_aio(4, 1, port++, aioSenderBlocking, aioReceiverAsync);
+    test_aio(1, 1, port++, aioSenderBlocking, aioReceiverAsyncTimer);
+    test_aio(4, 1, port++, aioSenderBlocking, aioReceiverAsyncTimer);
+    test_aio(1, 1, port++, aioSenderBlocking, aioReceiverAsyncRT);
+    test_aio(4, 1, port++, aioSenderBlocking, aioReceiverAsyncRT);
+    test_aio(1, 1, port++, aioSenderBlocking, aioReceiverCoroutine);
+    test_aio(4, 1, port++, aioSenderBlocking, aioReceiverCoroutine);
+
+    // Multi-threading receivers
+    test_aio(1, 2, port++, aioSenderBlocking, aioReceiverAsync);
+    test_aio(1, 4, port++, aioSenderBlocking, aioReceiverAsync);
+    test_aio(4, 4, port++, aioSenderBlocking, aioReceiverAsync);
+
+    test_aio(1, 2, port++, aioSenderBlocking, aioReceiverAsyncTimer);
+    test_aio(1, 4, port++, aioSenderBlocking, aioReceiverAsyncTimer);
+    test_aio(4, 4, port++, aioSenderBlocking, aioReceiverAsyncTimer);
+
+    test_aio(1, 2, port++, aioSenderBlocking, aioReceiverAsyncRT);
+    test_aio(1, 4, port++, aioSenderBlocking, aioReceiverAsyncRT);
+    test_aio(4, 4, port++, aioSenderBlocking, aioReceiverAsyncRT);
+
+    test_aio(1, 2, port++, aioSenderBlocking, aioReceiverCoroutine);
+    test_aio(1, 4, port++, aioSenderBlocking, aioReceiverCoroutine);
+    test_aio(4, 4, port++, aioSenderBlocking, aioReceiverCoroutine);
+  }
 
-  test_aio(1, 2, port++, aioSenderBlocking, aioReceiverAsyncRT);
-  test_aio(1, 4, port++, aioSenderBlocking, aioReceiverAsyncRT);
-  test_aio(4, 4, port++, aioSenderBlocking, aioReceiverAsyncRT);
-  
-  test_aio(1, 2, port++, aioSenderBlocking, aioReceiverCoroutine);
-  test_aio(1, 4, port++, aioSenderBlocking, aioReceiverCoroutine);
-  test_aio(4, 4, port++, aioSenderBlocking, aioReceiverCoroutine);
+  // Single versus batched (recvmmsg/sendmmsg) datagram operations
+  test_aio(1, 1, port++, aioSenderAsync, aioReceiverAsync);
+  test_aio(1, 1, port++, aioSenderAsyncBatch, aioReceiverAsyncBatch);
+  test_aio(1, 1, port++, aioSenderCoroutine, aioReceiverCoroutine);
+  test_aio(1, 1, port++, aioSenderCoroutineBatch, aioReceiverCoroutineBatch);
+  test_aio(4, 4, port++, aioSenderAsync, aioReceiverAsync);
+  test_aio(4, 4, port++, aioSenderAsyncBatch, aioReceiverAsyncBatch);
   return 0;
 }
@@ -1,14 +1,27 @@
 #include "unittest.h"
 #include "asyncio/coroutine.h"
+#include "asyncio/bufferPool.h"
 #include "asyncio/device.h"
+#include "asyncio/loopRunner.h"
+#include "asyncio/relay.h"
+#include "asyncio/shard.h"
 #include "asyncio/socket.h"
 #include "p2putils/HttpRequestParse.h"
 #include "asyncioextras/rlpx.h"
 #include "atomic.h"
+#include <atomic>
 #include <chrono>
 #include <thread>
+#include <vector>
+#ifndef OS_WINDOWS
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
 
 asyncBase *gBase = nullptr;
+AsyncMethod gMethod = amOSDefault;
 
 aioObject *startTCPServer(asyncBase *base, aioAcceptCb callback, void *arg, uint16_t port)
 {
@@ -134,6 +147,120 @@ TEST(basic, test_pipe)
   }
 }
 
+void test_vector_rw_readcb(AsyncOpStatus status, aioObject*, size_t transferred, void *arg)
+{
+  TestContext *ctx = static_cast<TestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  EXPECT_EQ(transferred, 2*sizeof(reqStruct));
+  if (status == aosSuccess && transferred == 2*sizeof(reqStruct)) {
+    reqStruct *req = reinterpret_cast<reqStruct*>(ctx->serverBuffer);
+    reqStruct *tail = reinterpret_cast<reqStruct*>(ctx->clientBuffer);
+    EXPECT_EQ(req->a, 11);
+    EXPECT_EQ(req->b, 77);
+    EXPECT_EQ(tail->a, 12);
+    EXPECT_EQ(tail->b, 78);
+  }
+
+  postQuitOperation(ctx->base);
+}
+
+TEST(basic, test_vector_rw)
+{
+  TestContext context(gBase);
+  pipeTy unnamedPipe;
+  int result = pipeCreate(&unnamedPipe, 1);
+  EXPECT_EQ(result, 0);
+  if (result == 0) {
+    reqStruct req[2];
+    aioIoVec readVec[2];
+    aioIoVec writeVec[3];
+    context.pipeRead = newDeviceIo(gBase, unnamedPipe.read);
+    context.pipeWrite = newDeviceIo(gBase, unnamedPipe.write);
+    req[0].a = 11;
+    req[0].b = 77;
+    req[1].a = 12;
+    req[1].b = 78;
+    // Read boundaries differ from write boundaries
+    readVec[0].iov_base = context.serverBuffer;
+    readVec[0].iov_len = sizeof(reqStruct);
+    readVec[1].iov_base = context.clientBuffer;
+    readVec[1].iov_len = sizeof(reqStruct);
+    writeVec[0].iov_base = &req[0];
+    writeVec[0].iov_len = 4;
+    writeVec[1].iov_base = reinterpret_cast<uint8_t*>(&req[0]) + 4;
+    writeVec[1].iov_len = sizeof(reqStruct);
+    writeVec[2].iov_base = reinterpret_cast<uint8_t*>(&req[1]) + 4;
+    writeVec[2].iov_len = sizeof(reqStruct) - 4;
+    aioReadv(context.pipeRead, readVec, 2, afWaitAll, 1000000, test_vector_rw_readcb, &context);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    aioWritev(context.pipeWrite, writeVec, 3, afWaitAll, 0, test_pipe_writecb, &context);
+    asyncLoop(gBase);
+    deleteAioObject(context.pipeRead);
+    deleteAioObject(context.pipeWrite);
+  }
+}
+
+__NO_PADDING_BEGIN
+struct CoalesceTestContext {
+  asyncBase *base;
+  std::vector<uint8_t> source;
+  std::vector<uint8_t> received;
+  size_t writesFinished;
+  size_t bytesWritten;
+};
+__NO_PADDING_END
+
+void test_write_coalescing_writecb(AsyncOpStatus status, aioObject*, size_t transferred, void *arg)
+{
+  CoalesceTestContext *ctx = static_cast<CoalesceTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  ctx->writesFinished++;
+  ctx->bytesWritten += transferred;
+}
+
+void test_write_coalescing_readcb(AsyncOpStatus status, aioObject*, size_t transferred, void *arg)
+{
+  CoalesceTestContext *ctx = static_cast<CoalesceTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  EXPECT_EQ(transferred, ctx->source.size());
+  EXPECT_TRUE(ctx->received == ctx->source);
+  postQuitOperation(ctx->base);
+}
+
+TEST(basic, test_write_coalescing)
+{
+  // Large write fills pipe, small writes queued behind it are sent together after reader drains pipe
+  const size_t largeSize = 256*1024;
+  const size_t smallSize = 100;
+  const size_t smallCount = 8;
+  CoalesceTestContext context;
+  context.base = gBase;
+  context.source.resize(largeSize + smallSize*smallCount);
+  context.received.resize(context.source.size());
+  context.writesFinished = 0;
+  context.bytesWritten = 0;
+  for (size_t i = 0; i < context.source.size(); i++)
+    context.source[i] = static_cast<uint8_t>(i*7 + i/256);
+
+  pipeTy unnamedPipe;
+  int result = pipeCreate(&unnamedPipe, 1);
+  EXPECT_EQ(result, 0);
+  if (result == 0) {
+    aioObject *pipeRead = newDeviceIo(gBase, unnamedPipe.read);
+    aioObject *pipeWrite = newDeviceIo(gBase, unnamedPipe.write);
+    aioSetWriteCoalescing(pipeWrite, 1);
+    aioWrite(pipeWrite, context.source.data(), largeSize, afWaitAll, 0, test_write_coalescing_writecb, &context);
+    for (size_t i = 0; i < smallCount; i++)
+      aioWrite(pipeWrite, context.source.data() + largeSize + i*smallSize, smallSize, afWaitAll, 0, test_write_coalescing_writecb, &context);
+    aioRead(pipeRead, context.received.data(), context.received.size(), afWaitAll, 3000000, test_write_coalescing_readcb, &context);
+    asyncLoop(gBase);
+    EXPECT_EQ(context.writesFinished, smallCount + 1);
+    EXPECT_EQ(context.bytesWritten, context.source.size());
+    deleteAioObject(pipeRead);
+    deleteAioObject(pipeWrite);
+  }
+}
+
 void test_connect_accept_readcb(AsyncOpStatus status, aioObject *socket, size_t transferred, void *arg)
 {
   __UNUSED(transferred);
@@ -252,6 +379,416 @@ TEST(basic, test_tcp_rw)
   ASSERT_TRUE(context.success);
 }
 
+__NO_PADDING_BEGIN
+struct ZeroCopyTestContext {
+  asyncBase *base;
+  std::vector<uint8_t> source;
+  std::vector<uint8_t> received;
+  aioObject *serverConnection;
+  iodevTy file;
+  uint64_t fileOffset;
+  size_t receivedSize;
+  int finished;
+  bool written;
+};
+__NO_PADDING_END
+
+static void test_zerocopy_finish(ZeroCopyTestContext *ctx)
+{
+  if (++ctx->finished == 2)
+    postQuitOperation(ctx->base);
+}
+
+void test_zerocopy_writecb(AsyncOpStatus status, aioObject*, size_t transferred, void *arg)
+{
+  ZeroCopyTestContext *ctx = static_cast<ZeroCopyTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  EXPECT_EQ(transferred, ctx->source.size());
+  ctx->written = status == aosSuccess;
+  test_zerocopy_finish(ctx);
+}
+
+void test_zerocopy_readcb(AsyncOpStatus status, aioObject*, size_t transferred, void *arg)
+{
+  ZeroCopyTestContext *ctx = static_cast<ZeroCopyTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  EXPECT_EQ(transferred, ctx->source.size());
+  EXPECT_TRUE(ctx->received == ctx->source);
+  test_zerocopy_finish(ctx);
+}
+
+void test_zerocopy_acceptcb(AsyncOpStatus status, aioObject*, HostAddress, socketTy acceptSocket, void *arg)
+{
+  ZeroCopyTestContext *ctx = static_cast<ZeroCopyTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  if (status == aosSuccess) {
+    ctx->serverConnection = newSocketIo(ctx->base, acceptSocket);
+    aioRead(ctx->serverConnection, ctx->received.data(), ctx->received.size(), afWaitAll, 3000000, test_zerocopy_readcb, ctx);
+  } else {
+    postQuitOperation(ctx->base);
+  }
+}
+
+void test_zerocopy_connectcb(AsyncOpStatus status, aioObject *object, void *arg)
+{
+  ZeroCopyTestContext *ctx = static_cast<ZeroCopyTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  if (status == aosSuccess)
+    aioWrite(object, ctx->source.data(), ctx->source.size(), afWaitAll | afZeroCopy, 3000000, test_zerocopy_writecb, ctx);
+  else
+    postQuitOperation(ctx->base);
+}
+
+TEST(basic, test_tcp_zerocopy)
+{
+  ZeroCopyTestContext context;
+  context.base = gBase;
+  context.source.resize(4*1024*1024);
+  context.received.resize(context.source.size());
+  context.serverConnection = nullptr;
+  context.finished = 0;
+  context.written = false;
+  for (size_t i = 0; i < context.source.size(); i++)
+    context.source[i] = static_cast<uint8_t>(i*13 + i/4096);
+
+  aioObject *serverSocket = startTCPServer(gBase, test_zerocopy_acceptcb, &context, gPort);
+  aioObject *clientSocket = initializeTCPClient(gBase, test_zerocopy_connectcb, &context, gPort);
+  ASSERT_NE(serverSocket, nullptr);
+  ASSERT_NE(clientSocket, nullptr);
+  asyncLoop(gBase);
+  EXPECT_TRUE(context.written);
+  if (context.serverConnection)
+    deleteAioObject(context.serverConnection);
+  deleteAioObject(clientSocket);
+  deleteAioObject(serverSocket);
+}
+
+void test_read_mapped_readcb(AsyncOpStatus status, aioObject*, aioMappedBuffer *buffer, void *arg)
+{
+  ZeroCopyTestContext *ctx = static_cast<ZeroCopyTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  EXPECT_EQ(buffer->size, ctx->source.size());
+  if (buffer->size == ctx->source.size()) {
+    size_t offset = 0;
+    for (size_t i = 0; i < buffer->segmentsCount; i++) {
+      memcpy(ctx->received.data() + offset, buffer->segments[i].iov_base, buffer->segments[i].iov_len);
+      offset += buffer->segments[i].iov_len;
+    }
+    EXPECT_EQ(offset, buffer->size);
+    EXPECT_TRUE(ctx->received == ctx->source);
+  }
+
+  aioReleaseMapped(buffer);
+  test_zerocopy_finish(ctx);
+}
+
+void test_read_mapped_acceptcb(AsyncOpStatus status, aioObject*, HostAddress, socketTy acceptSocket, void *arg)
+{
+  ZeroCopyTestContext *ctx = static_cast<ZeroCopyTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  if (status == aosSuccess) {
+    ctx->serverConnection = newSocketIo(ctx->base, acceptSocket);
+    aioReadMapped(ctx->serverConnection, ctx->source.size(), afWaitAll, 3000000, test_read_mapped_readcb, ctx);
+  } else {
+    postQuitOperation(ctx->base);
+  }
+}
+
+void test_read_mapped_connectcb(AsyncOpStatus status, aioObject *object, void *arg)
+{
+  ZeroCopyTestContext *ctx = static_cast<ZeroCopyTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  if (status == aosSuccess)
+    aioWrite(object, ctx->source.data(), ctx->source.size(), afWaitAll | afNoCopy, 3000000, test_zerocopy_writecb, ctx);
+  else
+    postQuitOperation(ctx->base);
+}
+
+TEST(basic, test_tcp_read_mapped)
+{
+  ZeroCopyTestContext context;
+  context.base = gBase;
+  context.source.resize(4*1024*1024 + 100);
+  context.received.resize(context.source.size());
+  context.serverConnection = nullptr;
+  context.finished = 0;
+  context.written = false;
+  for (size_t i = 0; i < context.source.size(); i++)
+    context.source[i] = static_cast<uint8_t>(i*17 + i/4096);
+
+  aioObject *serverSocket = startTCPServer(gBase, test_read_mapped_acceptcb, &context, gPort);
+  aioObject *clientSocket = initializeTCPClient(gBase, test_read_mapped_connectcb, &context, gPort);
+  ASSERT_NE(serverSocket, nullptr);
+  ASSERT_NE(clientSocket, nullptr);
+  asyncLoop(gBase);
+  EXPECT_TRUE(context.written);
+  if (context.serverConnection)
+    deleteAioObject(context.serverConnection);
+  deleteAioObject(clientSocket);
+  deleteAioObject(serverSocket);
+}
+
+void test_read_provided_readcb(AsyncOpStatus status, aioObject *object, void *buffer, size_t transferred, void *arg)
+{
+  ZeroCopyTestContext *ctx = static_cast<ZeroCopyTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  if (status != aosSuccess) {
+    EXPECT_EQ(buffer, nullptr);
+    test_zerocopy_finish(ctx);
+    return;
+  }
+
+  // Buffer size raised in the middle of stream, pool holds buffers of old size
+  size_t half = ctx->received.size() / 2;
+  EXPECT_NE(buffer, nullptr);
+  EXPECT_LE(transferred, ctx->receivedSize >= half ? 65536u : 4096u);
+  size_t size = std::min(transferred, ctx->received.size() - ctx->receivedSize);
+  memcpy(ctx->received.data() + ctx->receivedSize, buffer, size);
+  if (ctx->receivedSize < half && ctx->receivedSize + size >= half)
+    aioSetProvidedBufferSize(ctx->base, 65536);
+  ctx->receivedSize += size;
+  aioReleaseProvided(object, buffer);
+  if (ctx->receivedSize < ctx->received.size()) {
+    aioReadProvided(object, afNone, 3000000, test_read_provided_readcb, ctx);
+  } else {
+    EXPECT_TRUE(ctx->received == ctx->source);
+    test_zerocopy_finish(ctx);
+  }
+}
+
+void test_read_provided_acceptcb(AsyncOpStatus status, aioObject*, HostAddress, socketTy acceptSocket, void *arg)
+{
+  ZeroCopyTestContext *ctx = static_cast<ZeroCopyTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  if (status == aosSuccess) {
+    ctx->serverConnection = newSocketIo(ctx->base, acceptSocket);
+    aioReadProvided(ctx->serverConnection, afNone, 3000000, test_read_provided_readcb, ctx);
+  } else {
+    postQuitOperation(ctx->base);
+  }
+}
+
+TEST(basic, test_tcp_read_provided)
+{
+  // Pool buffers smaller than message, data received by chain of reads
+  ZeroCopyTestContext context;
+  context.base = gBase;
+  context.source.resize(1024*1024 + 33);
+  context.received.resize(context.source.size());
+  context.receivedSize = 0;
+  context.serverConnection = nullptr;
+  context.finished = 0;
+  context.written = false;
+  for (size_t i = 0; i < context.source.size(); i++)
+    context.source[i] = static_cast<uint8_t>(i*11 + i/4096);
+
+  aioSetProvidedBufferSize(gBase, 4096);
+  aioObject *serverSocket = startTCPServer(gBase, test_read_provided_acceptcb, &context, gPort);
+  aioObject *clientSocket = initializeTCPClient(gBase, test_read_mapped_connectcb, &context, gPort);
+  ASSERT_NE(serverSocket, nullptr);
+  ASSERT_NE(clientSocket, nullptr);
+  asyncLoop(gBase);
+  EXPECT_TRUE(context.written);
+  EXPECT_EQ(context.receivedSize, context.source.size());
+  if (context.serverConnection)
+    deleteAioObject(context.serverConnection);
+  deleteAioObject(clientSocket);
+  deleteAioObject(serverSocket);
+}
+
+void test_read_discard_writecb(AsyncOpStatus status, aioObject *object, size_t, void *arg)
+{
+  ZeroCopyTestContext *ctx = static_cast<ZeroCopyTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  ctx->written = status == aosSuccess;
+  deleteAioObject(object);
+}
+
+void test_read_discard_readcb(AsyncOpStatus status, aioObject*, size_t, void *arg)
+{
+  ZeroCopyTestContext *ctx = static_cast<ZeroCopyTestContext*>(arg);
+  EXPECT_EQ(status, aosDisconnected);
+  postQuitOperation(ctx->base);
+}
+
+void test_read_discard_acceptcb(AsyncOpStatus status, aioObject*, HostAddress, socketTy acceptSocket, void *arg)
+{
+  ZeroCopyTestContext *ctx = static_cast<ZeroCopyTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  if (status == aosSuccess) {
+    // Received data of reads without callback released by library
+    ctx->serverConnection = newSocketIo(ctx->base, acceptSocket);
+    aioReadMapped(ctx->serverConnection, ctx->source.size() - 1, afWaitAll, 3000000, nullptr, nullptr);
+    aioReadProvided(ctx->serverConnection, afNone, 3000000, nullptr, nullptr);
+    aioRead(ctx->serverConnection, ctx->received.data(), 1, afWaitAll, 3000000, test_read_discard_readcb, ctx);
+  } else {
+    postQuitOperation(ctx->base);
+  }
+}
+
+void test_read_discard_connectcb(AsyncOpStatus status, aioObject *object, void *arg)
+{
+  ZeroCopyTestContext *ctx = static_cast<ZeroCopyTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  if (status == aosSuccess)
+    aioWrite(object, ctx->source.data(), ctx->source.size(), afWaitAll | afNoCopy, 3000000, test_read_discard_writecb, ctx);
+  else
+    postQuitOperation(ctx->base);
+}
+
+TEST(basic, test_tcp_read_discard)
+{
+  ZeroCopyTestContext context;
+  context.base = gBase;
+  context.source.resize(16*4096 + 1, 0x5A);
+  context.received.resize(1);
+  context.serverConnection = nullptr;
+  context.finished = 0;
+  context.written = false;
+
+  aioObject *serverSocket = startTCPServer(gBase, test_read_discard_acceptcb, &context, gPort);
+  aioObject *clientSocket = initializeTCPClient(gBase, test_read_discard_connectcb, &context, gPort);
+  ASSERT_NE(serverSocket, nullptr);
+  ASSERT_NE(clientSocket, nullptr);
+  asyncLoop(gBase);
+  EXPECT_TRUE(context.written);
+  if (context.serverConnection)
+    deleteAioObject(context.serverConnection);
+  deleteAioObject(serverSocket);
+}
+
+#ifndef OS_WINDOWS
+void test_sendfile_connectcb(AsyncOpStatus status, aioObject *object, void *arg)
+{
+  ZeroCopyTestContext *ctx = static_cast<ZeroCopyTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  if (status == aosSuccess)
+    aioSendFile(object, ctx->file, ctx->fileOffset, ctx->source.size(), afWaitAll, 3000000, test_zerocopy_writecb, ctx);
+  else
+    postQuitOperation(ctx->base);
+}
+
+TEST(basic, test_tcp_sendfile)
+{
+  ZeroCopyTestContext context;
+  context.base = gBase;
+  context.source.resize(3*1024*1024 + 77);
+  context.received.resize(context.source.size());
+  context.serverConnection = nullptr;
+  context.finished = 0;
+  context.written = false;
+  context.fileOffset = 4096 + 13;
+  for (size_t i = 0; i < context.source.size(); i++)
+    context.source[i] = static_cast<uint8_t>(i*11 + i/4096);
+
+  // File contains garbage before sent region
+  char fileName[] = "/tmp/asynciotestXXXXXX";
+  context.file = mkstemp(fileName);
+  ASSERT_NE(context.file, -1);
+  unlink(fileName);
+  std::vector<uint8_t> prefix(context.fileOffset, 0xFF);
+  ASSERT_EQ(write(context.file, prefix.data(), prefix.size()), static_cast<ssize_t>(prefix.size()));
+  ASSERT_EQ(write(context.file, context.source.data(), context.source.size()), static_cast<ssize_t>(context.source.size()));
+
+  aioObject *serverSocket = startTCPServer(gBase, test_zerocopy_acceptcb, &context, gPort);
+  aioObject *clientSocket = initializeTCPClient(gBase, test_sendfile_connectcb, &context, gPort);
+  ASSERT_NE(serverSocket, nullptr);
+  ASSERT_NE(clientSocket, nullptr);
+  asyncLoop(gBase);
+  EXPECT_TRUE(context.written);
+  if (context.serverConnection)
+    deleteAioObject(context.serverConnection);
+  deleteAioObject(clientSocket);
+  deleteAioObject(serverSocket);
+  close(context.file);
+}
+
+struct RelayTestContext {
+  asyncBase *base;
+  AsyncOpStatus status;
+  uint64_t bytesAtoB;
+  uint64_t bytesBtoA;
+};
+
+void test_relay_cb(AsyncOpStatus status, aioObject*, aioObject*, uint64_t bytesAtoB, uint64_t bytesBtoA, void *arg)
+{
+  RelayTestContext *ctx = static_cast<RelayTestContext*>(arg);
+  ctx->status = status;
+  ctx->bytesAtoB = bytesAtoB;
+  ctx->bytesBtoA = bytesBtoA;
+  postQuitOperation(ctx->base);
+}
+
+static bool test_relay_transfer(int from, int to, const std::vector<uint8_t> &data)
+{
+  // Blocking write of all data with half close, reading until end of stream on other side
+  std::vector<uint8_t> received;
+  std::thread writer([from, &data]() {
+    size_t offset = 0;
+    while (offset < data.size()) {
+      ssize_t result = write(from, data.data() + offset, data.size() - offset);
+      if (result <= 0)
+        break;
+      offset += static_cast<size_t>(result);
+    }
+    shutdown(from, SHUT_WR);
+  });
+
+  uint8_t buffer[16384];
+  ssize_t result;
+  while ((result = read(to, buffer, sizeof(buffer))) > 0)
+    received.insert(received.end(), buffer, buffer + result);
+  writer.join();
+  return received == data;
+}
+
+TEST(basic, test_tcp_relay)
+{
+  // client <-> a ... relay ... b <-> server, socket pairs used as connected stream sockets
+  int clientPair[2];
+  int serverPair[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, clientPair), 0);
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, serverPair), 0);
+  fcntl(clientPair[1], F_SETFL, fcntl(clientPair[1], F_GETFL) | O_NONBLOCK);
+  fcntl(serverPair[0], F_SETFL, fcntl(serverPair[0], F_GETFL) | O_NONBLOCK);
+
+  std::vector<uint8_t> request(5*1024*1024 + 31);
+  std::vector<uint8_t> response(1024*1024 + 7);
+  for (size_t i = 0; i < request.size(); i++)
+    request[i] = static_cast<uint8_t>(i*7 + i/4096);
+  for (size_t i = 0; i < response.size(); i++)
+    response[i] = static_cast<uint8_t>(i*5 + i/1024);
+
+  RelayTestContext context;
+  context.base = gBase;
+  context.status = aosUnknown;
+  context.bytesAtoB = 0;
+  context.bytesBtoA = 0;
+  aioObject *a = newSocketIo(gBase, clientPair[1]);
+  aioObject *b = newSocketIo(gBase, serverPair[0]);
+  aioRelay(a, b, 3000000, test_relay_cb, &context);
+
+  bool requestValid = false;
+  bool responseValid = false;
+  std::thread peers([&]() {
+    requestValid = test_relay_transfer(clientPair[0], serverPair[1], request);
+    responseValid = test_relay_transfer(serverPair[1], clientPair[0], response);
+  });
+
+  asyncLoop(gBase);
+  peers.join();
+  EXPECT_EQ(context.status, aosSuccess);
+  EXPECT_EQ(context.bytesAtoB, request.size());
+  EXPECT_EQ(context.bytesBtoA, response.size());
+  EXPECT_TRUE(requestValid);
+  EXPECT_TRUE(responseValid);
+  deleteAioObject(a);
+  deleteAioObject(b);
+  close(clientPair[0]);
+  close(serverPair[1]);
+}
+#endif
+
 void test_udp_rw_client_readcb(AsyncOpStatus status, aioObject *socket, HostAddress address, size_t transferred, void *arg)
 {
   __UNUSED(address);
@@ -305,6 +842,163 @@ TEST(basic, test_udp_rw)
   ASSERT_TRUE(context.success);
 }
 
+struct MsgBatchTestContext {
+  asyncBase *base;
+  aioObject *serverSocket;
+  aioMsg serverMsgs[8];
+  uint8_t serverBuffers[8][16];
+  unsigned received;
+  unsigned finished;
+  bool success;
+};
+
+void test_udp_batch_server_readcb(AsyncOpStatus status, aioObject *socket, aioMsg *msgs, size_t count, void *arg)
+{
+  MsgBatchTestContext *ctx = static_cast<MsgBatchTestContext*>(arg);
+  if (status == aosSuccess) {
+    for (size_t i = 0; i < count; i++) {
+      EXPECT_EQ(msgs[i].transferred, 4u);
+      EXPECT_EQ(msgs[i].address.port, msgs[0].address.port);
+      EXPECT_EQ(reinterpret_cast<uint8_t*>(msgs[i].buffer)[0], ctx->received + i);
+    }
+
+    ctx->received += static_cast<unsigned>(count);
+    if (ctx->received == 32) {
+      ctx->success = true;
+      deleteAioObject(socket);
+      if (++ctx->finished == 2)
+        postQuitOperation(ctx->base);
+    } else {
+      aioReadMsgBatch(socket, ctx->serverMsgs, 8, afNone, 1000000, test_udp_batch_server_readcb, ctx);
+    }
+  } else {
+    postQuitOperation(ctx->base);
+  }
+}
+
+void test_udp_batch_writecb(AsyncOpStatus status, aioObject*, aioMsg*, size_t count, void *arg)
+{
+  MsgBatchTestContext *ctx = static_cast<MsgBatchTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  EXPECT_EQ(count, 32u);
+  if (status != aosSuccess || ++ctx->finished == 2)
+    postQuitOperation(ctx->base);
+}
+
+TEST(basic, test_udp_batch)
+{
+  MsgBatchTestContext context;
+  context.base = gBase;
+  context.received = 0;
+  context.finished = 0;
+  context.success = false;
+  for (unsigned i = 0; i < 8; i++) {
+    context.serverMsgs[i].buffer = context.serverBuffers[i];
+    context.serverMsgs[i].size = sizeof(context.serverBuffers[i]);
+  }
+
+  context.serverSocket = startUDPServer(gBase, nullptr, nullptr, nullptr, 0, gPort);
+  aioObject *clientSocket = initializeUDPClient(gBase);
+  ASSERT_NE(context.serverSocket, nullptr);
+  ASSERT_NE(clientSocket, nullptr);
+
+  uint8_t clientBuffers[32][4];
+  aioMsg clientMsgs[32];
+  for (unsigned i = 0; i < 32; i++) {
+    memset(clientBuffers[i], static_cast<int>(i), sizeof(clientBuffers[i]));
+    clientMsgs[i].address.family = AF_INET;
+    clientMsgs[i].address.ipv4 = inet_addr("127.0.0.1");
+    clientMsgs[i].address.port = htons(gPort);
+    clientMsgs[i].buffer = clientBuffers[i];
+    clientMsgs[i].size = sizeof(clientBuffers[i]);
+    clientMsgs[i].segmentSize = 0;
+  }
+
+  aioReadMsgBatch(context.serverSocket, context.serverMsgs, 8, afNone, 1000000, test_udp_batch_server_readcb, &context);
+  aioWriteMsgBatch(clientSocket, clientMsgs, 32, afNone, 1000000, test_udp_batch_writecb, &context);
+  asyncLoop(gBase);
+  deleteAioObject(clientSocket);
+  ASSERT_TRUE(context.success);
+}
+
+struct SegmentTestContext {
+  asyncBase *base;
+  aioMsg serverMsg;
+  uint8_t serverBuffer[65536];
+  size_t receivedBytes;
+  size_t receivedDatagrams;
+};
+
+void test_udp_segment_readcb(AsyncOpStatus status, aioObject *socket, aioMsg *msgs, size_t count, void *arg)
+{
+  SegmentTestContext *ctx = static_cast<SegmentTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  if (status != aosSuccess) {
+    postQuitOperation(ctx->base);
+    return;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    // Without GRO coalescing every datagram is one segment
+    size_t segmentSize = msgs[i].segmentSize ? msgs[i].segmentSize : msgs[i].transferred;
+    EXPECT_EQ(segmentSize, 100u);
+    EXPECT_EQ(msgs[i].transferred % 100, 0u);
+    ctx->receivedBytes += msgs[i].transferred;
+    ctx->receivedDatagrams += msgs[i].transferred / segmentSize;
+  }
+
+  if (ctx->receivedBytes < 2000)
+    aioReadMsgBatch(socket, &ctx->serverMsg, 1, afNone, 1000000, test_udp_segment_readcb, ctx);
+  else
+    postQuitOperation(ctx->base);
+}
+
+TEST(basic, test_udp_segment)
+{
+  SegmentTestContext context;
+  context.base = gBase;
+  context.receivedBytes = 0;
+  context.receivedDatagrams = 0;
+  context.serverMsg.buffer = context.serverBuffer;
+  context.serverMsg.size = sizeof(context.serverBuffer);
+
+  aioObject *serverSocket = startUDPServer(gBase, nullptr, nullptr, nullptr, 0, gPort);
+  aioObject *clientSocket = initializeUDPClient(gBase);
+  ASSERT_NE(serverSocket, nullptr);
+  ASSERT_NE(clientSocket, nullptr);
+  if (socketEnableUdpGro(aioObjectSocket(serverSocket), 1) != 0 ||
+      socketSetUdpSegmentSize(aioObjectSocket(clientSocket), 100) != 0) {
+    // No segmentation offload in this system
+    deleteAioObject(serverSocket);
+    deleteAioObject(clientSocket);
+    return;
+  }
+
+  static uint8_t data[1000];
+  HostAddress address;
+  address.family = AF_INET;
+  address.ipv4 = inet_addr("127.0.0.1");
+  address.port = htons(gPort);
+
+  // Segment size from socket option
+  aioWriteMsg(clientSocket, &address, data, sizeof(data), afNone, 0, nullptr, nullptr);
+
+  // Segment size per message
+  aioMsg msg;
+  msg.address = address;
+  msg.buffer = data;
+  msg.size = sizeof(data);
+  msg.segmentSize = 100;
+  aioWriteMsgBatch(clientSocket, &msg, 1, afNone, 0, nullptr, nullptr);
+
+  aioReadMsgBatch(serverSocket, &context.serverMsg, 1, afNone, 1000000, test_udp_segment_readcb, &context);
+  asyncLoop(gBase);
+  deleteAioObject(serverSocket);
+  deleteAioObject(clientSocket);
+  ASSERT_EQ(context.receivedBytes, 2000u);
+  ASSERT_EQ(context.receivedDatagrams, 20u);
+}
+
 void test_timeout_readcb(AsyncOpStatus status, aioObject *socket, HostAddress address, size_t transferred, void *arg)
 {
   __UNUSED(socket);
@@ -338,6 +1032,81 @@ TEST(basic, test_timeout)
   ASSERT_TRUE(context.success);
 }
 
+void test_base_stats_readcb(AsyncOpStatus status, aioObject*, HostAddress, size_t, void *arg)
+{
+  TestContext *ctx = static_cast<TestContext*>(arg);
+  EXPECT_EQ(status, aosTimeout);
+  if (++ctx->serverState == 10)
+    postQuitOperation(ctx->base);
+}
+
+TEST(basic, test_base_stats)
+{
+  TestContext context(gBase);
+  asyncStats before;
+  asyncStats after;
+  context.serverSocket = startUDPServer(gBase, nullptr, &context, context.serverBuffer, sizeof(context.serverBuffer), gPort);
+  ASSERT_NE(context.serverSocket, nullptr);
+  asyncBaseGetStats(gBase, &before);
+  for (unsigned i = 0; i < 10; i++)
+    aioReadMsg(context.serverSocket, context.serverBuffer, sizeof(context.serverBuffer), afNone, 1000 + i*1000, test_base_stats_readcb, &context);
+  asyncLoop(gBase);
+  deleteAioObject(context.serverSocket);
+  asyncBaseGetStats(gBase, &after);
+  ASSERT_EQ(context.serverState, 10);
+  EXPECT_GE(after.opsStarted - before.opsStarted, 10u);
+  EXPECT_GE(after.opsCompletedAsync - before.opsCompletedAsync, 10u);
+  EXPECT_GE(after.timeoutsFired - before.timeoutsFired, 10u);
+  EXPECT_GE(after.combinerEntries - before.combinerEntries, 10u);
+  EXPECT_GT(after.waitCalls, before.waitCalls);
+  EXPECT_GE(after.waitTimeNs, before.waitTimeNs);
+  EXPECT_GT(after.opPoolSize, 0u);
+}
+
+__NO_PADDING_BEGIN
+struct TraceTestContext {
+  unsigned points[4] = {0, 0, 0, 0};
+  int opCode = 0;
+};
+__NO_PADDING_END
+
+void test_trace_hook(asyncOpRoot *op, aioTracePoint point, uint64_t, void *arg)
+{
+  TraceTestContext *ctx = static_cast<TraceTestContext*>(arg);
+  ctx->points[point]++;
+  ctx->opCode = op->opCode;
+}
+
+TEST(basic, test_trace_latency)
+{
+  TestContext context(gBase);
+  TraceTestContext traceContext;
+  aioLatencyStats latency;
+  context.serverSocket = startUDPServer(gBase, nullptr, &context, context.serverBuffer, sizeof(context.serverBuffer), gPort);
+  ASSERT_NE(context.serverSocket, nullptr);
+  asyncBaseSetTraceHook(gBase, test_trace_hook, &traceContext);
+  asyncBaseEnableLatencyHistograms(gBase, 1);
+  for (unsigned i = 0; i < 10; i++)
+    aioReadMsg(context.serverSocket, context.serverBuffer, sizeof(context.serverBuffer), afNone, 1000 + i*1000, test_base_stats_readcb, &context);
+  asyncLoop(gBase);
+  asyncBaseSetTraceHook(gBase, nullptr, nullptr);
+  asyncBaseEnableLatencyHistograms(gBase, 0);
+  deleteAioObject(context.serverSocket);
+  ASSERT_EQ(context.serverState, 10);
+  EXPECT_EQ(traceContext.points[atpCreated], 10u);
+  EXPECT_EQ(traceContext.points[atpStarted], 10u);
+  EXPECT_EQ(traceContext.points[atpCompleted], 10u);
+  EXPECT_EQ(traceContext.points[atpDispatched], 10u);
+  ASSERT_TRUE(asyncBaseGetLatency(gBase, atkSocket, traceContext.opCode, &latency));
+  EXPECT_EQ(latency.count, 10u);
+  // Timeouts from 1ms to 10ms spent waiting for I/O
+  EXPECT_GE(latency.ioTimeP50, 1000000u);
+  EXPECT_GE(latency.ioTimeP999, latency.ioTimeP99);
+  EXPECT_GE(latency.ioTimeP99, latency.ioTimeP50);
+  EXPECT_GE(latency.ioTimeP999, 9000000u);
+  EXPECT_LT(latency.queueDelayP50, latency.ioTimeP50);
+}
+
 void test_delete_object_eventcb(aioUserEvent *event, void *arg)
 {
   __UNUSED(event);
@@ -410,6 +1179,338 @@ TEST(basic, test_userevent)
   ASSERT_TRUE(context.success);
 }
 
+struct StealTestContext {
+  asyncBase *base;
+  aioObject *socket;
+  std::thread::id busyThread;
+  std::atomic<unsigned> finished{0};
+  std::atomic<unsigned> stolen{0};
+  uint8_t buffer[16];
+};
+
+void test_steal_readcb(AsyncOpStatus status, aioObject*, HostAddress, size_t, void *arg)
+{
+  StealTestContext *ctx = static_cast<StealTestContext*>(arg);
+  EXPECT_EQ(status, aosCanceled);
+  if (std::this_thread::get_id() != ctx->busyThread)
+    ctx->stolen++;
+  if (++ctx->finished == 256)
+    postQuitOperation(ctx->base);
+}
+
+void test_steal_eventcb(aioUserEvent*, void *arg)
+{
+  // Cancelled operations go to run queue of this thread, it stays busy until other thread steals some of them
+  StealTestContext *ctx = static_cast<StealTestContext*>(arg);
+  ctx->busyThread = std::this_thread::get_id();
+  cancelIo(aioObjectHandle(ctx->socket));
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+  while (ctx->stolen == 0 && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::yield();
+}
+
+TEST(basic, test_work_stealing)
+{
+  StealTestContext context;
+  context.base = createAsyncBase(gMethod);
+  context.socket = startUDPServer(context.base, nullptr, &context, context.buffer, sizeof(context.buffer), gPort);
+  ASSERT_NE(context.socket, nullptr);
+  for (unsigned i = 0; i < 256; i++)
+    aioReadMsg(context.socket, context.buffer, sizeof(context.buffer), afNone, 0, test_steal_readcb, &context);
+
+  // Second loop thread sleeps in wait for events (up to 500ms) and must be woken by growing run queue
+  std::thread threads[2];
+  for (unsigned i = 0; i < 2; i++)
+    threads[i] = std::thread([&context]() { asyncLoop(context.base); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  aioUserEvent *event = newUserEvent(context.base, 0, test_steal_eventcb, &context);
+  userEventActivate(event);
+  for (unsigned i = 0; i < 2; i++)
+    threads[i].join();
+  deleteUserEvent(event);
+  deleteAioObject(context.socket);
+  ASSERT_EQ(context.finished, 256u);
+  ASSERT_GT(context.stolen, 0u);
+}
+
+void test_loop_run_cb(aioUserEvent *event, void *arg)
+{
+#ifdef OS_LINUX
+  // Called on one of loop threads: pinned to CPU 0 and named by asyncLoopRun
+  char name[16];
+  EXPECT_EQ(sched_getcpu(), 0);
+  EXPECT_EQ(pthread_getname_np(pthread_self(), name, sizeof(name)), 0);
+  EXPECT_EQ(strncmp(name, "looptest-", 9), 0);
+#endif
+  test_userevent_cb(event, arg);
+}
+
+TEST(basic, test_loop_run)
+{
+  asyncBase *base = createAsyncBase(gMethod);
+  TestContext context(base);
+  asyncCpuSet affinity;
+  asyncCpuSetZero(&affinity);
+  asyncCpuSetAdd(&affinity, 0);
+  ASSERT_TRUE(asyncCpuSetContains(&affinity, 0));
+  ASSERT_FALSE(asyncCpuSetContains(&affinity, 1));
+  aioUserEvent *event = newUserEvent(base, 1, test_loop_run_cb, &context);
+  userEventStartTimer(event, 400, 256);
+  userEventActivate(event);
+  // Returns after quit posted by event callback stops all threads
+  asyncLoopRun(base, 4, &affinity, "looptest");
+  deleteUserEvent(event);
+  ASSERT_TRUE(context.success);
+}
+
+struct ShardTestContext {
+  asyncShardGroup *group;
+  unsigned accepted;
+  unsigned finished;
+  unsigned threadMismatch;
+  // Written only by client side on gBase thread
+  uint8_t reply;
+};
+
+struct ShardTestConnection {
+  ShardTestContext *ctx;
+  std::thread::id acceptThread;
+  uint8_t buffer[4];
+};
+
+void test_shard_server_writecb(AsyncOpStatus, aioObject *socket, size_t, void*)
+{
+  deleteAioObject(socket);
+}
+
+void test_shard_server_readcb(AsyncOpStatus status, aioObject *socket, size_t transferred, void *arg)
+{
+  ShardTestConnection *connection = static_cast<ShardTestConnection*>(arg);
+  if (connection->acceptThread != std::this_thread::get_id())
+    __uint_atomic_fetch_and_add(&connection->ctx->threadMismatch, 1);
+  // Socket deleted after reply sent, deleting it here cancels write queued by edge-triggered backend
+  if (status == aosSuccess)
+    aioWrite(socket, connection->buffer, transferred, afWaitAll, 0, test_shard_server_writecb, nullptr);
+  else
+    deleteAioObject(socket);
+  delete connection;
+}
+
+void test_shard_acceptcb(AsyncOpStatus status, aioObject *listener, HostAddress client, socketTy acceptSocket, void *arg)
+{
+  __UNUSED(client);
+  ShardTestContext *ctx = static_cast<ShardTestContext*>(arg);
+  if (status == aosSuccess) {
+    __uint_atomic_fetch_and_add(&ctx->accepted, 1);
+    ShardTestConnection *connection = new ShardTestConnection;
+    connection->ctx = ctx;
+    connection->acceptThread = std::this_thread::get_id();
+    aioObject *socket = newSocketIo(aioGetBase(listener), acceptSocket);
+    aioRead(socket, connection->buffer, 1, afWaitAll, 1000000, test_shard_server_readcb, connection);
+  } else if (status == aosCanceled) {
+    // Listener deleted by shardGroupDestroy
+    return;
+  }
+
+  aioAccept(listener, 0, test_shard_acceptcb, ctx);
+}
+
+void test_shard_client_readcb(AsyncOpStatus status, aioObject *socket, size_t, void *arg)
+{
+  ShardTestContext *ctx = static_cast<ShardTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  deleteAioObject(socket);
+  if (++ctx->finished == 16)
+    postQuitOperation(gBase);
+}
+
+void test_shard_connectcb(AsyncOpStatus status, aioObject *socket, void *arg)
+{
+  ShardTestContext *ctx = static_cast<ShardTestContext*>(arg);
+  EXPECT_EQ(status, aosSuccess);
+  if (status == aosSuccess) {
+    aioWrite(socket, "x", 1, afWaitAll, 0, nullptr, nullptr);
+    aioRead(socket, &ctx->reply, 1, afWaitAll, 1000000, test_shard_client_readcb, ctx);
+  } else {
+    deleteAioObject(socket);
+    postQuitOperation(gBase);
+  }
+}
+
+TEST(basic, test_shard_group)
+{
+  HostAddress address;
+  address.family = AF_INET;
+  address.ipv4 = INADDR_ANY;
+  address.port = htons(gPort+1);
+
+  ShardTestContext context;
+  context.group = createShardGroup(gMethod, 2);
+  context.accepted = 0;
+  context.finished = 0;
+  context.threadMismatch = 0;
+  ASSERT_EQ(shardGroupListen(context.group, &address, test_shard_acceptcb, &context), 0);
+  shardGroupStart(context.group);
+
+  for (unsigned i = 0; i < 16; i++) {
+    aioObject *client = initializeTCPClient(gBase, nullptr, nullptr, 0);
+    ASSERT_NE(client, nullptr);
+    HostAddress serverAddress;
+    serverAddress.family = AF_INET;
+    serverAddress.ipv4 = inet_addr("127.0.0.1");
+    serverAddress.port = htons(gPort+1);
+    aioConnect(client, &serverAddress, 1000000, test_shard_connectcb, &context);
+  }
+
+  asyncLoop(gBase);
+  shardGroupStop(context.group);
+  shardGroupJoin(context.group);
+  shardGroupDestroy(context.group);
+  ASSERT_EQ(context.finished, 16u);
+  ASSERT_EQ(context.accepted, 16u);
+  ASSERT_EQ(context.threadMismatch, 0u);
+}
+
+TEST(basic, test_concurrent_queue)
+{
+  // Elements pushed by several threads over multiple partitions, popped by several threads single and batched
+  static ConcurrentQueue queue;
+  const unsigned threadsNum = 4;
+  const uintptr_t elementsPerThread = 50000;
+  std::vector<std::thread> threads;
+  std::vector<uint8_t> seen(threadsNum * elementsPerThread + 1, 0);
+  volatile unsigned popped = 0;
+  for (unsigned i = 0; i < threadsNum; i++) {
+    threads.emplace_back([i, elementsPerThread]() {
+      for (uintptr_t j = 1; j <= elementsPerThread; j++)
+        concurrentQueuePush(&queue, reinterpret_cast<void*>(i * elementsPerThread + j));
+    });
+
+    threads.emplace_back([i, &seen, &popped]() {
+      void *data[32];
+      while (popped < threadsNum * elementsPerThread) {
+        size_t n = (i & 1) ? concurrentQueuePopBatch(&queue, data, 32) : concurrentQueuePop(&queue, data);
+        for (size_t k = 0; k < n; k++)
+          seen[reinterpret_cast<uintptr_t>(data[k])]++;
+        __uint_atomic_fetch_and_add(&popped, static_cast<unsigned>(n));
+      }
+    });
+  }
+
+  for (auto &thread: threads)
+    thread.join();
+  EXPECT_TRUE(concurrentQueueEmpty(&queue));
+  unsigned duplicates = 0;
+  for (size_t i = 1; i < seen.size(); i++)
+    duplicates += seen[i] != 1;
+  EXPECT_EQ(duplicates, 0u);
+
+  // Batch pop keeps FIFO order
+  for (uintptr_t i = 1; i <= 100; i++)
+    concurrentQueuePush(&queue, reinterpret_cast<void*>(i));
+  void *data[64];
+  ASSERT_EQ(concurrentQueuePopBatch(&queue, data, 64), 64u);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(data[0]), 1u);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(data[63]), 64u);
+  ASSERT_EQ(concurrentQueuePopBatch(&queue, data, 64), 36u);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(data[35]), 100u);
+  EXPECT_EQ(concurrentQueuePopBatch(&queue, data, 64), 0u);
+
+  // Overflow of current partition (initial size is 4096) moves both producers and consumers to next one
+  uint32_t readPartition = queue.ReadPartition;
+  uintptr_t overflowSize = (static_cast<uintptr_t>(4096) << queue.WritePartition) + 1;
+  for (uintptr_t i = 1; i <= overflowSize; i++)
+    concurrentQueuePush(&queue, reinterpret_cast<void*>(i));
+  uintptr_t last = 0;
+  bool ordered = true;
+  while (concurrentQueuePop(&queue, data)) {
+    ordered &= reinterpret_cast<uintptr_t>(data[0]) == last + 1;
+    last = reinterpret_cast<uintptr_t>(data[0]);
+  }
+  EXPECT_TRUE(ordered);
+  EXPECT_EQ(last, overflowSize);
+  EXPECT_EQ(queue.ReadPartition, readPartition + 1);
+  EXPECT_TRUE(concurrentQueueEmpty(&queue));
+}
+
+TEST(basic, test_spinlock)
+{
+  // More threads than cores force waiters to park, non-atomic counter detects broken mutual exclusion
+  volatile unsigned lock = 0;
+  uint64_t counter = 0;
+  const unsigned threadsNum = 16;
+  const unsigned iterations = 20000;
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < threadsNum; i++) {
+    threads.emplace_back([&lock, &counter, iterations]() {
+      for (unsigned j = 0; j < iterations; j++) {
+        __spinlock_acquire(&lock);
+        uint64_t value = counter;
+        if ((j & 255) == 0)
+          std::this_thread::yield();
+        counter = value + 1;
+        __spinlock_release(&lock);
+      }
+    });
+  }
+
+  for (auto &thread: threads)
+    thread.join();
+  EXPECT_EQ(counter, static_cast<uint64_t>(threadsNum) * iterations);
+  EXPECT_EQ(lock, 0u);
+  EXPECT_TRUE(__spinlock_try_acquire(&lock));
+  EXPECT_FALSE(__spinlock_try_acquire(&lock));
+  __spinlock_release(&lock);
+}
+
+TEST(basic, test_buffer_pool)
+{
+  size_t capacity;
+  void *small = bufferPoolAlloc(1, &capacity);
+  EXPECT_EQ(capacity, BUFFER_POOL_MIN_SIZE);
+  bufferPoolFree(small, capacity);
+
+  // Released buffer reused by same thread
+  void *buffer = bufferPoolAlloc(3000, &capacity);
+  EXPECT_EQ(capacity, 4096u);
+  memset(buffer, 0x55, capacity);
+  bufferPoolFree(buffer, capacity);
+  EXPECT_EQ(bufferPoolAlloc(4096, &capacity), buffer);
+  EXPECT_EQ(capacity, 4096u);
+
+  // Reserve keeps buffer with enough capacity, replaces smaller one
+  void *reserved = buffer;
+  size_t reservedCapacity = capacity;
+  EXPECT_EQ(bufferPoolReserve(&reserved, &reservedCapacity, 100), buffer);
+  EXPECT_EQ(reservedCapacity, 4096u);
+  bufferPoolReserve(&reserved, &reservedCapacity, 5000);
+  EXPECT_EQ(reservedCapacity, 8192u);
+  bufferPoolFree(reserved, reservedCapacity);
+
+  // Large buffers bypass pool
+  void *large = bufferPoolAlloc(BUFFER_POOL_MAX_SIZE + 1, &capacity);
+  EXPECT_EQ(capacity, BUFFER_POOL_MAX_SIZE + 1);
+  bufferPoolFree(large, capacity);
+}
+
+TEST(basic, test_object_pool_thread_exit)
+{
+  // Objects cached in magazine of exited worker thread returned to shared queue
+  static ConcurrentQueue pool;
+  static int objects[8];
+  std::thread worker([]() {
+    for (unsigned i = 0; i < 8; i++)
+      objectPoolPush(&pool, &objects[i]);
+  });
+  worker.join();
+
+  unsigned count = 0;
+  void *object;
+  while (concurrentQueuePop(&pool, &object))
+    count++;
+  EXPECT_EQ(count, 8u);
+}
+
 void coroutine_create_proc(void *arg)
 {
   int *x = static_cast<int*>(arg);
@@ -1234,10 +2335,14 @@ int main(int argc, char **argv)
       method = amSelect;
     } else if (strcmp(argv[1], "epoll") == 0) {
       method = amEPoll;
+    } else if (strcmp(argv[1], "epollet") == 0) {
+      method = amEPollET;
     } else if (strcmp(argv[1], "kqueue") == 0) {
       method = amKQueue;
     } else if (strcmp(argv[1], "iocp") == 0) {
       method = amIOCP;
+    } else if (strcmp(argv[1], "iouring") == 0) {
+      method = amIOUring;
     } else {
       fprintf(stderr, "ERROR: unknown method %s, default used\n", argv[1]);
     }
@@ -1245,6 +2350,7 @@ int main(int argc, char **argv)
 
   initializeSocketSubsystem();
 
+  gMethod = method;
   gBase = createAsyncBase(method);
 
   ::testing::InitGoogleTest(&argc, argv);